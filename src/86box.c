@@ -103,6 +103,11 @@
 #include <86box/machine_status.h>
 #include <86box/apm.h>
 #include <86box/acpi.h>
+#include <86box/profiler.h>
+#include <86box/snapshot.h>
+#include <86box/png_struct.h>
+#include <86box/capture.h>
+#include <minitrace/minitrace.h>
 
 // Disable c99-designator to avoid the warnings about int ng
 #ifdef __clang__
@@ -120,8 +125,10 @@ uint64_t     timer_freq;
 char         emu_version[200]; /* version ID string */
 
 #ifdef MTR_ENABLED
-int tracing_on = 0;
+int         tracing_on = 0;
+static char trace_path[1024] = { '\0' }; /* (O) start tracing to this file */
 #endif
+static char resume_path[1024] = { '\0' }; /* (O) resume from this snapshot */
 
 /* Commandline options. */
 int dump_on_exit        = 0; /* (O) dump regs on exit */
@@ -134,6 +141,7 @@ int video_fps = RENDER_FPS; /* (O) render speed in fps */
 #endif
 int settings_only     = 0; /* (O) show only the settings dialog */
 int confirm_exit_cmdl = 1; /* (O) do not ask for confirmation on quit if set to 0 */
+int cfg_cache         = 0; /* (O) keep a binary cache of the config file */
 #ifdef _WIN32
 uint64_t unique_id   = 0;
 uint64_t source_hwnd = 0;
@@ -190,6 +198,9 @@ uint32_t mem_size                               = 0;              /* (C) memory
                                                                          system board)*/
 uint32_t isa_mem_size                           = 0;              /* (C) memory size (ISA Memory Cards) */
 int      cpu_use_dynarec                        = 0;              /* (C) cpu uses/needs Dyna */
+int      cpu_dynarec_cache                      = 0;              /* (C) recompiler code cache size in MB,
+                                                                         0 = default */
+int      cpu_dynarec_opt                        = 1;              /* (C) recompiler IR optimisation */
 int      cpu                                    = 0;              /* (C) cpu type */
 int      fpu_type                               = 0;              /* (C) fpu type */
 int      fpu_softfloat                          = 0;              /* (C) fpu uses softfloat */
@@ -198,6 +209,8 @@ int      confirm_reset                          = 1;              /* (C) enable
 int      confirm_exit                           = 1;              /* (C) enable exit confirmation */
 int      confirm_save                           = 1;              /* (C) enable save confirmation */
 int      enable_discord                         = 0;              /* (C) enable Discord integration */
+int      ram_advice                             = 0;              /* (C) host paging advice for the guest RAM */
+int      rom_mmap                               = 0;              /* (C) map ROM images from their files */
 int      pit_mode                               = -1;             /* (C) force setting PIT mode */
 int      fm_driver                              = 0;              /* (C) select FM sound driver */
 int      open_dir_usr_path                      = 0;              /* (C) default file open dialog directory
@@ -556,11 +569,16 @@ usage:
             printf("-M or --missing         - dump missing machines and video cards\n");
             printf("-N or --noconfirm       - do not ask for confirmation on quit\n");
             printf("-P or --vmpath path     - set 'path' to be root for vm\n");
+            printf("-Q or --cfgcache        - keep a binary cache of the config file\n");
             printf("-R or --rompath path    - set 'path' to be ROM path\n");
 #ifndef USE_SDL_UI
             printf("-S or --settings        - show only the settings dialog\n");
 #endif
+            printf("-U or --resume path     - resume the machine state saved in 'path'\n");
             printf("-V or --vmname name     - overrides the name of the running VM\n");
+#ifdef MTR_ENABLED
+            printf("-W or --trace path      - record a Chrome trace of the emulator to 'path'\n");
+#endif
             printf("-X or --clear what      - clears the 'what' (cmos/flash/both)\n");
             printf("-Y or --donothing       - do not show any UI or run the emulation\n");
             printf("-Z or --lastvmpath      - the last parameter is VM path rather than config\n");
@@ -632,6 +650,8 @@ usage:
 #endif
         } else if (!strcasecmp(argv[c], "--noconfirm") || !strcasecmp(argv[c], "-N")) {
             confirm_exit_cmdl = 0;
+        } else if (!strcasecmp(argv[c], "--cfgcache") || !strcasecmp(argv[c], "-Q")) {
+            cfg_cache = 1;
         } else if (!strcasecmp(argv[c], "--missing") || !strcasecmp(argv[c], "-M")) {
             dump_missing = 1;
         } else if (!strcasecmp(argv[c], "--donothing") || !strcasecmp(argv[c], "-Y")) {
@@ -683,6 +703,16 @@ usage:
 
             /* .. and then exit. */
             return 0;
+        } else if (!strcasecmp(argv[c], "--resume") || !strcasecmp(argv[c], "-U")) {
+            if ((c + 1) == argc)
+                goto usage;
+            strncpy(resume_path, argv[++c], sizeof(resume_path) - 1);
+#ifdef MTR_ENABLED
+        } else if (!strcasecmp(argv[c], "--trace") || !strcasecmp(argv[c], "-W")) {
+            if ((c + 1) == argc)
+                goto usage;
+            strncpy(trace_path, argv[++c], sizeof(trace_path) - 1);
+#endif
 #ifdef USE_INSTRUMENT
         } else if (!strcasecmp(argv[c], "--instrument") || !strcasecmp(argv[c], "-J")) {
             if ((c + 1) == argc)
@@ -894,6 +924,19 @@ usage:
 
     gdbstub_init();
 
+#ifdef USE_PROFILER
+    profiler_init();
+#endif
+
+#ifdef MTR_ENABLED
+    if (trace_path[0] != '\0')
+        pc_trace_start(trace_path);
+#endif
+
+    /* The snapshot is restored once the machine has been set up. */
+    if (resume_path[0] != '\0')
+        snapshot_load_request(resume_path);
+
     /* All good! */
     return 1;
 }
@@ -1038,6 +1081,8 @@ pc_init_modules(void)
     keyboard_init();
     joystick_init();
 
+    png_queue_init();
+
     video_init();
 
     fdd_init();
@@ -1337,6 +1382,9 @@ pc_close(UNUSED(thread_t *ptr))
     /* Wait a while so things can shut down. */
     plat_delay_ms(200);
 
+    /* Finish any running video capture before the blitter is claimed. */
+    capture_close();
+
     /* Claim the video blitter. */
     startblit();
 
@@ -1369,6 +1417,9 @@ pc_close(UNUSED(thread_t *ptr))
 
     device_close_all();
 
+    /* Finish writing any queued screenshots and printed pages. */
+    png_queue_close();
+
     scsi_device_close_all();
 
     midi_out_close();
@@ -1388,6 +1439,14 @@ pc_close(UNUSED(thread_t *ptr))
     scsi_disk_close();
 
     gdbstub_close();
+
+#ifdef USE_PROFILER
+    profiler_close();
+#endif
+
+#ifdef MTR_ENABLED
+    pc_trace_stop();
+#endif
 }
 
 #ifdef __APPLE__
@@ -1414,6 +1473,8 @@ pc_run(void)
     int     mouse_msg_idx;
     wchar_t temp[200];
 
+    MTR_BEGIN("cpu", "pc_run");
+
     /* Trigger a hard reset if one is pending. */
     if (hard_reset_pending) {
         hard_reset_pending = 0;
@@ -1423,7 +1484,10 @@ pc_run(void)
 
     /* Run a block of code. */
     startblit();
+    snapshot_process();
+    MTR_BEGIN("cpu", "cpu_exec");
     cpu_exec((int32_t) cpu_s->rspeed / 100);
+    MTR_END("cpu", "cpu_exec");
     ack_pause();
 #ifdef USE_GDBSTUB /* avoid a KBC FIFO overflow when CPU emulation is stalled */
     if (gdbstub_step == GDBSTUB_EXEC) {
@@ -1434,6 +1498,9 @@ pc_run(void)
     }
 #endif
     joystick_process();
+#ifdef USE_PROFILER
+    profiler_process();
+#endif
     endblit();
 
     /* Done with this frame, update statistics. */
@@ -1454,8 +1521,43 @@ pc_run(void)
 #endif
         title_update = 0;
     }
+
+    MTR_END("cpu", "pc_run");
+}
+
+#ifdef MTR_ENABLED
+/* Start recording a Chrome trace (chrome://tracing or Perfetto) to fn. */
+int
+pc_trace_start(const char *fn)
+{
+    if (tracing_on)
+        return 1;
+
+    if (!mtr_init(fn)) {
+        pclog("Unable to open trace file \"%s\"\n", fn);
+        return 0;
+    }
+    mtr_start();
+    MTR_META_PROCESS_NAME(EMU_NAME);
+    tracing_on = 1;
+    ui_trace_state_changed();
+
+    return 1;
 }
 
+void
+pc_trace_stop(void)
+{
+    if (!tracing_on)
+        return;
+
+    tracing_on = 0;
+    mtr_stop();
+    mtr_shutdown();
+    ui_trace_state_changed();
+}
+#endif
+
 /* Handler for the 1-second timer to refresh the window title. */
 void
 pc_onesec(void)
@@ -1464,6 +1566,10 @@ pc_onesec(void)
     framecount = 0;
 
     title_update = 1;
+
+#ifdef USE_PROFILER
+    profiler_onesec();
+#endif
 }
 
 void
@@ -0,0 +1,655 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Video and audio capture facility.
+ *
+ *          Frames of the first monitor are tapped on its blit thread and
+ *          the main sound mix is tapped as it is handed to the audio
+ *          backend. Frames are delta encoded against the previous one,
+ *          only the rows that changed are copied, and both streams are
+ *          queued in arrival order on a bounded ring of pooled buffers.
+ *          A writer thread applies the deltas, converts the changed rows
+ *          to YUV 4:2:0 and writes an uncompressed YUV4MPEG2 stream plus
+ *          a WAV file. The video is written at a constant frame rate
+ *          paced by the audio stream, which runs in emulated time, so the
+ *          two stay in sync whatever the host speed; frames are repeated
+ *          or skipped as needed, and the video is padded to the length of
+ *          the audio when the capture stops. A change of resolution starts
+ *          a new YUV4MPEG2 segment (base-1.y4m, base-2.y4m and so on).
+ *
+ *          The hooks never wait for the writer. If the ring is full, a
+ *          frame's changes go out with the next frame that makes it in,
+ *          and an audio buffer is replaced by the same length of silence,
+ *          so the timing is kept. A few slots are kept for audio, so that
+ *          it is rarely the one having to give way.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/video.h>
+#include <86box/sound.h>
+#include <86box/capture.h>
+
+#define CAPTURE_RING_SIZE     32
+#define CAPTURE_AUDIO_RESERVE 8 /* slots video frames may not take */
+#define CAPTURE_MAX_ROWS      2112
+
+enum {
+    CAPTURE_JOB_START = 0,
+    CAPTURE_JOB_STOP,
+    CAPTURE_JOB_VIDEO,
+    CAPTURE_JOB_AUDIO
+};
+
+typedef struct capture_job_t {
+    int       type;
+    int       w;
+    int       h;
+    int       rows;     /* Video: number of rows in the delta. */
+    int       is_float; /* Audio: sample format. */
+    int       samples;  /* Audio: number of stereo samples. */
+    uint64_t  lost;     /* Audio and stop: samples to fill with silence first. */
+    uint16_t *row_idx;  /* Video: line numbers of the rows in data. */
+    uint8_t  *data;
+    size_t    data_size;
+    size_t    row_idx_size;
+} capture_job_t;
+
+typedef struct capture_t {
+    char base[1024];
+    int  fps;
+
+    /* Producer side, blit thread only. */
+    uint32_t *ref;
+    int       ref_w;
+    int       ref_h;
+    int       ref_valid;
+    uint16_t  changed[CAPTURE_MAX_ROWS];
+
+    /* The ring; slots keep their buffers between uses. */
+    capture_job_t ring[CAPTURE_RING_SIZE];
+    int           head;
+    int           count;
+    uint32_t      dropped;
+    uint64_t      audio_lost; /* samples dropped since the last audio job */
+    mutex_t      *mutex;
+    event_t      *wake;
+    event_t      *space;
+    thread_t     *thread;
+    int           quit;
+
+    /* Writer side, writer thread only. */
+    FILE     *video_fp;
+    FILE     *audio_fp;
+    int       segment;
+    int       w;
+    int       h;
+    uint32_t *frame;
+    uint8_t  *yuv;
+    uint8_t  *chroma_dirty;
+    uint64_t  audio_samples;
+    uint64_t  frames_out;
+    uint32_t  audio_bytes;
+    int       audio_float;
+} capture_t;
+
+volatile int capture_active = 0;
+
+static capture_t cap;
+
+#ifdef ENABLE_CAPTURE_LOG
+int capture_do_log = ENABLE_CAPTURE_LOG;
+
+static void
+capture_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (capture_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define capture_log(fmt, ...)
+#endif
+
+static void
+capture_put_u16(FILE *fp, uint16_t val)
+{
+    uint8_t b[2] = { val & 0xff, val >> 8 };
+
+    fwrite(b, 1, 2, fp);
+}
+
+static void
+capture_put_u32(FILE *fp, uint32_t val)
+{
+    uint8_t b[4] = { val & 0xff, (val >> 8) & 0xff, (val >> 16) & 0xff, val >> 24 };
+
+    fwrite(b, 1, 4, fp);
+}
+
+static void
+capture_wav_header(FILE *fp, int is_float, uint32_t data_bytes)
+{
+    int bits = is_float ? 32 : 16;
+
+    fwrite("RIFF", 1, 4, fp);
+    capture_put_u32(fp, 36 + data_bytes);
+    fwrite("WAVEfmt ", 1, 8, fp);
+    capture_put_u32(fp, 16);
+    capture_put_u16(fp, is_float ? 3 : 1); /* IEEE float or PCM */
+    capture_put_u16(fp, 2);
+    capture_put_u32(fp, SOUND_FREQ);
+    capture_put_u32(fp, SOUND_FREQ * 2 * (bits >> 3));
+    capture_put_u16(fp, 2 * (bits >> 3));
+    capture_put_u16(fp, bits);
+    fwrite("data", 1, 4, fp);
+    capture_put_u32(fp, data_bytes);
+}
+
+static void
+capture_file_name(char *fn, size_t len, const char *ext, int segment)
+{
+    if (segment)
+        snprintf(fn, len, "%s-%i.%s", cap.base, segment, ext);
+    else
+        snprintf(fn, len, "%s.%s", cap.base, ext);
+}
+
+/* Writer: converts line y of the frame to luma, and marks its chroma row. */
+static void
+capture_convert_row(int y)
+{
+    const uint32_t *p    = &cap.frame[y * cap.w];
+    uint8_t        *luma = &cap.yuv[y * cap.w];
+
+    for (int x = 0; x < cap.w; x++) {
+        uint32_t r = (p[x] >> 16) & 0xff;
+        uint32_t g = (p[x] >> 8) & 0xff;
+        uint32_t b = p[x] & 0xff;
+
+        luma[x] = (uint8_t) ((77 * r + 150 * g + 29 * b) >> 8);
+    }
+
+    cap.chroma_dirty[y >> 1] = 1;
+}
+
+/* Writer: recomputes the subsampled chroma of the dirty row pairs. */
+static void
+capture_convert_chroma(void)
+{
+    int      cw = (cap.w + 1) >> 1;
+    int      ch = (cap.h + 1) >> 1;
+    uint8_t *u  = &cap.yuv[cap.w * cap.h];
+    uint8_t *v  = u + (cw * ch);
+
+    for (int cy = 0; cy < ch; cy++) {
+        if (!cap.chroma_dirty[cy])
+            continue;
+        cap.chroma_dirty[cy] = 0;
+
+        for (int cx = 0; cx < cw; cx++) {
+            int r = 0;
+            int g = 0;
+            int b = 0;
+            int n = 0;
+
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    int x = (cx << 1) + dx;
+                    int y = (cy << 1) + dy;
+
+                    if ((x < cap.w) && (y < cap.h)) {
+                        uint32_t p = cap.frame[(y * cap.w) + x];
+
+                        r += (p >> 16) & 0xff;
+                        g += (p >> 8) & 0xff;
+                        b += p & 0xff;
+                        n++;
+                    }
+                }
+            }
+            r /= n;
+            g /= n;
+            b /= n;
+
+            u[(cy * cw) + cx] = (uint8_t) (((-43 * r - 85 * g + 128 * b) >> 8) + 128);
+            v[(cy * cw) + cx] = (uint8_t) (((128 * r - 107 * g - 21 * b) >> 8) + 128);
+        }
+    }
+}
+
+static void
+capture_close_video(void)
+{
+    if (cap.video_fp != NULL) {
+        fclose(cap.video_fp);
+        cap.video_fp = NULL;
+    }
+}
+
+/* Writer: starts a new segment for a w x h picture. */
+static void
+capture_open_video(int w, int h)
+{
+    char   fn[1024 + 16];
+    size_t size = (size_t) w * h + 2 * (size_t) ((w + 1) >> 1) * ((h + 1) >> 1);
+
+    capture_close_video();
+    if (cap.w || cap.h)
+        cap.segment++;
+
+    cap.w            = w;
+    cap.h            = h;
+    cap.frame        = (uint32_t *) realloc(cap.frame, (size_t) w * h * sizeof(uint32_t));
+    cap.yuv          = (uint8_t *) realloc(cap.yuv, size);
+    cap.chroma_dirty = (uint8_t *) realloc(cap.chroma_dirty, (h + 1) >> 1);
+    memset(cap.frame, 0x00, (size_t) w * h * sizeof(uint32_t));
+    memset(cap.chroma_dirty, 0x00, (h + 1) >> 1);
+
+    capture_file_name(fn, sizeof(fn), "y4m", cap.segment);
+    cap.video_fp = plat_fopen(fn, "wb");
+    if (cap.video_fp == NULL) {
+        pclog("CAPTURE: Unable to create %s\n", fn);
+        return;
+    }
+
+    /* Start out black, for the frames due before the first picture. */
+    for (int y = 0; y < h; y++)
+        capture_convert_row(y);
+    capture_convert_chroma();
+
+    fprintf(cap.video_fp, "YUV4MPEG2 W%i H%i F%i:1 Ip A1:1 C420jpeg\n", w, h, cap.fps);
+    capture_log("CAPTURE: New segment %s (%ix%i)\n", fn, w, h);
+}
+
+/* Writer: emits the current picture for every frame that starts before the
+   audio clock, frame n starting at n / fps seconds. */
+static void
+capture_emit_frames(void)
+{
+    uint64_t target = ((cap.audio_samples * cap.fps) + SOUND_FREQ - 1) / SOUND_FREQ;
+    size_t   size;
+
+    if (cap.video_fp == NULL)
+        return;
+
+    size = (size_t) cap.w * cap.h + 2 * (size_t) ((cap.w + 1) >> 1) * ((cap.h + 1) >> 1);
+    while (cap.frames_out < target) {
+        fwrite("FRAME\n", 1, 6, cap.video_fp);
+        fwrite(cap.yuv, 1, size, cap.video_fp);
+        cap.frames_out++;
+    }
+}
+
+static void
+capture_write_video(capture_job_t *job)
+{
+    const uint32_t *rows = (const uint32_t *) job->data;
+
+    /* The frames due so far still show the previous picture. */
+    capture_emit_frames();
+
+    if ((job->w != cap.w) || (job->h != cap.h)) {
+        capture_open_video(job->w, job->h);
+        capture_emit_frames();
+    }
+
+    for (int i = 0; i < job->rows; i++) {
+        memcpy(&cap.frame[job->row_idx[i] * cap.w], &rows[i * job->w], cap.w * sizeof(uint32_t));
+        capture_convert_row(job->row_idx[i]);
+    }
+    capture_convert_chroma();
+}
+
+/* Writer: appends samples to the WAV file, silence if data is NULL. */
+static void
+capture_write_samples(const void *data, uint64_t samples, int is_float)
+{
+    static const uint8_t zero[4096] = { 0 };
+    size_t               len        = (size_t) samples * 2 * (is_float ? sizeof(float) : sizeof(int16_t));
+
+    if ((cap.audio_fp != NULL) && (is_float == cap.audio_float)) {
+        if (data != NULL)
+            fwrite(data, 1, len, cap.audio_fp);
+        else {
+            for (size_t i = 0; i < len; i += sizeof(zero))
+                fwrite(zero, 1, ((len - i) < sizeof(zero)) ? (len - i) : sizeof(zero), cap.audio_fp);
+        }
+        cap.audio_bytes += (uint32_t) len;
+    }
+
+    cap.audio_samples += samples;
+    capture_emit_frames();
+}
+
+static void
+capture_write_audio(capture_job_t *job)
+{
+    char fn[1024 + 16];
+
+    if (cap.audio_fp == NULL) {
+        capture_file_name(fn, sizeof(fn), "wav", 0);
+        cap.audio_fp = plat_fopen(fn, "wb");
+        if (cap.audio_fp == NULL)
+            pclog("CAPTURE: Unable to create %s\n", fn);
+        else {
+            cap.audio_float = job->is_float;
+            capture_wav_header(cap.audio_fp, cap.audio_float, 0);
+        }
+    }
+
+    if (job->lost)
+        capture_write_samples(NULL, job->lost, job->is_float);
+    capture_write_samples(job->data, job->samples, job->is_float);
+}
+
+static void
+capture_finish(capture_job_t *job)
+{
+    if (job->lost)
+        capture_write_samples(NULL, job->lost, cap.audio_float);
+
+    /* Pad the video to the length of the audio. */
+    capture_emit_frames();
+    capture_close_video();
+
+    if (cap.audio_fp != NULL) {
+        fseek(cap.audio_fp, 0, SEEK_SET);
+        capture_wav_header(cap.audio_fp, cap.audio_float, cap.audio_bytes);
+        fclose(cap.audio_fp);
+        cap.audio_fp = NULL;
+    }
+
+    pclog("CAPTURE: Stopped, %" PRIu64 " frames written, %u buffers dropped\n", cap.frames_out, cap.dropped);
+}
+
+static void
+capture_thread(UNUSED(void *priv))
+{
+    capture_job_t *job;
+
+    while (1) {
+        thread_wait_mutex(cap.mutex);
+        if (cap.count == 0) {
+            if (cap.quit) {
+                thread_release_mutex(cap.mutex);
+                break;
+            }
+            thread_reset_event(cap.wake);
+            thread_release_mutex(cap.mutex);
+            thread_wait_event(cap.wake, -1);
+            continue;
+        }
+        /* The slot stays owned by the writer until it is done with it. */
+        job = &cap.ring[cap.head];
+        thread_release_mutex(cap.mutex);
+
+        switch (job->type) {
+            case CAPTURE_JOB_START:
+                cap.w = cap.h = cap.segment = 0;
+                cap.audio_samples = cap.frames_out = 0;
+                cap.audio_bytes                    = 0;
+                break;
+            case CAPTURE_JOB_STOP:
+                capture_finish(job);
+                break;
+            case CAPTURE_JOB_VIDEO:
+                capture_write_video(job);
+                break;
+            case CAPTURE_JOB_AUDIO:
+                capture_write_audio(job);
+                break;
+            default:
+                break;
+        }
+
+        thread_wait_mutex(cap.mutex);
+        cap.head = (cap.head + 1) % CAPTURE_RING_SIZE;
+        cap.count--;
+        thread_release_mutex(cap.mutex);
+        thread_set_event(cap.space);
+    }
+}
+
+/* Returns the next free slot, or NULL if the ring is full (leaving reserve
+   slots free); called with the mutex held. */
+static capture_job_t *
+capture_slot(int reserve)
+{
+    if (cap.count >= (CAPTURE_RING_SIZE - reserve))
+        return NULL;
+
+    return &cap.ring[(cap.head + cap.count) % CAPTURE_RING_SIZE];
+}
+
+static void
+capture_reserve(capture_job_t *job, size_t data_size, size_t row_idx_size)
+{
+    if (job->data_size < data_size) {
+        job->data      = (uint8_t *) realloc(job->data, data_size);
+        job->data_size = data_size;
+    }
+    if (job->row_idx_size < row_idx_size) {
+        job->row_idx      = (uint16_t *) realloc(job->row_idx, row_idx_size);
+        job->row_idx_size = row_idx_size;
+    }
+}
+
+/* Queues a control job, waiting for room; not for use by the hooks. Audio
+   dropped since the last audio job is handed over with it. */
+static void
+capture_control(int type)
+{
+    capture_job_t *job;
+
+    thread_wait_mutex(cap.mutex);
+    while ((job = capture_slot(0)) == NULL) {
+        thread_reset_event(cap.space);
+        thread_release_mutex(cap.mutex);
+        thread_wait_event(cap.space, -1);
+        thread_wait_mutex(cap.mutex);
+    }
+    job->type      = type;
+    job->lost      = cap.audio_lost;
+    cap.audio_lost = 0;
+    cap.count++;
+    thread_release_mutex(cap.mutex);
+    thread_set_event(cap.wake);
+}
+
+void
+capture_video(struct bitmap_t *b, int x, int y, int w, int h)
+{
+    capture_job_t *job;
+    int            rows = 0;
+
+    if ((w > 2048) || (h > CAPTURE_MAX_ROWS) || ((y + h) > CAPTURE_MAX_ROWS))
+        return;
+
+    if ((w != cap.ref_w) || (h != cap.ref_h)) {
+        cap.ref       = (uint32_t *) realloc(cap.ref, (size_t) w * h * sizeof(uint32_t));
+        cap.ref_w     = w;
+        cap.ref_h     = h;
+        cap.ref_valid = 0;
+    }
+
+    /* Find the rows that changed since the last queued frame. */
+    for (int i = 0; i < h; i++) {
+        if (!cap.ref_valid || memcmp(&cap.ref[i * w], &b->line[y + i][x], w * sizeof(uint32_t)))
+            cap.changed[rows++] = i;
+    }
+
+    if (cap.ref_valid && (rows == 0))
+        return;
+
+    thread_wait_mutex(cap.mutex);
+    if (!capture_active || ((job = capture_slot(CAPTURE_AUDIO_RESERVE)) == NULL)) {
+        /* The reference is left alone, so the rows go out with the next
+           frame that makes it into the ring. */
+        cap.dropped += capture_active;
+        thread_release_mutex(cap.mutex);
+        return;
+    }
+
+    capture_reserve(job, (size_t) rows * w * sizeof(uint32_t), rows * sizeof(uint16_t));
+    job->type = CAPTURE_JOB_VIDEO;
+    job->w    = w;
+    job->h    = h;
+    job->rows = rows;
+    for (int i = 0; i < rows; i++) {
+        const uint32_t *src = &b->line[y + cap.changed[i]][x];
+
+        memcpy(&job->data[i * w * sizeof(uint32_t)], src, w * sizeof(uint32_t));
+        memcpy(&cap.ref[cap.changed[i] * w], src, w * sizeof(uint32_t));
+        job->row_idx[i] = cap.changed[i];
+    }
+    cap.ref_valid = 1;
+    cap.count++;
+    thread_release_mutex(cap.mutex);
+
+    thread_set_event(cap.wake);
+}
+
+void
+capture_audio(const void *buf, int samples, int is_float)
+{
+    capture_job_t *job;
+    size_t         len = (size_t) samples * 2 * (is_float ? sizeof(float) : sizeof(int16_t));
+
+    thread_wait_mutex(cap.mutex);
+    if (!capture_active || ((job = capture_slot(0)) == NULL)) {
+        /* Becomes silence ahead of the next buffer, see capture_write_audio(). */
+        if (capture_active) {
+            cap.audio_lost += samples;
+            cap.dropped++;
+        }
+        thread_release_mutex(cap.mutex);
+        return;
+    }
+
+    capture_reserve(job, len, 0);
+    job->type      = CAPTURE_JOB_AUDIO;
+    job->is_float  = is_float;
+    job->samples   = samples;
+    job->lost      = cap.audio_lost;
+    cap.audio_lost = 0;
+    memcpy(job->data, buf, len);
+    cap.count++;
+    thread_release_mutex(cap.mutex);
+
+    thread_set_event(cap.wake);
+}
+
+int
+capture_start(const char *base, int fps)
+{
+    size_t len;
+
+    if (capture_active)
+        return 0;
+
+    if (cap.thread == NULL) {
+        cap.mutex  = thread_create_mutex();
+        cap.wake   = thread_create_event();
+        cap.space  = thread_create_event();
+        cap.quit   = 0;
+        cap.thread = thread_create_named(capture_thread, NULL, "Video capture");
+    }
+
+    /* Wait for a previous capture to be written out. */
+    thread_wait_mutex(cap.mutex);
+    while (cap.count > 0) {
+        thread_reset_event(cap.space);
+        thread_release_mutex(cap.mutex);
+        thread_wait_event(cap.space, -1);
+        thread_wait_mutex(cap.mutex);
+    }
+    thread_release_mutex(cap.mutex);
+
+    snprintf(cap.base, sizeof(cap.base), "%s", base);
+    len = strlen(cap.base);
+    if ((len > 4) && !strcasecmp(&cap.base[len - 4], ".y4m"))
+        cap.base[len - 4] = '\0';
+    cap.fps        = (fps > 0) ? fps : CAPTURE_FPS_DEFAULT;
+    cap.dropped    = 0;
+    cap.audio_lost = 0;
+
+    /* The blit thread picks this up on its next frame. */
+    cap.ref_valid = 0;
+
+    capture_control(CAPTURE_JOB_START);
+
+    thread_wait_mutex(cap.mutex);
+    capture_active = 1;
+    thread_release_mutex(cap.mutex);
+
+    pclog("CAPTURE: Started, writing to %s.y4m and %s.wav at %i fps\n", cap.base, cap.base, cap.fps);
+
+    return 1;
+}
+
+void
+capture_stop(void)
+{
+    if (!capture_active)
+        return;
+
+    thread_wait_mutex(cap.mutex);
+    capture_active = 0;
+    thread_release_mutex(cap.mutex);
+
+    capture_control(CAPTURE_JOB_STOP);
+}
+
+void
+capture_close(void)
+{
+    capture_stop();
+
+    if (cap.thread == NULL)
+        return;
+
+    thread_wait_mutex(cap.mutex);
+    cap.quit = 1;
+    thread_release_mutex(cap.mutex);
+    thread_set_event(cap.wake);
+    thread_wait(cap.thread);
+    cap.thread = NULL;
+
+    for (int i = 0; i < CAPTURE_RING_SIZE; i++) {
+        free(cap.ring[i].data);
+        free(cap.ring[i].row_idx);
+    }
+    free(cap.ref);
+    free(cap.frame);
+    free(cap.yuv);
+    free(cap.chroma_dirty);
+
+    thread_destroy_event(cap.space);
+    thread_destroy_event(cap.wake);
+    thread_close_mutex(cap.mutex);
+    memset(&cap, 0x00, sizeof(capture_t));
+}
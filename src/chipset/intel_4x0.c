@@ -33,6 +33,7 @@
 #include <86box/spd.h>
 #include <86box/machine.h>
 #include <86box/agpgart.h>
+#include <86box/snapshot.h>
 
 enum {
     INTEL_420TX,
@@ -1594,6 +1595,50 @@ i4x0_reset(void *priv)
     }
 }
 
+static void
+i4x0_save_state(void *priv, snapshot_t *s)
+{
+    i4x0_t *dev = (i4x0_t *) priv;
+
+    SNAPSHOT_WRITE_VAR(s, dev->pm2_cntrl);
+    SNAPSHOT_WRITE_VAR(s, dev->smram_locked);
+    SNAPSHOT_WRITE_VAR(s, dev->regs);
+    SNAPSHOT_WRITE_VAR(s, dev->regs_locked);
+    SNAPSHOT_WRITE_VAR(s, dev->mem_state);
+}
+
+static void
+i4x0_load_state(void *priv, snapshot_t *s)
+{
+    i4x0_t *dev = (i4x0_t *) priv;
+    int     pm2 = 0;
+
+    SNAPSHOT_READ_VAR(s, dev->pm2_cntrl);
+    SNAPSHOT_READ_VAR(s, dev->smram_locked);
+    SNAPSHOT_READ_VAR(s, dev->regs);
+    SNAPSHOT_READ_VAR(s, dev->regs_locked);
+    SNAPSHOT_READ_VAR(s, dev->mem_state);
+
+    if (snapshot_error(s))
+        return;
+
+    /* The shadow RAM state comes back with the memory state, but SMRAM,
+       the AGP aperture and the PM2 control port have to be reapplied. */
+    i4x0_smram_handler_phase0(dev);
+    i4x0_smram_handler_phase1(dev);
+
+    i4x0_mask_bar(dev->regs, dev->agpgart);
+
+    if (dev->type == INTEL_430TX)
+        pm2 = !!(dev->regs[0x79] & 0x40);
+    else if ((dev->type == INTEL_440BX) || (dev->type == INTEL_440ZX) || (dev->type == INTEL_440GX))
+        pm2 = !!(dev->regs[0x7a] & 0x40);
+
+    io_removehandler(0x0022, 0x01, pm2_cntrl_read, NULL, NULL, pm2_cntrl_write, NULL, NULL, dev);
+    if (pm2)
+        io_sethandler(0x0022, 0x01, pm2_cntrl_read, NULL, NULL, pm2_cntrl_write, NULL, NULL, dev);
+}
+
 static void
 i4x0_close(void *priv)
 {
@@ -1970,7 +2015,9 @@ const device_t i420tx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i420zx_device = {
@@ -1984,7 +2031,9 @@ const device_t i420zx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430lx_device = {
@@ -1998,7 +2047,9 @@ const device_t i430lx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430nx_device = {
@@ -2012,7 +2063,9 @@ const device_t i430nx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430fx_device = {
@@ -2026,7 +2079,9 @@ const device_t i430fx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430fx_rev02_device = {
@@ -2040,7 +2095,9 @@ const device_t i430fx_rev02_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430hx_device = {
@@ -2054,7 +2111,9 @@ const device_t i430hx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430vx_device = {
@@ -2068,7 +2127,9 @@ const device_t i430vx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i430tx_device = {
@@ -2082,7 +2143,9 @@ const device_t i430tx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440fx_device = {
@@ -2096,7 +2159,9 @@ const device_t i440fx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440lx_device = {
@@ -2110,7 +2175,9 @@ const device_t i440lx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440ex_device = {
@@ -2124,7 +2191,9 @@ const device_t i440ex_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440bx_device = {
@@ -2138,7 +2207,9 @@ const device_t i440bx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440bx_no_agp_device = {
@@ -2152,7 +2223,9 @@ const device_t i440bx_no_agp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440gx_device = {
@@ -2166,7 +2239,9 @@ const device_t i440gx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
 
 const device_t i440zx_device = {
@@ -2180,5 +2255,7 @@ const device_t i440zx_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = i4x0_save_state,
+    .load_state    = i4x0_load_state
 };
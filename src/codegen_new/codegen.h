@@ -38,6 +38,9 @@ typedef struct codeblock_t {
     uint16_t flags;
     uint8_t  ins;
     uint8_t  TOP;
+    /*Saturating execution count, halved each time the eviction hand passes.
+      The block is only evicted once it is zero*/
+    uint8_t  age;
 
     /*Pointers for codeblock tree, used to search for blocks when hash lookup
       fails.*/
@@ -308,9 +311,11 @@ extern void codegen_check_seg_read(codeblock_t *block, struct ir_data_t *ir, x86
 extern void codegen_check_seg_write(codeblock_t *block, struct ir_data_t *ir, x86seg *seg);
 
 extern int codegen_purge_purgable_list(void);
-/*Delete a random code block to free memory. This is obviously quite expensive, and
-  will only be called when the allocator is out of memory*/
-extern void codegen_delete_random_block(int required_mem_block);
+/*Evict a code block to free a block or memory. Blocks are visited in a circle,
+  and executed blocks are passed over until they have aged, so that hot code
+  stays in the cache and cold code (BIOS, one-shot initialisation) goes first.
+  Only called when the free list or the allocator is empty*/
+extern void codegen_evict_block(int required_mem_block);
 
 extern int      cpu_block_end;
 extern uint32_t codegen_endpc;
@@ -25,21 +25,34 @@ typedef struct mem_block_t {
     uint16_t code_block;
 } mem_block_t;
 
-static mem_block_t mem_blocks[MEM_BLOCK_NR];
-static uint32_t    mem_block_free_list;
-static uint8_t    *mem_block_alloc = NULL;
+static mem_block_t *mem_blocks;
+static uint32_t     mem_block_nr;
+static uint32_t     mem_block_free_list;
+static uint8_t     *mem_block_alloc = NULL;
 
 int codegen_allocator_usage = 0;
 
 void
 codegen_allocator_init(void)
 {
-    mem_block_alloc = plat_mmap(MEM_BLOCK_NR * MEM_BLOCK_SIZE, 1);
-
-    for (uint32_t c = 0; c < MEM_BLOCK_NR; c++) {
+    /* The size comes from the configuration, in MB; the jump range of the
+       host architecture still caps it at MEM_BLOCK_NR blocks. */
+    if (cpu_dynarec_cache > 0)
+        mem_block_nr = ((uint64_t) cpu_dynarec_cache << 20) / MEM_BLOCK_SIZE;
+    else
+        mem_block_nr = MEM_BLOCK_NR;
+    if (mem_block_nr < MEM_BLOCK_NR_MIN)
+        mem_block_nr = MEM_BLOCK_NR_MIN;
+    else if (mem_block_nr > MEM_BLOCK_NR)
+        mem_block_nr = MEM_BLOCK_NR;
+
+    mem_blocks      = malloc(mem_block_nr * sizeof(mem_block_t));
+    mem_block_alloc = plat_mmap(mem_block_nr * MEM_BLOCK_SIZE, 1);
+
+    for (uint32_t c = 0; c < mem_block_nr; c++) {
         mem_blocks[c].offset     = c * MEM_BLOCK_SIZE;
         mem_blocks[c].code_block = BLOCK_INVALID;
-        if (c < MEM_BLOCK_NR - 1)
+        if (c < mem_block_nr - 1)
             mem_blocks[c].next = c + 2;
         else
             mem_blocks[c].next = 0;
@@ -53,14 +66,10 @@ codegen_allocator_allocate(mem_block_t *parent, int code_block)
     mem_block_t *block;
     uint32_t     block_nr;
 
-    while (!mem_block_free_list) {
-        /*Pick a random memory block and free the owning code block*/
-        block_nr = rand() & MEM_BLOCK_MASK;
-        block    = &mem_blocks[block_nr];
-
-        if (block->code_block && block->code_block != code_block)
-            codegen_delete_block(&codeblock[block->code_block]);
-    }
+    /*Out of memory, evict the coldest code block that owns some. code_block
+      is always the block being recompiled, which is never evicted*/
+    while (!mem_block_free_list)
+        codegen_evict_block(1);
 
     /*Remove from free list*/
     block_nr            = mem_block_free_list;
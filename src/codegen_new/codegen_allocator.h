@@ -19,7 +19,9 @@
 #    define MEM_BLOCK_NR 131072
 #endif
 
-#define MEM_BLOCK_MASK (MEM_BLOCK_NR - 1)
+/*Smallest allowed allocation, 8 MB*/
+#define MEM_BLOCK_NR_MIN 8192
+
 #define MEM_BLOCK_SIZE 0x3c0
 
 void codegen_allocator_init(void);
@@ -57,6 +57,14 @@ static int      last_ssegs;
 uint32_t instr_counts[256 * 256];
 #endif
 
+codegen_stats_t codegen_stats;
+
+/*Eviction hand, sweeping the code blocks in a circle when space is needed.*/
+static int evict_hand = 1;
+/*Hashes of the physical addresses of evicted blocks, so that recompiling
+  code that was evicted before can be counted. Collisions make it approximate.*/
+static uint8_t evicted_map[HASH_SIZE / 8];
+
 static uint16_t block_free_list;
 static void     delete_block(codeblock_t *block);
 static void     delete_dirty_block(codeblock_t *block);
@@ -204,7 +212,7 @@ block_free_list_get(void)
         }
         /*Free list is empty - free up a block*/
         if (!codegen_purge_purgable_list())
-            codegen_delete_random_block(0);
+            codegen_evict_block(0);
     }
 
     block           = &codeblock[block_free_list];
@@ -432,20 +440,34 @@ codegen_delete_block(codeblock_t *block)
 }
 
 void
-codegen_delete_random_block(int required_mem_block)
+codegen_evict_block(int required_mem_block)
 {
-    int block_nr = rand() & BLOCK_MASK;
-
     while (1) {
+        int block_nr = evict_hand;
+
+        evict_hand = (evict_hand + 1) & BLOCK_MASK;
+
         if (block_nr && block_nr != block_current) {
             codeblock_t *block = &codeblock[block_nr];
 
             if (block->pc != BLOCK_PC_INVALID && (!required_mem_block || block->head_mem_block)) {
+                /*Blocks executed since the hand last passed get another
+                  chance, for longer the more they ran*/
+                if (block->age) {
+                    block->age >>= 1;
+                    continue;
+                }
+
+                evicted_map[HASH(block->phys) >> 3] |= 1 << (HASH(block->phys) & 7);
+                if (required_mem_block)
+                    codegen_stats.evictions_mem++;
+                else
+                    codegen_stats.evictions++;
+
                 delete_block(block);
                 return;
             }
         }
-        block_nr = (block_nr + 1) & BLOCK_MASK;
     }
 }
 
@@ -529,6 +551,7 @@ codegen_block_init(uint32_t phys_addr)
     block->page_mask = block->page_mask2 = 0;
     block->flags                         = CODEBLOCK_STATIC_TOP;
     block->status                        = cpu_cur_status;
+    block->age                           = 0;
 
     recomp_page = block->phys & ~0xfff;
     codeblock_tree_add(block);
@@ -561,6 +584,12 @@ codegen_block_start_recompile(codeblock_t *block)
     block->head_mem_block = codegen_allocator_allocate(NULL, block_current);
     block->data           = codeblock_allocator_get_ptr(block->head_mem_block);
 
+    codegen_stats.recompiles++;
+    if (evicted_map[block_num >> 3] & (1 << (block_num & 7))) {
+        evicted_map[block_num >> 3] &= ~(1 << (block_num & 7));
+        codegen_stats.recompiles_evicted++;
+    }
+
     block->status = cpu_cur_status;
 
     block->page_mask = block->page_mask2 = 0;
@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
@@ -58,6 +59,347 @@ duplicate_uop(ir_data_t *ir, uop_t *uop, int offset)
     }
 }
 
+/*IR optimisation, run over the whole block before register allocation. This
+  folds constants through register versions, turns ALU register operands that
+  are known constants into immediates, and replaces repeated loads from the same
+  pointer with a copy of the earlier result. The latter only covers the
+  MOV_REG_PTR/MOVZX_REG_PTR_* uOPs, which are only emitted for code bytes read
+  through the LOAD_IMMEDIATE_FROM_RAM_* helpers; IREGs held in cpu_state are
+  loaded by the register allocator, which already keeps them in host registers
+  until the next barrier, and guest memory loads may hit MMIO, so neither is
+  touched here. Fused compare and branch uOPs are
+  left alone, as not every backend can encode an arbitrary compare immediate.
+  uOPs whose results are no longer read are left for
+  codegen_reg_process_dead_list() to remove.
+
+  Register versions are only assumed to hold their IR value in straight line
+  code. Everything known is forgotten at jump destinations, where a version
+  may not have been written on every path, and at barriers, where called
+  functions may have changed the registers behind the IR's back.*/
+#define OPT_LOADS_MAX 8
+
+typedef struct opt_load_t {
+    uint32_t type;
+    void    *p;
+    ir_reg_t dest;
+} opt_load_t;
+
+static uint32_t   opt_const_val[IREG_COUNT][256];
+static uint16_t   opt_const_gen[IREG_COUNT][256];
+static uint16_t   opt_gen;
+static uint8_t    opt_jump_target[UOP_NR_MAX + 1];
+static opt_load_t opt_loads[OPT_LOADS_MAX];
+static int        opt_loads_nr;
+
+static void
+opt_forget(void)
+{
+    if (!++opt_gen) {
+        memset(opt_const_gen, 0, sizeof(opt_const_gen));
+        opt_gen = 1;
+    }
+    opt_loads_nr = 0;
+}
+
+static inline int
+opt_is_dword(ir_reg_t ir_reg)
+{
+    return !ir_reg_is_invalid(ir_reg) && (IREG_GET_SIZE(ir_reg.reg) == IREG_SIZE_L) && reg_is_native_size(ir_reg);
+}
+
+static inline int
+opt_get_const(ir_reg_t ir_reg, uint32_t *val)
+{
+    if (!opt_is_dword(ir_reg) || (opt_const_gen[IREG_GET_REG(ir_reg.reg)][ir_reg.version] != opt_gen))
+        return 0;
+
+    *val = opt_const_val[IREG_GET_REG(ir_reg.reg)][ir_reg.version];
+    return 1;
+}
+
+static inline void
+opt_set_const(ir_reg_t ir_reg, uint32_t val)
+{
+    if (opt_is_dword(ir_reg)) {
+        opt_const_gen[IREG_GET_REG(ir_reg.reg)][ir_reg.version] = opt_gen;
+        opt_const_val[IREG_GET_REG(ir_reg.reg)][ir_reg.version] = val;
+    }
+}
+
+/*Returns non-zero if anything in (start, end] could observe register state or
+  skip part of the range*/
+static int
+opt_barrier_between(ir_data_t *ir, int start, int end)
+{
+    for (int c = start + 1; c <= end; c++) {
+        if ((ir->uops[c].type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER | UOP_TYPE_JUMP)) || opt_jump_target[c])
+            return 1;
+    }
+
+    return 0;
+}
+
+/*A read of ir_reg has been optimised out. If that was the last read then the
+  version may now be dead as well; temporaries are never written back, while
+  permanent registers are only dead if the next version overwrites them before
+  anything can see the value*/
+static void
+opt_drop_read(ir_data_t *ir, ir_reg_t ir_reg)
+{
+    int            reg     = IREG_GET_REG(ir_reg.reg);
+    int            version = ir_reg.version;
+    reg_version_t *regv    = &reg_version[reg][version];
+
+    regv->refcount--;
+    if (regv->refcount || !version || (regv->flags & (REG_FLAGS_REQUIRED | REG_FLAGS_DEAD)))
+        return;
+
+    if (reg_is_volatile(reg)) {
+        add_to_dead_list(regv, reg, version);
+    } else if (reg > IREG_EBX && version < reg_last_version[reg]) {
+        int next_uop = reg_version[reg][version + 1].parent_uop;
+
+        if (reg_is_native_size(ir->uops[next_uop].dest_reg_a) && !opt_barrier_between(ir, regv->parent_uop, next_uop))
+            add_to_dead_list(regv, reg, version);
+    }
+}
+
+static void
+opt_fold(ir_data_t *ir, uop_t *uop, uint32_t val)
+{
+    if (!ir_reg_is_invalid(uop->src_reg_a))
+        opt_drop_read(ir, uop->src_reg_a);
+    if (!ir_reg_is_invalid(uop->src_reg_b))
+        opt_drop_read(ir, uop->src_reg_b);
+
+    uop->type      = UOP_MOV_IMM;
+    uop->src_reg_a = invalid_ir_reg;
+    uop->src_reg_b = invalid_ir_reg;
+    uop->imm_data  = val;
+    opt_set_const(uop->dest_reg_a, val);
+    codegen_stats.ir_folded++;
+}
+
+/*Replace a constant register operand of a two operand uOP with an immediate.
+  Operands are swapped first for commutative operations*/
+static int
+opt_to_imm(ir_data_t *ir, uop_t *uop, uint32_t imm_type, int commutative)
+{
+    uint32_t imm;
+
+    if (!opt_is_dword(uop->src_reg_a) || !opt_is_dword(uop->src_reg_b))
+        return 0;
+
+    if (opt_get_const(uop->src_reg_b, &imm)) {
+        opt_drop_read(ir, uop->src_reg_b);
+    } else if (commutative && opt_get_const(uop->src_reg_a, &imm)) {
+        opt_drop_read(ir, uop->src_reg_a);
+        uop->src_reg_a = uop->src_reg_b;
+    } else
+        return 0;
+
+    uop->type      = imm_type;
+    uop->src_reg_b = invalid_ir_reg;
+    uop->imm_data  = imm;
+    return 1;
+}
+
+static void
+opt_alu(ir_data_t *ir, uop_t *uop, uint32_t imm_type, int commutative)
+{
+    uint32_t a;
+    uint32_t b;
+
+    if (!opt_is_dword(uop->dest_reg_a))
+        return;
+
+    if (opt_get_const(uop->src_reg_a, &a) && opt_get_const(uop->src_reg_b, &b)) {
+        switch (uop->type & UOP_MASK) {
+            case (UOP_ADD & UOP_MASK):
+                opt_fold(ir, uop, a + b);
+                break;
+            case (UOP_SUB & UOP_MASK):
+                opt_fold(ir, uop, a - b);
+                break;
+            case (UOP_AND & UOP_MASK):
+                opt_fold(ir, uop, a & b);
+                break;
+            case (UOP_OR & UOP_MASK):
+                opt_fold(ir, uop, a | b);
+                break;
+            case (UOP_XOR & UOP_MASK):
+                opt_fold(ir, uop, a ^ b);
+                break;
+
+            default:
+                break;
+        }
+    } else if (opt_to_imm(ir, uop, imm_type, commutative))
+        codegen_stats.ir_folded++;
+}
+
+static void
+opt_alu_imm(ir_data_t *ir, uop_t *uop)
+{
+    uint32_t a;
+    uint32_t imm = uop->imm_data;
+
+    if (!opt_is_dword(uop->dest_reg_a) || !opt_get_const(uop->src_reg_a, &a))
+        return;
+
+    switch (uop->type & UOP_MASK) {
+        case (UOP_MOV & UOP_MASK):
+            opt_fold(ir, uop, a);
+            break;
+        case (UOP_ADD_IMM & UOP_MASK):
+            opt_fold(ir, uop, a + imm);
+            break;
+        case (UOP_SUB_IMM & UOP_MASK):
+            opt_fold(ir, uop, a - imm);
+            break;
+        case (UOP_AND_IMM & UOP_MASK):
+            opt_fold(ir, uop, a & imm);
+            break;
+        case (UOP_OR_IMM & UOP_MASK):
+            opt_fold(ir, uop, a | imm);
+            break;
+        case (UOP_XOR_IMM & UOP_MASK):
+            opt_fold(ir, uop, a ^ imm);
+            break;
+        case (UOP_SHL_IMM & UOP_MASK):
+            if (imm < 32)
+                opt_fold(ir, uop, a << imm);
+            break;
+        case (UOP_SHR_IMM & UOP_MASK):
+            if (imm < 32)
+                opt_fold(ir, uop, a >> imm);
+            break;
+        case (UOP_SAR_IMM & UOP_MASK):
+            if (imm < 32)
+                opt_fold(ir, uop, (uint32_t) ((int32_t) a >> imm));
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*Returns non-zero if version ir_reg has not been overwritten by uOP uop_nr*/
+static int
+opt_version_current(ir_reg_t ir_reg, int uop_nr)
+{
+    int reg = IREG_GET_REG(ir_reg.reg);
+
+    return (ir_reg.version == reg_last_version[reg]) || (reg_version[reg][ir_reg.version + 1].parent_uop > uop_nr);
+}
+
+static void
+opt_load(uop_t *uop, int uop_nr)
+{
+    uint32_t type = uop->type & UOP_MASK;
+
+    for (int c = 0; c < opt_loads_nr; c++) {
+        opt_load_t    *load = &opt_loads[c];
+        reg_version_t *regv = &reg_version[IREG_GET_REG(load->dest.reg)][load->dest.version];
+
+        /*A version that is not read yet may already be on the dead list, so
+          only reuse ones that are*/
+        if ((load->type == type) && (load->p == uop->p) && (IREG_GET_SIZE(load->dest.reg) == IREG_GET_SIZE(uop->dest_reg_a.reg)) && opt_version_current(load->dest, uop_nr) && regv->refcount && (regv->refcount < REG_REFCOUNT_MAX)) {
+            regv->refcount++;
+            uop->type      = UOP_MOV;
+            uop->src_reg_a = load->dest;
+            uop->p         = NULL;
+            codegen_stats.ir_loads++;
+            return;
+        }
+    }
+
+    if (opt_loads_nr < OPT_LOADS_MAX) {
+        opt_loads[opt_loads_nr].type = type;
+        opt_loads[opt_loads_nr].p    = uop->p;
+        opt_loads[opt_loads_nr].dest = uop->dest_reg_a;
+        opt_loads_nr++;
+    }
+}
+
+static void
+codegen_ir_optimise(ir_data_t *ir)
+{
+    memset(opt_jump_target, 0, ir->wr_pos + 1);
+    for (int c = 0; c < ir->wr_pos; c++) {
+        const uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_TYPE_JUMP) && (uop->jump_dest_uop >= 0) && (uop->jump_dest_uop <= ir->wr_pos))
+            opt_jump_target[uop->jump_dest_uop] = 1;
+    }
+
+    opt_forget();
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        uop_t *uop = &ir->uops[c];
+
+        if (opt_jump_target[c] || (uop->type & UOP_TYPE_BARRIER))
+            opt_forget();
+
+        switch (uop->type & UOP_MASK) {
+            case (UOP_MOV_IMM & UOP_MASK):
+                opt_set_const(uop->dest_reg_a, uop->imm_data);
+                break;
+
+            case (UOP_MOV & UOP_MASK):
+            case (UOP_ADD_IMM & UOP_MASK):
+            case (UOP_SUB_IMM & UOP_MASK):
+            case (UOP_AND_IMM & UOP_MASK):
+            case (UOP_OR_IMM & UOP_MASK):
+            case (UOP_XOR_IMM & UOP_MASK):
+            case (UOP_SHL_IMM & UOP_MASK):
+            case (UOP_SHR_IMM & UOP_MASK):
+            case (UOP_SAR_IMM & UOP_MASK):
+                opt_alu_imm(ir, uop);
+                break;
+
+            case (UOP_ADD & UOP_MASK):
+                opt_alu(ir, uop, UOP_ADD_IMM, 1);
+                break;
+            case (UOP_SUB & UOP_MASK):
+                opt_alu(ir, uop, UOP_SUB_IMM, 0);
+                break;
+            case (UOP_AND & UOP_MASK):
+                opt_alu(ir, uop, UOP_AND_IMM, 1);
+                break;
+            case (UOP_OR & UOP_MASK):
+                opt_alu(ir, uop, UOP_OR_IMM, 1);
+                break;
+            case (UOP_XOR & UOP_MASK):
+                opt_alu(ir, uop, UOP_XOR_IMM, 1);
+                break;
+
+            case (UOP_MOV_REG_PTR & UOP_MASK):
+            case (UOP_MOVZX_REG_PTR_8 & UOP_MASK):
+            case (UOP_MOVZX_REG_PTR_16 & UOP_MASK):
+                opt_load(uop, c);
+                break;
+
+            case (UOP_STORE_P_IMM & UOP_MASK):
+            case (UOP_STORE_P_IMM_8 & UOP_MASK):
+            case (UOP_STORE_P_IMM_16 & UOP_MASK):
+            case (UOP_MEM_STORE_ABS & UOP_MASK):
+            case (UOP_MEM_STORE_REG & UOP_MASK):
+            case (UOP_MEM_STORE_IMM_8 & UOP_MASK):
+            case (UOP_MEM_STORE_IMM_16 & UOP_MASK):
+            case (UOP_MEM_STORE_IMM_32 & UOP_MASK):
+            case (UOP_MEM_STORE_SINGLE & UOP_MASK):
+            case (UOP_MEM_STORE_DOUBLE & UOP_MASK):
+                /*Loads are only tracked by pointer, so any store may alias*/
+                opt_loads_nr = 0;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
 void
 codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 {
@@ -81,6 +423,9 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_reg_mark_as_required();
+    codegen_stats.ir_uops += ir->wr_pos;
+    if (cpu_dynarec_opt)
+        codegen_ir_optimise(ir);
     codegen_reg_process_dead_list(ir);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
@@ -106,6 +451,8 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
         if ((uop->type & UOP_MASK) == UOP_INVALID)
             continue;
 
+        codegen_stats.ir_uops_emitted++;
+
 #ifdef CODEGEN_BACKEND_HAS_MOV_IMM
         if ((uop->type & UOP_MASK) == (UOP_MOV_IMM & UOP_MASK) && reg_is_native_size(uop->dest_reg_a) && !codegen_reg_is_loaded(uop->dest_reg_a) && reg_version[IREG_GET_REG(uop->dest_reg_a.reg)][uop->dest_reg_a.version].refcount <= 0) {
             /*Special case for UOP_MOV_IMM - if destination not already in host register
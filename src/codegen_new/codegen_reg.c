@@ -192,6 +192,12 @@ codegen_reg_mark_as_required(void)
     }
 }
 
+int
+reg_is_volatile(int reg)
+{
+    return (ireg_data[IREG_GET_REG(reg)].is_volatile == REG_VOLATILE);
+}
+
 int
 reg_is_native_size(ir_reg_t ir_reg)
 {
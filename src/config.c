@@ -40,6 +40,7 @@
 #include "cpu.h"
 #include <86box/device.h>
 #include <86box/timer.h>
+#include <86box/mem.h>
 #include <86box/cassette.h>
 #include <86box/cartridge.h>
 #include <86box/nvr.h>
@@ -212,6 +213,16 @@ load_general(void)
 
     do_auto_pause = ini_section_get_int(cat, "do_auto_pause", 0);
 
+    p = ini_section_get_string(cat, "ram_advice", "none");
+    if (!strcmp(p, "mergeable"))
+        ram_advice = RAM_ADVICE_MERGEABLE;
+    else if (!strcmp(p, "hugepage"))
+        ram_advice = RAM_ADVICE_HUGEPAGE;
+    else
+        ram_advice = RAM_ADVICE_NONE;
+
+    rom_mmap = !!ini_section_get_int(cat, "rom_mmap", 0);
+
     p = ini_section_get_string(cat, "uuid", NULL);
     if (p != NULL)
         strncpy(uuid, p, sizeof(uuid) - 1);
@@ -389,7 +400,10 @@ load_machine(void)
     if (mem_size > machine_get_max_ram(machine))
         mem_size = machine_get_max_ram(machine);
 
-    cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_use_dynarec   = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_dynarec_cache = ini_section_get_int(cat, "cpu_dynarec_cache", 0);
+    cpu_dynarec_opt   = !!ini_section_get_int(cat, "cpu_dynarec_opt", 1);
+    cachesize         = ini_section_get_int(cat, "cpu_tlb_entries", MMU_TLB_DEFAULT);
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
@@ -660,6 +674,10 @@ load_network(void)
                 nc->net_type = NET_TYPE_SLIRP;
             else if (!strcmp(p, "vde") || !strcmp(p, "2"))
                 nc->net_type = NET_TYPE_VDE;
+            else if (!strcmp(p, "tap"))
+                nc->net_type = NET_TYPE_TAP;
+            else if (!strcmp(p, "vswitch"))
+                nc->net_type = NET_TYPE_VSWITCH;
             else
                 nc->net_type = NET_TYPE_NONE;
         } else
@@ -706,6 +724,10 @@ load_network(void)
                 nc->net_type = NET_TYPE_SLIRP;
             else if (!strcmp(p, "vde") || !strcmp(p, "2"))
                 nc->net_type = NET_TYPE_VDE;
+            else if (!strcmp(p, "tap"))
+                nc->net_type = NET_TYPE_TAP;
+            else if (!strcmp(p, "vswitch"))
+                nc->net_type = NET_TYPE_VSWITCH;
             else
                 nc->net_type = NET_TYPE_NONE;
         } else
@@ -733,6 +755,9 @@ load_network(void)
                                              (NET_LINK_10_HD | NET_LINK_10_FD |
                                               NET_LINK_100_HD | NET_LINK_100_FD |
                                               NET_LINK_1000_HD | NET_LINK_1000_FD));
+
+        sprintf(temp, "net_%02i_queue_len", c + 1);
+        nc->queue_len = ini_section_get_int(cat, temp, NET_QUEUE_LEN_DEFAULT);
     }
 }
 
@@ -1689,6 +1714,7 @@ load_other_peripherals(void)
 void
 config_load(void)
 {
+    char          temp[1024];
     int           i;
     ini_section_t c;
 
@@ -1701,7 +1727,11 @@ config_load(void)
 #endif
     memset(zip_drives, 0, sizeof(zip_drive_t));
 
-    config = ini_read(cfg_path);
+    if (cfg_cache) {
+        snprintf(temp, sizeof(temp), "%s.cache", cfg_path);
+        config = ini_read_cached(cfg_path, temp);
+    } else
+        config = ini_read(cfg_path);
 
     if (!config) {
         config         = ini_new();
@@ -1979,6 +2009,18 @@ save_general(void)
     else
         ini_section_delete_var(cat, "do_auto_pause");
 
+    if (ram_advice == RAM_ADVICE_MERGEABLE)
+        ini_section_set_string(cat, "ram_advice", "mergeable");
+    else if (ram_advice == RAM_ADVICE_HUGEPAGE)
+        ini_section_set_string(cat, "ram_advice", "hugepage");
+    else
+        ini_section_delete_var(cat, "ram_advice");
+
+    if (rom_mmap)
+        ini_section_set_int(cat, "rom_mmap", rom_mmap);
+    else
+        ini_section_delete_var(cat, "rom_mmap");
+
     char cpu_buf[128] = { 0 };
     plat_get_cpu_string(cpu_buf, 128);
     ini_section_set_string(cat, "host_cpu", cpu_buf);
@@ -2067,6 +2109,21 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cpu_dynarec_cache == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_cache");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_cache", cpu_dynarec_cache);
+
+    if (cpu_dynarec_opt)
+        ini_section_delete_var(cat, "cpu_dynarec_opt");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_opt", cpu_dynarec_opt);
+
+    if (cachesize == MMU_TLB_DEFAULT)
+        ini_section_delete_var(cat, "cpu_tlb_entries");
+    else
+        ini_section_set_int(cat, "cpu_tlb_entries", cachesize);
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
@@ -2309,6 +2366,12 @@ save_network(void)
             case NET_TYPE_VDE:
                 ini_section_set_string(cat, temp, "vde");
                 break;
+            case NET_TYPE_TAP:
+                ini_section_set_string(cat, temp, "tap");
+                break;
+            case NET_TYPE_VSWITCH:
+                ini_section_set_string(cat, temp, "vswitch");
+                break;
 
             default:
                 break;
@@ -2330,6 +2393,12 @@ save_network(void)
             ini_section_delete_var(cat, temp);
         else
             ini_section_set_int(cat, temp, nc->link_state);
+
+        sprintf(temp, "net_%02i_queue_len", c + 1);
+        if ((nc->queue_len <= 0) || (nc->queue_len == NET_QUEUE_LEN_DEFAULT))
+            ini_section_delete_var(cat, temp);
+        else
+            ini_section_set_int(cat, temp, nc->queue_len);
     }
 
     ini_delete_section_if_empty(config, cat);
@@ -219,6 +219,40 @@ int checkio(uint32_t port, int mask);
         }                                                            \
     }
 
+/* REP INS/OUTS hand up to this many bytes at a time to the block handler of
+   the port, if it has one. */
+#define REP_IO_BLOCK_SIZE 512
+
+/* Returns the number of units of a REP INS/OUTS that can be moved as a block
+   starting at base:addr, whose first unit has already been checked. The block
+   has to go forwards and stay within that unit's page, the segment limit and
+   the address size, so that none of the following units can fault; single
+   stepping and data breakpoints need the per unit path. */
+static __inline int
+rep_io_block_count(uint32_t base, uint32_t addr, int addr_size, uint32_t limit_high, uint32_t count, int size)
+{
+    uint64_t end = (addr_size == 2) ? 0xffff : 0xffffffff;
+    uint32_t n   = REP_IO_BLOCK_SIZE / size;
+    uint32_t max;
+
+    if ((cpu_state.flags & D_FLAG) || trap || (dr[7] & 0xff) || (base == 0xffffffff))
+        return 0;
+
+    if (limit_high < end)
+        end = limit_high;
+
+    if (count < n)
+        n = count;
+    max = (0x1000 - ((base + addr) & 0xfff)) / size;
+    if (max < n)
+        n = max;
+    max = (uint32_t) ((end + 1 - addr) / size);
+    if (max < n)
+        n = max;
+
+    return (int) n;
+}
+
 #define SEG_CHECK_READ(seg)                  \
     do {                                     \
         if ((seg)->base == 0xffffffff) {     \
@@ -297,16 +331,44 @@ int checkio(uint32_t port, int mask);
     }
 
 #ifdef OPS_286_386
-/* TODO: Introduce functions to read exec. */
+/*
+ * Code fetches read the cached host copy of the current code page when
+ * nothing needs to see the individual accesses: no debug registers armed, no
+ * paging change pending, and no access running into the next page. The
+ * misalignment penalty of the equivalent memory access is still charged.
+ */
+static __inline int
+pccache_hit_2386(uint32_t a, int len)
+{
+#    ifdef USE_GDBSTUB
+    return 0;
+#    else
+    return ((a >> 12) == pccache_2386) && pccache2_2386 && (((a & 0xfff) + len) <= 0x1000) &&
+           !(dr[7] & 0xff) && !cpu_flush_pending && (pccache_user_2386 == (CPL == 3));
+#    endif
+}
+
+static __inline void
+pccache_fill_2386(uint32_t a)
+{
+#    ifndef USE_GDBSTUB
+    if (!cpu_state.abrt && ((a >> 12) != pccache_2386) && !(dr[7] & 0xff) && !cpu_flush_pending)
+        getpccache_2386(a);
+#    endif
+}
+
 static __inline uint8_t
 fastreadb(uint32_t a)
 {
     uint8_t ret;
+    if (pccache_hit_2386(a, 1))
+        return pccache2_2386[a & 0xfff];
     read_type = 1;
     ret = readmembl_2386(a);
     read_type = 4;
     if (cpu_state.abrt)
         return 0;
+    pccache_fill_2386(a);
     return ret;
 }
 
@@ -314,11 +376,17 @@ static __inline uint16_t
 fastreadw(uint32_t a)
 {
     uint16_t ret;
+    if (pccache_hit_2386(a, 2)) {
+        if ((a & 1) && (!cpu_cyrix_alignment || (a & 7) == 7))
+            cycles -= timing_misaligned;
+        return *(uint16_t *) &pccache2_2386[a & 0xfff];
+    }
     read_type = 1;
     ret = readmemwl_2386(a);
     read_type = 4;
     if (cpu_state.abrt)
         return 0;
+    pccache_fill_2386(a);
     return ret;
 }
 
@@ -326,11 +394,17 @@ static __inline uint32_t
 fastreadl(uint32_t a)
 {
     uint32_t ret;
+    if (pccache_hit_2386(a, 4)) {
+        if ((a & 3) && (!cpu_cyrix_alignment || (a & 7) > 4))
+            cycles -= timing_misaligned;
+        return *(uint32_t *) &pccache2_2386[a & 0xfff];
+    }
     read_type = 1;
     ret = readmemll_2386(a);
     read_type = 4;
     if (cpu_state.abrt)
         return 0;
+    pccache_fill_2386(a);
     return ret;
 }
 #else
@@ -465,10 +539,13 @@ fastreadw_fetch(uint32_t a)
             ret |= ((uint16_t) fastreadb(a + 1) << 8);
     } else if (cpu_state.abrt)
         ret = 0;
+    else if (pccache_hit_2386(a, 2))
+        ret = fastreadw(a);
     else {
         read_type = 1;
         ret = readmemwl_2386(a);
         read_type = 4;
+        pccache_fill_2386(a);
     }
     cpu_old_paging = 0;
 
@@ -486,12 +563,15 @@ fastreadl_fetch(uint32_t a)
             ret |= ((uint32_t) fastreadw(a + 2) << 16);
     } else if (cpu_state.abrt)
         ret = 0;
+    else if (pccache_hit_2386(a, 4))
+        ret = fastreadl(a);
     else {
         read_type = 1;
         cpu_old_paging = (cpu_flush_pending == 2);
         ret = readmemll_2386(a);
         cpu_old_paging = 0;
         read_type = 4;
+        pccache_fill_2386(a);
     }
 
     return ret;
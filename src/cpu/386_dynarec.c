@@ -31,6 +31,7 @@
 #include <86box/machine.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/gdbstub.h>
+#include <minitrace/minitrace.h>
 #ifdef USE_DYNAREC
 #    include "codegen.h"
 #    ifdef USE_NEW_DYNAREC
@@ -508,6 +509,9 @@ exec386_dynarec_dyn(void)
     }
 
 #    ifdef USE_NEW_DYNAREC
+    if (valid_block && (block->age != 0xff))
+        block->age++;
+
     if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED))
 #    else
     if (valid_block && block->was_recompiled)
@@ -545,6 +549,7 @@ exec386_dynarec_dyn(void)
             pthread_jit_write_protect_np(0);
         }
 #    endif
+        MTR_BEGIN("dynarec", "recompile");
         codegen_block_start_recompile(block);
         codegen_in_recompile = 1;
 
@@ -625,10 +630,13 @@ exec386_dynarec_dyn(void)
         if ((!cpu_state.abrt || (cpu_state.abrt & ABRT_EXPECTED)) && !x86_was_reset)
             codegen_block_end_recompile(block);
 
-        if (x86_was_reset)
+        if (x86_was_reset) {
+            MTR_INSTANT("dynarec", "codegen_reset");
             codegen_reset();
+        }
 
         codegen_in_recompile = 0;
+        MTR_END("dynarec", "recompile");
 #    if defined(__APPLE__) && defined(__aarch64__)
         if (__builtin_available(macOS 11.0, *)) {
             pthread_jit_write_protect_np(1);
@@ -725,8 +733,10 @@ exec386_dynarec_dyn(void)
         if ((!cpu_state.abrt || (cpu_state.abrt & ABRT_EXPECTED)) && !x86_was_reset)
             codegen_block_end();
 
-        if (x86_was_reset)
+        if (x86_was_reset) {
+            MTR_INSTANT("dynarec", "codegen_reset");
             codegen_reset();
+        }
     }
 #    ifdef USE_NEW_DYNAREC
     else
@@ -15,6 +15,7 @@
  *          Copyright 2015-2020 Andrew Jenner.
  *          Copyright 2016-2020 Miran Grca.
  */
+#include <limits.h>
 #include <math.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -68,6 +69,9 @@ static int       prefetching = 1, completed = 1;
 static int       in_rep = 0, repeating = 0, rep_c_flag = 0;
 static int       oldc, clear_lock = 0;
 static int       refresh = 0, cycdiff;
+static int       clock_pending = 0, clock_budget = 0;
+static uint32_t  clock_target;
+static uint64_t  clock_mult;
 
 /* Various things needed for 8087. */
 #define OP_TABLE(name) ops_##name
@@ -159,21 +163,77 @@ get_last_addr(void)
     return last_addr;
 }
 
+/*
+ * The timer is synchronized lazily: clock_end() only accumulates the cycles
+ * spent into clock_pending, and tsc is brought up to date once enough of them
+ * have gone by to reach timer_target (clock_budget, computed once per timer
+ * deadline), or when timer_target or xt_cpu_multi changes, as the budget is
+ * only valid for the deadline and the multiplier it was computed with (turbo
+ * switches from I/O handlers change the latter). Before anything that can
+ * look at tsc - an I/O port or a memory mapping that is not plain RAM/ROM -
+ * clock_sync() applies the pending cycles without running any timers, so
+ * devices see exactly the same tsc, and timers fire at exactly the same
+ * point, as with a synchronization on every bus cycle.
+ */
 static void
-clock_start(void)
+clock_sync(void)
 {
-    cycdiff = cycles;
+    /* On 808x systems, clock speed is usually crystal frequency divided by an integer. */
+    tsc += (uint64_t) clock_pending * ((uint64_t) xt_cpu_multi >> 32ULL); /* Shift xt_cpu_multi by 32 bits to the right and then multiply. */
+    clock_budget -= clock_pending;
+    clock_pending = 0;
 }
 
 static void
-clock_end(void)
+clock_rearm(void)
 {
-    int diff = cycdiff - cycles;
+    uint64_t mult  = (uint64_t) xt_cpu_multi >> 32ULL;
+    int32_t  delta = (int32_t) (timer_target - (uint32_t) tsc);
 
-    /* On 808x systems, clock speed is usually crystal frequency divided by an integer. */
-    tsc += (uint64_t) diff * ((uint64_t) xt_cpu_multi >> 32ULL); /* Shift xt_cpu_multi by 32 bits to the right and then multiply. */
+    clock_target = timer_target;
+    clock_mult   = xt_cpu_multi;
+    if (delta <= 0)
+        clock_budget = 0;
+    else if (mult == 0)
+        clock_budget = INT_MAX;
+    else
+        clock_budget = (int) (((uint64_t) delta + mult - 1) / mult);
+}
+
+static void
+clock_flush(void)
+{
+    clock_sync();
     if (TIMER_VAL_LESS_THAN_VAL(timer_target, (uint32_t) tsc))
         timer_process();
+    clock_rearm();
+}
+
+/* Brings tsc up to date if the access may end up in a device handler. */
+static __inline void
+clock_sync_mem(mem_mapping_t **mapping, uint32_t addr)
+{
+    const mem_mapping_t *map;
+
+    if (clock_pending) {
+        map = mapping[(addr & rammask) >> MEM_GRANULARITY_BITS];
+        if (map && !map->exec)
+            clock_sync();
+    }
+}
+
+static void
+clock_start(void)
+{
+    cycdiff = cycles;
+}
+
+static void
+clock_end(void)
+{
+    clock_pending += cycdiff - cycles;
+    if ((clock_pending >= clock_budget) || (timer_target != clock_target) || (xt_cpu_multi != clock_mult))
+        clock_flush();
 }
 
 static void
@@ -243,15 +303,18 @@ cpu_io(int bits, int out, uint16_t port)
         wait(4, 1);
         if (bits == 16) {
             if (is8086 && !(port & 1)) {
+                clock_sync();
                 old_cycles = cycles;
                 outw(port, AX);
             } else {
                 wait(4, 1);
+                clock_sync();
                 old_cycles = cycles;
                 outb(port++, AL);
                 outb(port, AH);
             }
         } else {
+            clock_sync();
             old_cycles = cycles;
             outb(port, AL);
         }
@@ -259,15 +322,18 @@ cpu_io(int bits, int out, uint16_t port)
         wait(4, 1);
         if (bits == 16) {
             if (is8086 && !(port & 1)) {
+                clock_sync();
                 old_cycles = cycles;
                 AX         = inw(port);
             } else {
                 wait(4, 1);
+                clock_sync();
                 old_cycles = cycles;
                 AL         = inb(port++);
                 AH         = inb(port);
             }
         } else {
+            clock_sync();
             old_cycles = cycles;
             AL         = inb(port);
         }
@@ -283,6 +349,7 @@ readmemb(uint32_t a)
     uint8_t ret;
 
     wait(4, 1);
+    clock_sync_mem(read_mapping, a);
     ret = read_mem_b(a);
 
     return ret;
@@ -294,7 +361,8 @@ readmembf(uint32_t a)
 {
     uint8_t ret;
 
-    a   = cs + (a & 0xffff);
+    a = cs + (a & 0xffff);
+    clock_sync_mem(read_mapping, a);
     ret = read_mem_b(a);
 
     return ret;
@@ -307,11 +375,14 @@ readmemw(uint32_t s, uint16_t a)
     uint16_t ret;
 
     wait(4, 1);
-    if (is8086 && !(a & 1))
+    if (is8086 && !(a & 1)) {
+        clock_sync_mem(read_mapping, s + a);
         ret = read_mem_w(s + a);
-    else {
+    } else {
         wait(4, 1);
+        clock_sync_mem(read_mapping, s + a);
         ret = read_mem_b(s + a);
+        clock_sync_mem(read_mapping, s + ((is186 && !is_nec) ? (a + 1) : (a + 1) & 0xffff));
         ret |= read_mem_b(s + ((is186 && !is_nec) ? (a + 1) : (a + 1) & 0xffff)) << 8;
     }
 
@@ -323,6 +394,7 @@ readmemwf(uint16_t a)
 {
     uint16_t ret;
 
+    clock_sync_mem(read_mapping, cs + (a & 0xffff));
     ret = read_mem_w(cs + (a & 0xffff));
 
     return ret;
@@ -366,6 +438,7 @@ writememb(uint32_t s, uint32_t a, uint8_t v)
     uint32_t addr = s + a;
 
     wait(4, 1);
+    clock_sync_mem(write_mapping, addr);
     write_mem_b(addr, v);
 
     if ((addr >= 0xf0000) && (addr <= 0xfffff))
@@ -379,12 +452,14 @@ writememw(uint32_t s, uint32_t a, uint16_t v)
     uint32_t addr = s + a;
 
     wait(4, 1);
+    clock_sync_mem(write_mapping, addr);
     if (is8086 && !(a & 1))
         write_mem_w(addr, v);
     else {
         write_mem_b(addr, v & 0xff);
         wait(4, 1);
         addr = s + ((is186 && !is_nec) ? (a + 1) : ((a + 1) & 0xffff));
+        clock_sync_mem(write_mapping, addr);
         write_mem_b(addr, v >> 8);
     }
 
@@ -1643,6 +1718,7 @@ cpu_inw(uint16_t port)
         wait(8, 0);
     }
 
+    clock_sync();
     return inw(port);
 }
 
@@ -1655,6 +1731,7 @@ cpu_outw(uint16_t port, uint16_t val)
         wait(8, 0);
     }
 
+    clock_sync();
     return outw(port, val);
 }
 
@@ -1677,6 +1754,7 @@ execx86(int cycs)
     uint32_t srcseg, byteaddr;
 
     cycles += cycs;
+    clock_rearm();
 
     while (cycles > 0) {
         clock_start();
@@ -1805,6 +1883,7 @@ execx86(int cycs)
                         DI += (cpu_state.flags & D_FLAG) ? -2 : 2;
                     } else {
                         wait(4, 0);
+                        clock_sync();
                         writememb(es, DI, inb(DX));
                         DI += (cpu_state.flags & D_FLAG) ? -1 : 1;
                     }
@@ -1834,7 +1913,9 @@ execx86(int cycs)
                         SI += (cpu_state.flags & D_FLAG) ? -2 : 2;
                     } else {
                         wait(4, 0);
-                        outb(DX, readmemb(dest_seg + SI));
+                        temp = readmemb(dest_seg + SI);
+                        clock_sync();
+                        outb(DX, temp);
                         SI += (cpu_state.flags & D_FLAG) ? -1 : 1;
                     }
                     if (in_rep == 0)
@@ -2103,9 +2184,11 @@ execx86(int cycs)
                                 wait(5, 0);
                                 for (i = 0; i < ((nibbles_count / 2) + odd); i++) {
                                     wait(19, 0);
+                                    clock_sync_mem(read_mapping, es + DI + i);
                                     destcmp = read_mem_b((es) + DI + i);
                                     for (nibble = 0; nibble < 2; nibble++) {
                                         destbyte = destcmp >> (nibble ? 4 : 0);
+                                        clock_sync_mem(read_mapping, srcseg + SI + i);
                                         srcbyte  = read_mem_b(srcseg + SI + i) >> (nibble ? 4 : 0);
                                         destbyte &= 0xF;
                                         srcbyte &= 0xF;
@@ -2119,6 +2202,7 @@ execx86(int cycs)
                                             zero = (nibble_result == 0);
                                         destcmp = ((destcmp & (nibble ? 0x0F : 0xF0)) | (nibble_result << (4 * nibble)));
                                     }
+                                    clock_sync_mem(write_mapping, es + DI + i);
                                     write_mem_b(es + DI + i, destcmp);
                                 }
                                 set_cf(!!carry);
@@ -2138,9 +2222,11 @@ execx86(int cycs)
                                 wait(5, 0);
                                 for (i = 0; i < ((nibbles_count / 2) + odd); i++) {
                                     wait(19, 0);
+                                    clock_sync_mem(read_mapping, es + DI + i);
                                     destcmp = read_mem_b((es) + DI + i);
                                     for (nibble = 0; nibble < 2; nibble++) {
                                         destbyte = destcmp >> (nibble ? 4 : 0);
+                                        clock_sync_mem(read_mapping, srcseg + SI + i);
                                         srcbyte  = read_mem_b(srcseg + SI + i) >> (nibble ? 4 : 0);
                                         destbyte &= 0xF;
                                         srcbyte &= 0xF;
@@ -2154,6 +2240,7 @@ execx86(int cycs)
                                             zero = (nibble_result_s == 0);
                                         destcmp = ((destcmp & (nibble ? 0x0F : 0xF0)) | (nibble_result_s << (4 * nibble)));
                                     }
+                                    clock_sync_mem(write_mapping, es + DI + i);
                                     write_mem_b(es + DI + i, destcmp);
                                 }
                                 set_cf(!!carry);
@@ -2173,9 +2260,11 @@ execx86(int cycs)
                                 wait(5, 0);
                                 for (i = 0; i < ((nibbles_count / 2) + odd); i++) {
                                     wait(19, 0);
+                                    clock_sync_mem(read_mapping, es + DI + i);
                                     destcmp = read_mem_b((es) + DI + i);
                                     for (nibble = 0; nibble < 2; nibble++) {
                                         destbyte = destcmp >> (nibble ? 4 : 0);
+                                        clock_sync_mem(read_mapping, srcseg + SI + i);
                                         srcbyte  = read_mem_b(srcseg + SI + i) >> (nibble ? 4 : 0);
                                         destbyte &= 0xF;
                                         srcbyte &= 0xF;
@@ -2212,6 +2301,7 @@ execx86(int cycs)
                                 }
                                 for (i = 0; i < bit_length; i++) {
                                     byteaddr = (es) + DI;
+                                    clock_sync_mem(read_mapping, byteaddr);
                                     writememb(es, DI, (read_mem_b(byteaddr) & ~(1 << (bit_offset))) | ((!!(AX & (1 << i))) << bit_offset));
                                     bit_offset++;
                                     if (bit_offset == 8) {
@@ -3589,8 +3679,12 @@ execx86(int cycs)
         }
 
 #ifdef USE_GDBSTUB
-        if (gdbstub_instruction())
+        if (gdbstub_instruction()) {
+            clock_sync();
             return;
+        }
 #endif
     }
+
+    clock_sync();
 }
@@ -31,6 +31,7 @@
 #include "cpu.h"
 #include "x86.h"
 #include "x87_sf.h"
+#include "x87.h"
 #include <86box/device.h>
 #include <86box/machine.h>
 #include <86box/io.h>
@@ -42,6 +43,7 @@
 #include <86box/pci.h>
 #include <86box/timer.h>
 #include <86box/gdbstub.h>
+#include <86box/snapshot.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 
@@ -4391,3 +4393,137 @@ cpu_update_waitstates(void)
     if (cpu_s->rspeed <= 8000000)
         cpu_rom_prefetch_cycles = cpu_mem_prefetch_cycles;
 }
+
+void
+cpu_save_state(snapshot_t *s)
+{
+    SNAPSHOT_WRITE_VAR(s, cpu_state);
+    SNAPSHOT_WRITE_VAR(s, fpu_state);
+    SNAPSHOT_WRITE_VAR(s, msr);
+    SNAPSHOT_WRITE_VAR(s, cyrix);
+    SNAPSHOT_WRITE_VAR(s, tsc);
+
+    SNAPSHOT_WRITE_VAR(s, cr2);
+    SNAPSHOT_WRITE_VAR(s, cr3);
+    SNAPSHOT_WRITE_VAR(s, cr4);
+    SNAPSHOT_WRITE_VAR(s, dr);
+    SNAPSHOT_WRITE_VAR(s, _tr);
+    SNAPSHOT_WRITE_VAR(s, gdt);
+    SNAPSHOT_WRITE_VAR(s, ldt);
+    SNAPSHOT_WRITE_VAR(s, idt);
+    SNAPSHOT_WRITE_VAR(s, tr);
+    SNAPSHOT_WRITE_VAR(s, use32);
+    SNAPSHOT_WRITE_VAR(s, stack32);
+    SNAPSHOT_WRITE_VAR(s, oldcpl);
+    SNAPSHOT_WRITE_VAR(s, cpu_cur_status);
+
+    SNAPSHOT_WRITE_VAR(s, x87_pc_off);
+    SNAPSHOT_WRITE_VAR(s, x87_op_off);
+    SNAPSHOT_WRITE_VAR(s, x87_pc_seg);
+    SNAPSHOT_WRITE_VAR(s, x87_op_seg);
+
+    SNAPSHOT_WRITE_VAR(s, cache_index);
+    SNAPSHOT_WRITE_VAR(s, _cache);
+    SNAPSHOT_WRITE_VAR(s, ccr0);
+    SNAPSHOT_WRITE_VAR(s, ccr1);
+    SNAPSHOT_WRITE_VAR(s, ccr2);
+    SNAPSHOT_WRITE_VAR(s, ccr3);
+    SNAPSHOT_WRITE_VAR(s, ccr4);
+    SNAPSHOT_WRITE_VAR(s, ccr5);
+    SNAPSHOT_WRITE_VAR(s, ccr6);
+    SNAPSHOT_WRITE_VAR(s, cyrix_addr);
+
+    SNAPSHOT_WRITE_VAR(s, nmi);
+    SNAPSHOT_WRITE_VAR(s, nmi_mask);
+    SNAPSHOT_WRITE_VAR(s, nmi_enable);
+    SNAPSHOT_WRITE_VAR(s, in_sys);
+    SNAPSHOT_WRITE_VAR(s, unmask_a20_in_smm);
+    SNAPSHOT_WRITE_VAR(s, old_rammask);
+    SNAPSHOT_WRITE_VAR(s, smi_latched);
+    SNAPSHOT_WRITE_VAR(s, smm_in_hlt);
+    SNAPSHOT_WRITE_VAR(s, smi_block);
+
+    SNAPSHOT_WRITE_VAR(s, cpu_cache_int_enabled);
+    SNAPSHOT_WRITE_VAR(s, cpu_cache_ext_enabled);
+    SNAPSHOT_WRITE_VAR(s, cpu_waitstates);
+    SNAPSHOT_WRITE_VAR(s, cpu_fast_off_count);
+    SNAPSHOT_WRITE_VAR(s, cpu_fast_off_val);
+    SNAPSHOT_WRITE_VAR(s, cpu_fast_off_flags);
+}
+
+void
+cpu_load_state(snapshot_t *s)
+{
+    uint64_t new_tsc;
+
+    SNAPSHOT_READ_VAR(s, cpu_state);
+    /* The only pointer in the CPU state, it is reloaded by every instruction
+       that uses it. */
+    cpu_state.ea_seg = &cpu_state.seg_ds;
+    SNAPSHOT_READ_VAR(s, fpu_state);
+    SNAPSHOT_READ_VAR(s, msr);
+    SNAPSHOT_READ_VAR(s, cyrix);
+    SNAPSHOT_READ_VAR(s, new_tsc);
+
+    SNAPSHOT_READ_VAR(s, cr2);
+    SNAPSHOT_READ_VAR(s, cr3);
+    SNAPSHOT_READ_VAR(s, cr4);
+    SNAPSHOT_READ_VAR(s, dr);
+    SNAPSHOT_READ_VAR(s, _tr);
+    SNAPSHOT_READ_VAR(s, gdt);
+    SNAPSHOT_READ_VAR(s, ldt);
+    SNAPSHOT_READ_VAR(s, idt);
+    SNAPSHOT_READ_VAR(s, tr);
+    SNAPSHOT_READ_VAR(s, use32);
+    SNAPSHOT_READ_VAR(s, stack32);
+    SNAPSHOT_READ_VAR(s, oldcpl);
+    SNAPSHOT_READ_VAR(s, cpu_cur_status);
+
+    SNAPSHOT_READ_VAR(s, x87_pc_off);
+    SNAPSHOT_READ_VAR(s, x87_op_off);
+    SNAPSHOT_READ_VAR(s, x87_pc_seg);
+    SNAPSHOT_READ_VAR(s, x87_op_seg);
+
+    SNAPSHOT_READ_VAR(s, cache_index);
+    SNAPSHOT_READ_VAR(s, _cache);
+    SNAPSHOT_READ_VAR(s, ccr0);
+    SNAPSHOT_READ_VAR(s, ccr1);
+    SNAPSHOT_READ_VAR(s, ccr2);
+    SNAPSHOT_READ_VAR(s, ccr3);
+    SNAPSHOT_READ_VAR(s, ccr4);
+    SNAPSHOT_READ_VAR(s, ccr5);
+    SNAPSHOT_READ_VAR(s, ccr6);
+    SNAPSHOT_READ_VAR(s, cyrix_addr);
+
+    SNAPSHOT_READ_VAR(s, nmi);
+    SNAPSHOT_READ_VAR(s, nmi_mask);
+    SNAPSHOT_READ_VAR(s, nmi_enable);
+    SNAPSHOT_READ_VAR(s, in_sys);
+    SNAPSHOT_READ_VAR(s, unmask_a20_in_smm);
+    SNAPSHOT_READ_VAR(s, old_rammask);
+    SNAPSHOT_READ_VAR(s, smi_latched);
+    SNAPSHOT_READ_VAR(s, smm_in_hlt);
+    SNAPSHOT_READ_VAR(s, smi_block);
+
+    SNAPSHOT_READ_VAR(s, cpu_cache_int_enabled);
+    SNAPSHOT_READ_VAR(s, cpu_cache_ext_enabled);
+    SNAPSHOT_READ_VAR(s, cpu_waitstates);
+    SNAPSHOT_READ_VAR(s, cpu_fast_off_count);
+    SNAPSHOT_READ_VAR(s, cpu_fast_off_val);
+    SNAPSHOT_READ_VAR(s, cpu_fast_off_flags);
+
+    if (snapshot_error(s))
+        return;
+
+    /* Move the already running timers along with the TSC, the devices that
+       have state handlers will then restore their own timers. */
+    timer_set_new_tsc(new_tsc);
+
+    cpu_update_waitstates();
+    prefetch_flush();
+
+#ifdef USE_DYNAREC
+    if (cpu_use_dynarec)
+        codegen_reset();
+#endif
+}
@@ -559,6 +559,9 @@ extern uint32_t olddslimitw;
 extern uint32_t oldsslimitw;
 extern uint32_t pccache;
 extern uint8_t *pccache2;
+extern uint32_t pccache_2386;
+extern int      pccache_user_2386;
+extern uint8_t *pccache2_2386;
 
 extern double   bus_timing;
 extern double   isa_timing;
@@ -680,6 +683,11 @@ extern char *cpu_current_pc(char *bufp);
 extern void cpu_update_waitstates(void);
 extern void cpu_set(void);
 extern void cpu_close(void);
+
+struct snapshot_t;
+extern void cpu_save_state(struct snapshot_t *s);
+extern void cpu_load_state(struct snapshot_t *s);
+
 extern void cpu_set_isa_speed(int speed);
 extern void cpu_set_pci_speed(int speed);
 extern void cpu_set_isa_pci_div(int div);
@@ -692,6 +700,22 @@ extern void cpu_WRMSR(void);
 extern int  checkio(uint32_t port, int mask);
 extern void codegen_block_end(void);
 extern void codegen_reset(void);
+
+#ifdef USE_NEW_DYNAREC
+typedef struct codegen_stats_t {
+    uint64_t recompiles;         /* blocks compiled to host code */
+    uint64_t recompiles_evicted; /* of those, blocks that had been evicted before */
+    uint64_t evictions;          /* blocks evicted for lack of free code blocks */
+    uint64_t evictions_mem;      /* blocks evicted for lack of code memory */
+    uint64_t ir_uops;            /* uOPs generated */
+    uint64_t ir_uops_emitted;    /* uOPs left after optimisation */
+    uint64_t ir_folded;          /* uOPs folded to constants or immediates */
+    uint64_t ir_loads;           /* repeated loads replaced with copies */
+} codegen_stats_t;
+
+extern codegen_stats_t codegen_stats;
+#endif
+
 extern void cpu_set_edx(void);
 extern int  divl(uint32_t val);
 extern void execx86(int32_t cycs);
@@ -7,6 +7,8 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint8_t temp;                                                                                         \
+            uint8_t buf[REP_IO_BLOCK_SIZE];                                                                       \
+            int     n, k;                                                                                         \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX, 1);                                                                                 \
@@ -15,20 +17,34 @@
             do_mmut_wb(es, DEST_REG, &addr64);                                                                    \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
-            temp = inb(DX);                                                                                       \
-            writememb_n(es, DEST_REG, addr64, temp);                                                              \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-                                                                                                                  \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG--;                                                                                       \
-            else                                                                                                  \
-                DEST_REG++;                                                                                       \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 15;                                                                                   \
+            n = rep_io_block_count(es, DEST_REG, sizeof(DEST_REG), cpu_state.seg_es.limit_high, CNT_REG, 1);      \
+            k = (n > 1) ? io_block_in(DX, buf, 1, n) : 0;                                                         \
+            if (k > 0) {                                                                                          \
+                for (int i = 0; i < k; i++) {                                                                     \
+                    writememb(es, DEST_REG, buf[i]);                                                              \
+                    DEST_REG++;                                                                                   \
+                }                                                                                                 \
+                CNT_REG -= k;                                                                                     \
+                cycles -= 15 * k;                                                                                 \
+                reads += k;                                                                                       \
+                writes += k;                                                                                      \
+                total_cycles += 15 * k;                                                                           \
+            } else {                                                                                              \
+                temp = inb(DX);                                                                                   \
+                writememb_n(es, DEST_REG, addr64, temp);                                                          \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                                                                                                                  \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG--;                                                                                   \
+                else                                                                                              \
+                    DEST_REG++;                                                                                   \
+                CNT_REG--;                                                                                        \
+                cycles -= 15;                                                                                     \
+                reads++;                                                                                          \
+                writes++;                                                                                         \
+                total_cycles += 15;                                                                               \
+            }                                                                                                     \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -46,6 +62,8 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
+            uint16_t buf[REP_IO_BLOCK_SIZE / 2];                                                                  \
+            int      n, k;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX, 2);                                                                                 \
@@ -54,20 +72,34 @@
             do_mmut_ww(es, DEST_REG, addr64a);                                                                    \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
-            temp = inw(DX);                                                                                       \
-            writememw_n(es, DEST_REG, addr64a, temp);                                                             \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-                                                                                                                  \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG -= 2;                                                                                    \
-            else                                                                                                  \
-                DEST_REG += 2;                                                                                    \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 15;                                                                                   \
+            n = rep_io_block_count(es, DEST_REG, sizeof(DEST_REG), cpu_state.seg_es.limit_high, CNT_REG, 2);      \
+            k = (n > 1) ? io_block_in(DX, buf, 2, n) : 0;                                                         \
+            if (k > 0) {                                                                                          \
+                for (int i = 0; i < k; i++) {                                                                     \
+                    writememw(es, DEST_REG, buf[i]);                                                              \
+                    DEST_REG += 2;                                                                                \
+                }                                                                                                 \
+                CNT_REG -= k;                                                                                     \
+                cycles -= 15 * k;                                                                                 \
+                reads += k;                                                                                       \
+                writes += k;                                                                                      \
+                total_cycles += 15 * k;                                                                           \
+            } else {                                                                                              \
+                temp = inw(DX);                                                                                   \
+                writememw_n(es, DEST_REG, addr64a, temp);                                                         \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                                                                                                                  \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= 2;                                                                                \
+                else                                                                                              \
+                    DEST_REG += 2;                                                                                \
+                CNT_REG--;                                                                                        \
+                cycles -= 15;                                                                                     \
+                reads++;                                                                                          \
+                writes++;                                                                                         \
+                total_cycles += 15;                                                                               \
+            }                                                                                                     \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -85,6 +117,8 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint32_t temp;                                                                                        \
+            uint32_t buf[REP_IO_BLOCK_SIZE / 4];                                                                  \
+            int      n, k;                                                                                        \
                                                                                                                   \
             SEG_CHECK_WRITE(&cpu_state.seg_es);                                                                   \
             check_io_perm(DX, 4);                                                                                 \
@@ -93,20 +127,34 @@
             do_mmut_wl(es, DEST_REG, addr64a);                                                                    \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
-            temp = inl(DX);                                                                                       \
-            writememl_n(es, DEST_REG, addr64a, temp);                                                             \
-            if (cpu_state.abrt)                                                                                   \
-                return 1;                                                                                         \
-                                                                                                                  \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                DEST_REG -= 4;                                                                                    \
-            else                                                                                                  \
-                DEST_REG += 4;                                                                                    \
-            CNT_REG--;                                                                                            \
-            cycles -= 15;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 15;                                                                                   \
+            n = rep_io_block_count(es, DEST_REG, sizeof(DEST_REG), cpu_state.seg_es.limit_high, CNT_REG, 4);      \
+            k = (n > 1) ? io_block_in(DX, buf, 4, n) : 0;                                                         \
+            if (k > 0) {                                                                                          \
+                for (int i = 0; i < k; i++) {                                                                     \
+                    writememl(es, DEST_REG, buf[i]);                                                              \
+                    DEST_REG += 4;                                                                                \
+                }                                                                                                 \
+                CNT_REG -= k;                                                                                     \
+                cycles -= 15 * k;                                                                                 \
+                reads += k;                                                                                       \
+                writes += k;                                                                                      \
+                total_cycles += 15 * k;                                                                           \
+            } else {                                                                                              \
+                temp = inl(DX);                                                                                   \
+                writememl_n(es, DEST_REG, addr64a, temp);                                                         \
+                if (cpu_state.abrt)                                                                               \
+                    return 1;                                                                                     \
+                                                                                                                  \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    DEST_REG -= 4;                                                                                \
+                else                                                                                              \
+                    DEST_REG += 4;                                                                                \
+                CNT_REG--;                                                                                        \
+                cycles -= 15;                                                                                     \
+                reads++;                                                                                          \
+                writes++;                                                                                         \
+                total_cycles += 15;                                                                               \
+            }                                                                                                     \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, 0, reads, 0, writes, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -123,22 +171,42 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint8_t temp;                                                                                         \
+            uint8_t buf[REP_IO_BLOCK_SIZE];                                                                       \
+            int     n, k;                                                                                         \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG);                                                       \
             temp = readmemb(cpu_state.ea_seg->base, SRC_REG);                                                     \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
             check_io_perm(DX, 1);                                                                                 \
-            outb(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG--;                                                                                        \
-            else                                                                                                  \
-                SRC_REG++;                                                                                        \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 14;                                                                                   \
+            n = rep_io_block_count(cpu_state.ea_seg->base, SRC_REG, sizeof(SRC_REG),                              \
+                                   cpu_state.ea_seg->limit_high, CNT_REG, 1);                                     \
+            k = 0;                                                                                                \
+            if ((n > 1) && io_block_supported(DX, 1)) {                                                           \
+                buf[0] = temp;                                                                                    \
+                for (int i = 1; i < n; i++)                                                                       \
+                    buf[i] = readmemb(cpu_state.ea_seg->base, SRC_REG + i);                                       \
+                k = io_block_out(DX, buf, 1, n);                                                                  \
+            }                                                                                                     \
+            if (k > 0) {                                                                                          \
+                SRC_REG += k;                                                                                     \
+                CNT_REG -= k;                                                                                     \
+                cycles -= 14 * k;                                                                                 \
+                reads += k;                                                                                       \
+                writes += k;                                                                                      \
+                total_cycles += 14 * k;                                                                           \
+            } else {                                                                                              \
+                outb(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG--;                                                                                    \
+                else                                                                                              \
+                    SRC_REG++;                                                                                    \
+                CNT_REG--;                                                                                        \
+                cycles -= 14;                                                                                     \
+                reads++;                                                                                          \
+                writes++;                                                                                         \
+                total_cycles += 14;                                                                               \
+            }                                                                                                     \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -154,22 +222,42 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint16_t temp;                                                                                        \
+            uint16_t buf[REP_IO_BLOCK_SIZE / 2];                                                                  \
+            int      n, k;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 1UL);                                                 \
             temp = readmemw(cpu_state.ea_seg->base, SRC_REG);                                                     \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
             check_io_perm(DX, 2);                                                                                 \
-            outw(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG -= 2;                                                                                     \
-            else                                                                                                  \
-                SRC_REG += 2;                                                                                     \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 14;                                                                                   \
+            n = rep_io_block_count(cpu_state.ea_seg->base, SRC_REG, sizeof(SRC_REG),                              \
+                                   cpu_state.ea_seg->limit_high, CNT_REG, 2);                                     \
+            k = 0;                                                                                                \
+            if ((n > 1) && io_block_supported(DX, 1)) {                                                           \
+                buf[0] = temp;                                                                                    \
+                for (int i = 1; i < n; i++)                                                                       \
+                    buf[i] = readmemw(cpu_state.ea_seg->base, SRC_REG + (i * 2));                                 \
+                k = io_block_out(DX, buf, 2, n);                                                                  \
+            }                                                                                                     \
+            if (k > 0) {                                                                                          \
+                SRC_REG += k * 2;                                                                                 \
+                CNT_REG -= k;                                                                                     \
+                cycles -= 14 * k;                                                                                 \
+                reads += k;                                                                                       \
+                writes += k;                                                                                      \
+                total_cycles += 14 * k;                                                                           \
+            } else {                                                                                              \
+                outw(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG -= 2;                                                                                 \
+                else                                                                                              \
+                    SRC_REG += 2;                                                                                 \
+                CNT_REG--;                                                                                        \
+                cycles -= 14;                                                                                     \
+                reads++;                                                                                          \
+                writes++;                                                                                         \
+                total_cycles += 14;                                                                               \
+            }                                                                                                     \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, reads, 0, writes, 0, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -185,22 +273,42 @@
                                                                                                                   \
         if (CNT_REG > 0) {                                                                                        \
             uint32_t temp;                                                                                        \
+            uint32_t buf[REP_IO_BLOCK_SIZE / 4];                                                                  \
+            int      n, k;                                                                                        \
             SEG_CHECK_READ(cpu_state.ea_seg);                                                                     \
             CHECK_READ(cpu_state.ea_seg, SRC_REG, SRC_REG + 3UL);                                                 \
             temp = readmeml(cpu_state.ea_seg->base, SRC_REG);                                                     \
             if (cpu_state.abrt)                                                                                   \
                 return 1;                                                                                         \
             check_io_perm(DX, 4);                                                                                 \
-            outl(DX, temp);                                                                                       \
-            if (cpu_state.flags & D_FLAG)                                                                         \
-                SRC_REG -= 4;                                                                                     \
-            else                                                                                                  \
-                SRC_REG += 4;                                                                                     \
-            CNT_REG--;                                                                                            \
-            cycles -= 14;                                                                                         \
-            reads++;                                                                                              \
-            writes++;                                                                                             \
-            total_cycles += 14;                                                                                   \
+            n = rep_io_block_count(cpu_state.ea_seg->base, SRC_REG, sizeof(SRC_REG),                              \
+                                   cpu_state.ea_seg->limit_high, CNT_REG, 4);                                     \
+            k = 0;                                                                                                \
+            if ((n > 1) && io_block_supported(DX, 1)) {                                                           \
+                buf[0] = temp;                                                                                    \
+                for (int i = 1; i < n; i++)                                                                       \
+                    buf[i] = readmeml(cpu_state.ea_seg->base, SRC_REG + (i * 4));                                 \
+                k = io_block_out(DX, buf, 4, n);                                                                  \
+            }                                                                                                     \
+            if (k > 0) {                                                                                          \
+                SRC_REG += k * 4;                                                                                 \
+                CNT_REG -= k;                                                                                     \
+                cycles -= 14 * k;                                                                                 \
+                reads += k;                                                                                       \
+                writes += k;                                                                                      \
+                total_cycles += 14 * k;                                                                           \
+            } else {                                                                                              \
+                outl(DX, temp);                                                                                   \
+                if (cpu_state.flags & D_FLAG)                                                                     \
+                    SRC_REG -= 4;                                                                                 \
+                else                                                                                              \
+                    SRC_REG += 4;                                                                                 \
+                CNT_REG--;                                                                                        \
+                cycles -= 14;                                                                                     \
+                reads++;                                                                                          \
+                writes++;                                                                                         \
+                total_cycles += 14;                                                                               \
+            }                                                                                                     \
         }                                                                                                         \
         PREFETCH_RUN(total_cycles, 1, -1, 0, reads, 0, writes, 0);                                                \
         if (CNT_REG > 0) {                                                                                        \
@@ -2255,7 +2255,7 @@ taskswitch286(uint16_t seg, uint16_t *segdat, int is32)
         cr0 |= 8;
 
         cr3 = new_cr3;
-        flushmmucache();
+        flushmmucache_cr3();
 
         cpu_state.pc     = new_pc;
         cpu_state.flags  = new_flags;
@@ -54,6 +54,9 @@
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/sound.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
+#include <86box/profiler.h>
 
 #define DEVICE_MAX 256 /* max # of devices */
 
@@ -314,6 +317,10 @@ device_close_all(void)
             devices[c] = device_priv[c] = NULL;
         }
     }
+
+#ifdef USE_PROFILER
+    profiler_reset();
+#endif
 }
 
 void
@@ -363,6 +370,87 @@ device_get_priv(const device_t *dev)
     return (NULL);
 }
 
+const device_t *
+device_get_by_priv(const void *priv)
+{
+    if (priv == NULL)
+        return (NULL);
+
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if ((devices[c] != NULL) && (device_priv[c] == priv))
+            return (devices[c]);
+    }
+
+    return (NULL);
+}
+
+static const char *
+device_state_name(const device_t *dev)
+{
+    return (dev->internal_name != NULL) ? dev->internal_name : dev->name;
+}
+
+/* Returns the first attached device lacking state handlers, which makes the
+   machine impossible to snapshot, or NULL if every device has them. */
+const device_t *
+device_get_stateless(void)
+{
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if ((devices[c] != NULL) && ((devices[c]->save_state == NULL) || (devices[c]->load_state == NULL)))
+            return (devices[c]);
+    }
+
+    return (NULL);
+}
+
+/* Save the state of every device, one section per device, keyed by its
+   slot so that multiple instances of the same device are told apart. */
+void
+device_save_state_all(snapshot_t *s)
+{
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if (devices[c] == NULL)
+            continue;
+
+        if (devices[c]->save_state == NULL) {
+            snapshot_set_error(s, "Device \"%s\" does not support snapshots", devices[c]->name);
+            break;
+        }
+
+        snapshot_section_begin(s, device_state_name(devices[c]), c);
+        devices[c]->save_state(device_priv[c], s);
+        snapshot_section_end(s);
+
+        if (snapshot_error(s))
+            break;
+    }
+}
+
+void
+device_load_state_all(snapshot_t *s)
+{
+    const char *name;
+    uint32_t    c;
+
+    while ((name = snapshot_section_next(s, &c)) != NULL) {
+        if ((c >= DEVICE_MAX) || (devices[c] == NULL) || strcmp(name, device_state_name(devices[c]))) {
+            snapshot_set_error(s, "Device \"%s\" is not present in the current configuration", name);
+            break;
+        }
+
+        if (devices[c]->load_state == NULL) {
+            snapshot_set_error(s, "Device \"%s\" does not support snapshots", devices[c]->name);
+            break;
+        }
+
+        devices[c]->load_state(device_priv[c], s);
+        snapshot_section_end(s);
+
+        if (snapshot_error(s))
+            break;
+    }
+}
+
 int
 device_available(const device_t *dev)
 {
@@ -858,6 +946,12 @@ device_context_get_device(void)
     return device_current.dev;
 }
 
+const char *
+device_context_get_name(void)
+{
+    return device_current.name;
+}
+
 const device_t device_none = {
     .name          = "None",
     .internal_name = "none",
@@ -16,6 +16,7 @@
  *          Copyright 2023 Miran Grca.
  *          Copyright 2023 EngiNerd.
  */
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 
 #include <86box/dma.h>
 #include <86box/pci.h>
+#include <86box/snapshot.h>
 
 #define STAT_PARITY        0x80
 #define STAT_RTIMEOUT      0x40
@@ -2229,6 +2231,52 @@ kbc_at_reset(void *priv)
     dev->status = (dev->status & 0x0f) | (dev->p1 & 0xf0);
 }
 
+static void
+kbc_at_save_state(void *priv, snapshot_t *s)
+{
+    atkbc_t *dev = (atkbc_t *) priv;
+
+    /* Everything from the state byte up to the flags is plain data. */
+    snapshot_write(s, dev, offsetof(atkbc_t, flags));
+    snapshot_write_timer(s, &dev->kbc_poll_timer);
+    snapshot_write_timer(s, &dev->kbc_dev_poll_timer);
+    snapshot_write_timer(s, &dev->pulse_cb);
+    snapshot_write_u8(s, dev->ports[0] != kbc_at_ports[0]);
+
+    for (int i = 0; i < 2; i++) {
+        SNAPSHOT_WRITE_VAR(s, kbc_at_ports[i]->wantcmd);
+        SNAPSHOT_WRITE_VAR(s, kbc_at_ports[i]->dat);
+        SNAPSHOT_WRITE_VAR(s, kbc_at_ports[i]->out_new);
+    }
+}
+
+static void
+kbc_at_load_state(void *priv, snapshot_t *s)
+{
+    atkbc_t *dev = (atkbc_t *) priv;
+    int      swap;
+
+    snapshot_read(s, dev, offsetof(atkbc_t, flags));
+    snapshot_read_timer(s, &dev->kbc_poll_timer);
+    snapshot_read_timer(s, &dev->kbc_dev_poll_timer);
+    snapshot_read_timer(s, &dev->pulse_cb);
+    swap = snapshot_read_u8(s);
+
+    for (int i = 0; i < 2; i++) {
+        SNAPSHOT_READ_VAR(s, kbc_at_ports[i]->wantcmd);
+        SNAPSHOT_READ_VAR(s, kbc_at_ports[i]->dat);
+        SNAPSHOT_READ_VAR(s, kbc_at_ports[i]->out_new);
+    }
+
+    dev->ports[0] = kbc_at_ports[swap];
+    dev->ports[1] = kbc_at_ports[!swap];
+
+    if (dev->misc_flags & FLAG_PS2)
+        kbc_at_do_poll = kbc_at_poll_ps2;
+    else
+        kbc_at_do_poll = kbc_at_poll_at;
+}
+
 static void
 kbc_at_close(void *priv)
 {
@@ -2413,7 +2461,9 @@ const device_t keyboard_at_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_siemens_device = {
@@ -2427,7 +2477,9 @@ const device_t keyboard_at_siemens_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_ami_device = {
@@ -2441,7 +2493,9 @@ const device_t keyboard_at_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_tg_ami_device = {
@@ -2455,7 +2509,9 @@ const device_t keyboard_at_tg_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_toshiba_device = {
@@ -2469,7 +2525,9 @@ const device_t keyboard_at_toshiba_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_olivetti_device = {
@@ -2483,7 +2541,9 @@ const device_t keyboard_at_olivetti_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_ncr_device = {
@@ -2497,7 +2557,9 @@ const device_t keyboard_at_ncr_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_at_compaq_device = {
@@ -2511,7 +2573,9 @@ const device_t keyboard_at_compaq_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_device = {
@@ -2525,7 +2589,9 @@ const device_t keyboard_ps2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_ps1_device = {
@@ -2539,7 +2605,9 @@ const device_t keyboard_ps2_ps1_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_ps1_pci_device = {
@@ -2553,7 +2621,9 @@ const device_t keyboard_ps2_ps1_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_xi8088_device = {
@@ -2567,7 +2637,9 @@ const device_t keyboard_ps2_xi8088_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_ami_device = {
@@ -2581,7 +2653,9 @@ const device_t keyboard_ps2_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_holtek_device = {
@@ -2595,7 +2669,9 @@ const device_t keyboard_ps2_holtek_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_phoenix_device = {
@@ -2609,7 +2685,9 @@ const device_t keyboard_ps2_phoenix_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_tg_ami_device = {
@@ -2623,7 +2701,9 @@ const device_t keyboard_ps2_tg_ami_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_mca_1_device = {
@@ -2637,7 +2717,9 @@ const device_t keyboard_ps2_mca_1_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_mca_2_device = {
@@ -2651,7 +2733,9 @@ const device_t keyboard_ps2_mca_2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_quadtel_device = {
@@ -2665,7 +2749,9 @@ const device_t keyboard_ps2_quadtel_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_pci_device = {
@@ -2679,7 +2765,9 @@ const device_t keyboard_ps2_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_ami_pci_device = {
@@ -2693,7 +2781,9 @@ const device_t keyboard_ps2_ami_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_ali_pci_device = {
@@ -2707,7 +2797,9 @@ const device_t keyboard_ps2_ali_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_intel_ami_pci_device = {
@@ -2721,7 +2813,9 @@ const device_t keyboard_ps2_intel_ami_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_tg_ami_pci_device = {
@@ -2735,7 +2829,9 @@ const device_t keyboard_ps2_tg_ami_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
 
 const device_t keyboard_ps2_acer_pci_device = {
@@ -2749,5 +2845,7 @@ const device_t keyboard_ps2_acer_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = kbc_at_save_state,
+    .load_state    = kbc_at_load_state
 };
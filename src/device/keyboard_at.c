@@ -15,6 +15,7 @@
  *          Copyright 2017-2023 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -25,6 +26,7 @@
 #include <86box/device.h>
 #include <86box/keyboard.h>
 #include <86box/mouse.h>
+#include <86box/snapshot.h>
 
 #define FLAG_PS2       0x08  /* dev is AT or PS/2 */
 #define FLAG_AT        0x00  /* dev is AT or PS/2 */
@@ -2178,6 +2180,36 @@ keyboard_at_close(void *priv)
     free(dev);
 }
 
+static void
+keyboard_at_save_state(void *priv, snapshot_t *s)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+
+    snapshot_write(s, &dev->type, offsetof(atkbc_dev_t, scan) - offsetof(atkbc_dev_t, type));
+    SNAPSHOT_WRITE_VAR(s, keyboard_scan);
+    SNAPSHOT_WRITE_VAR(s, keyboard_mode);
+    SNAPSHOT_WRITE_VAR(s, keyboard_set3_flags);
+    SNAPSHOT_WRITE_VAR(s, keyboard_set3_all_repeat);
+    SNAPSHOT_WRITE_VAR(s, keyboard_set3_all_break);
+    SNAPSHOT_WRITE_VAR(s, bat_counter);
+}
+
+static void
+keyboard_at_load_state(void *priv, snapshot_t *s)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+
+    snapshot_read(s, &dev->type, offsetof(atkbc_dev_t, scan) - offsetof(atkbc_dev_t, type));
+    SNAPSHOT_READ_VAR(s, keyboard_scan);
+    SNAPSHOT_READ_VAR(s, keyboard_mode);
+    SNAPSHOT_READ_VAR(s, keyboard_set3_flags);
+    SNAPSHOT_READ_VAR(s, keyboard_set3_all_repeat);
+    SNAPSHOT_READ_VAR(s, keyboard_set3_all_break);
+    SNAPSHOT_READ_VAR(s, bat_counter);
+
+    keyboard_at_set_scancode_set();
+}
+
 static const device_config_t keyboard_at_config[] = {
   // clang-format off
     {
@@ -2217,5 +2249,7 @@ const device_t keyboard_at_generic_device = {
     { .poll = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_at_config
+    .config        = keyboard_at_config,
+    .save_state    = keyboard_at_save_state,
+    .load_state    = keyboard_at_load_state
 };
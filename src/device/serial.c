@@ -19,6 +19,7 @@
  *          Copyright 2017-2020 Fred N. van Kempen.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -36,6 +37,7 @@
 #include <86box/fifo.h>
 #include <86box/serial.h>
 #include <86box/mouse.h>
+#include <86box/snapshot.h>
 
 serial_port_t com_ports[SERIAL_MAX];
 
@@ -851,6 +853,41 @@ serial_speed_changed(void *priv)
     serial_update_speed(dev);
 }
 
+static void
+serial_save_state(void *priv, snapshot_t *s)
+{
+    serial_t *dev = (serial_t *) priv;
+
+    /* Disabled ports have no FIFOs, timers or I/O handlers. */
+    if (!com_ports[dev->inst].enabled)
+        return;
+
+    snapshot_write(s, dev, offsetof(serial_t, rcvr_fifo));
+    fifo_save_state(dev->rcvr_fifo, 64, s);
+    fifo_save_state(dev->xmit_fifo, 64, s);
+    snapshot_write_timer(s, &dev->transmit_timer);
+    snapshot_write_timer(s, &dev->timeout_timer);
+    snapshot_write_timer(s, &dev->receive_timer);
+    SNAPSHOT_WRITE_VAR(s, dev->transmit_period);
+}
+
+static void
+serial_load_state(void *priv, snapshot_t *s)
+{
+    serial_t *dev = (serial_t *) priv;
+
+    if (!com_ports[dev->inst].enabled)
+        return;
+
+    snapshot_read(s, dev, offsetof(serial_t, rcvr_fifo));
+    fifo_load_state(dev->rcvr_fifo, 64, s);
+    fifo_load_state(dev->xmit_fifo, 64, s);
+    snapshot_read_timer(s, &dev->transmit_timer);
+    snapshot_read_timer(s, &dev->timeout_timer);
+    snapshot_read_timer(s, &dev->receive_timer);
+    SNAPSHOT_READ_VAR(s, dev->transmit_period);
+}
+
 static void
 serial_close(void *priv)
 {
@@ -986,7 +1023,9 @@ const device_t ns8250_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns8250_pcjr_device = {
@@ -1000,7 +1039,9 @@ const device_t ns8250_pcjr_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns16450_device = {
@@ -1014,7 +1055,9 @@ const device_t ns16450_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns16550_device = {
@@ -1028,7 +1071,9 @@ const device_t ns16550_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns16650_device = {
@@ -1042,7 +1087,9 @@ const device_t ns16650_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns16750_device = {
@@ -1056,7 +1103,9 @@ const device_t ns16750_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns16850_device = {
@@ -1070,7 +1119,9 @@ const device_t ns16850_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
 
 const device_t ns16950_device = {
@@ -1084,5 +1135,7 @@ const device_t ns16950_device = {
     { .available = NULL },
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = serial_save_state,
+    .load_state    = serial_load_state
 };
@@ -19,6 +19,7 @@
  */
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 #include <86box/hdc.h>
 #include <86box/hdc_ide.h>
 #include <86box/hdd.h>
+#include <86box/snapshot.h>
 #include <86box/zip.h>
 #include <86box/version.h>
 
@@ -2620,6 +2622,88 @@ ide_read_ali_76(void)
     return ret;
 }
 
+/* Whether the data port of the drive is currently moving sector data through
+   the buffer, which is what the block transfer handlers speed up. */
+static int
+ide_block_ok(const ide_board_t *dev, const ide_t *ide, uint16_t addr, int size)
+{
+    if (((addr & 0x7) != 0x0) || (size == 1) || ((size == 4) && !dev->bit32))
+        return 0;
+
+    return (ide->type != IDE_NONE) && !(ide->type & IDE_SHADOW) && (ide->buffer != NULL) &&
+           (ide->command != WIN_PACKETCMD) && !(ide->tf->pos & 1);
+}
+
+/* Returns the number of words of the block that can be copied directly, the
+   last word of a sector goes through ide_read_data() or ide_write_data() so
+   that the end of sector processing is done as usual, and ends the block. */
+static int
+ide_block_words(const ide_t *ide, int size, int count, int *last)
+{
+    int words = count * (size >> 1);
+    int left  = (512 - ide->tf->pos) >> 1;
+
+    if (words >= left) {
+        words = left;
+        *last = 1;
+    } else
+        *last = 0;
+
+    /* Never split a doubleword. */
+    if ((size == 4) && (words & 1))
+        return -1;
+
+    return words;
+}
+
+static int
+ide_read_block(uint16_t addr, void *buf, int size, int count, void *priv)
+{
+    const ide_board_t *dev  = (ide_board_t *) priv;
+    ide_t             *ide  = ide_drives[dev->cur_dev];
+    uint16_t          *bufw = (uint16_t *) buf;
+    int                words;
+    int                last;
+
+    if (!ide_block_ok(dev, ide, addr, size))
+        return 0;
+
+    words = ide_block_words(ide, size, count, &last);
+    if (words <= 0)
+        return 0;
+
+    memcpy(bufw, (uint8_t *) ide->buffer + ide->tf->pos, (words - last) << 1);
+    ide->tf->pos += (words - last) << 1;
+    if (last)
+        bufw[words - 1] = ide_read_data(ide);
+
+    return words / (size >> 1);
+}
+
+static int
+ide_write_block(uint16_t addr, const void *buf, int size, int count, void *priv)
+{
+    const ide_board_t *dev  = (ide_board_t *) priv;
+    ide_t             *ide  = ide_drives[dev->cur_dev];
+    const uint16_t    *bufw = (const uint16_t *) buf;
+    int                words;
+    int                last;
+
+    if (!ide_block_ok(dev, ide, addr, size))
+        return 0;
+
+    words = ide_block_words(ide, size, count, &last);
+    if (words <= 0)
+        return 0;
+
+    memcpy((uint8_t *) ide->buffer + ide->tf->pos, bufw, (words - last) << 1);
+    ide->tf->pos += (words - last) << 1;
+    if (last)
+        ide_write_data(ide, bufw[words - 1]);
+
+    return words / (size >> 1);
+}
+
 void
 ide_handlers(uint8_t board, int set)
 {
@@ -2629,6 +2713,10 @@ ide_handlers(uint8_t board, int set)
                        ide_readb, ide_readw, ide_readl,
                        ide_writeb, ide_writew, ide_writel,
                        ide_boards[board]);
+            if (set)
+                io_set_block_handler(ide_boards[board]->base[0],
+                                     ide_read_block, ide_write_block,
+                                     ide_boards[board]);
         }
 
         if (ide_boards[board]->base[1]) {
@@ -2738,6 +2826,80 @@ ide_board_close(int board)
     ide_boards[board] = NULL;
 }
 
+/* Saves the task files and transfer state of a board's drives. The state of
+   the ATAPI devices behind them is left to the SCSI layer. */
+static void
+ide_board_save_state(int board, snapshot_t *s)
+{
+    ide_board_t *dev = ide_boards[board];
+    ide_t       *ide;
+
+    snapshot_write_u8(s, (dev != NULL) && dev->inited);
+    if ((dev == NULL) || !dev->inited)
+        return;
+
+    SNAPSHOT_WRITE_VAR(s, dev->devctl);
+    SNAPSHOT_WRITE_VAR(s, dev->cur_dev);
+    SNAPSHOT_WRITE_VAR(s, dev->diag);
+    snapshot_write_timer(s, &dev->timer);
+
+    for (uint8_t d = 0; d < 2; d++) {
+        ide = ide_drives[(board << 1) + d];
+
+        snapshot_write(s, &ide->selected, offsetof(ide_t, buffer) - offsetof(ide_t, selected));
+        snapshot_write(s, ide->buffer, 65536 * sizeof(uint16_t));
+        snapshot_write_u8(s, ide->sector_buffer != NULL);
+        if (ide->sector_buffer != NULL)
+            snapshot_write(s, ide->sector_buffer, 256 * 512);
+        snapshot_write_timer(s, &ide->timer);
+        snapshot_write(s, ide->tf, sizeof(ide_tf_t));
+        SNAPSHOT_WRITE_VAR(s, ide->interrupt_drq);
+        SNAPSHOT_WRITE_VAR(s, ide->pending_delay);
+    }
+}
+
+static void
+ide_board_load_state(int board, snapshot_t *s)
+{
+    ide_board_t *dev = ide_boards[board];
+    ide_t       *ide;
+    int          hdd_num;
+
+    if (snapshot_read_u8(s) != ((dev != NULL) && dev->inited)) {
+        snapshot_set_error(s, "IDE board %i presence mismatch", board);
+        return;
+    }
+    if ((dev == NULL) || !dev->inited)
+        return;
+
+    SNAPSHOT_READ_VAR(s, dev->devctl);
+    SNAPSHOT_READ_VAR(s, dev->cur_dev);
+    SNAPSHOT_READ_VAR(s, dev->diag);
+    snapshot_read_timer(s, &dev->timer);
+
+    for (uint8_t d = 0; d < 2; d++) {
+        ide     = ide_drives[(board << 1) + d];
+        hdd_num = ide->hdd_num;
+
+        snapshot_read(s, &ide->selected, offsetof(ide_t, buffer) - offsetof(ide_t, selected));
+        if (ide->hdd_num != hdd_num) {
+            snapshot_set_error(s, "IDE channel %i drive mismatch", (board << 1) + d);
+            ide->hdd_num = hdd_num;
+            return;
+        }
+        snapshot_read(s, ide->buffer, 65536 * sizeof(uint16_t));
+        if (snapshot_read_u8(s)) {
+            if (ide->sector_buffer == NULL)
+                ide->sector_buffer = (uint8_t *) calloc(1, 256 * 512);
+            snapshot_read(s, ide->sector_buffer, 256 * 512);
+        }
+        snapshot_read_timer(s, &ide->timer);
+        snapshot_read(s, ide->tf, sizeof(ide_tf_t));
+        SNAPSHOT_READ_VAR(s, ide->interrupt_drq);
+        SNAPSHOT_READ_VAR(s, ide->pending_delay);
+    }
+}
+
 static void
 ide_board_setup(const int board)
 {
@@ -3256,6 +3418,44 @@ mcide_close(void *priv)
     free(dev);
 }
 
+static void
+ide_save_state(UNUSED(void *priv), snapshot_t *s)
+{
+    for (uint8_t i = 0; i < 2; i++)
+        ide_board_save_state(i, s);
+}
+
+static void
+ide_load_state(UNUSED(void *priv), snapshot_t *s)
+{
+    for (uint8_t i = 0; i < 2; i++)
+        ide_board_load_state(i, s);
+}
+
+static void
+ide_ter_save_state(UNUSED(void *priv), snapshot_t *s)
+{
+    ide_board_save_state(2, s);
+}
+
+static void
+ide_ter_load_state(UNUSED(void *priv), snapshot_t *s)
+{
+    ide_board_load_state(2, s);
+}
+
+static void
+ide_qua_save_state(UNUSED(void *priv), snapshot_t *s)
+{
+    ide_board_save_state(3, s);
+}
+
+static void
+ide_qua_load_state(UNUSED(void *priv), snapshot_t *s)
+{
+    ide_board_load_state(3, s);
+}
+
 const device_t ide_isa_device = {
     .name          = "ISA PC/AT IDE Controller",
     .internal_name = "ide_isa",
@@ -3267,7 +3467,9 @@ const device_t ide_isa_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 const device_t ide_isa_2ch_device = {
@@ -3281,7 +3483,9 @@ const device_t ide_isa_2ch_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 const device_t ide_vlb_device = {
@@ -3295,7 +3499,9 @@ const device_t ide_vlb_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 const device_t ide_vlb_2ch_device = {
@@ -3309,7 +3515,9 @@ const device_t ide_vlb_2ch_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 const device_t ide_pci_device = {
@@ -3323,7 +3531,9 @@ const device_t ide_pci_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 const device_t ide_pci_2ch_device = {
@@ -3337,7 +3547,9 @@ const device_t ide_pci_2ch_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 const device_t mcide_device = {
@@ -3351,7 +3563,9 @@ const device_t mcide_device = {
     { .available = mcide_available },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_save_state,
+    .load_state    = ide_load_state
 };
 
 
@@ -3420,7 +3634,9 @@ const device_t ide_ter_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = ide_ter_config
+    .config        = ide_ter_config,
+    .save_state    = ide_ter_save_state,
+    .load_state    = ide_ter_load_state
 };
 
 const device_t ide_ter_pnp_device = {
@@ -3434,7 +3650,9 @@ const device_t ide_ter_pnp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_ter_save_state,
+    .load_state    = ide_ter_load_state
 };
 
 const device_t ide_qua_device = {
@@ -3448,7 +3666,9 @@ const device_t ide_qua_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = ide_qua_config
+    .config        = ide_qua_config,
+    .save_state    = ide_qua_save_state,
+    .load_state    = ide_qua_load_state
 };
 
 const device_t ide_qua_pnp_device = {
@@ -3462,5 +3682,7 @@ const device_t ide_qua_pnp_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = ide_qua_save_state,
+    .load_state    = ide_qua_load_state
 };
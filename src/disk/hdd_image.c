@@ -37,6 +37,7 @@
 #include <86box/hdd.h>
 #include "minivhd/minivhd.h"
 #include "minivhd/internal.h"
+#include <minitrace/minitrace.h>
 
 #define HDD_IMAGE_RAW 0
 #define HDD_IMAGE_HDI 1
@@ -525,8 +526,8 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_do_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_read;
@@ -552,6 +553,18 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int ret;
+
+    MTR_BEGIN_I("disk", "hdd_image_read", "sectors", count);
+    ret = hdd_image_do_read(id, sector, count, buffer);
+    MTR_END("disk", "hdd_image_read");
+
+    return ret;
+}
+
 uint32_t
 hdd_image_get_last_sector(uint8_t id)
 {
@@ -581,8 +594,8 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_do_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
     int    non_transferred_sectors;
     size_t num_write;
@@ -609,6 +622,18 @@ hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
+int
+hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    int ret;
+
+    MTR_BEGIN_I("disk", "hdd_image_write", "sectors", count);
+    ret = hdd_image_do_write(id, sector, count, buffer);
+    MTR_END("disk", "hdd_image_write");
+
+    return ret;
+}
+
 int
 hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
@@ -33,6 +33,7 @@
 #include <86box/io.h>
 #include <86box/pic.h>
 #include <86box/dma.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 dma_t   dma[8];
@@ -1889,3 +1890,37 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
     if (dma_at)
         mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
 }
+
+void
+dma_save_state(snapshot_t *s)
+{
+    SNAPSHOT_WRITE_VAR(s, dma);
+    SNAPSHOT_WRITE_VAR(s, dma_e);
+    SNAPSHOT_WRITE_VAR(s, dma_m);
+    SNAPSHOT_WRITE_VAR(s, dmaregs);
+    SNAPSHOT_WRITE_VAR(s, dma_wp);
+    SNAPSHOT_WRITE_VAR(s, dma_stat);
+    SNAPSHOT_WRITE_VAR(s, dma_stat_rq);
+    SNAPSHOT_WRITE_VAR(s, dma_stat_rq_pc);
+    SNAPSHOT_WRITE_VAR(s, dma_stat_adv_pend);
+    SNAPSHOT_WRITE_VAR(s, dma_command);
+    SNAPSHOT_WRITE_VAR(s, dma_req_is_soft);
+    SNAPSHOT_WRITE_VAR(s, dma_mask);
+}
+
+void
+dma_load_state(snapshot_t *s)
+{
+    SNAPSHOT_READ_VAR(s, dma);
+    SNAPSHOT_READ_VAR(s, dma_e);
+    SNAPSHOT_READ_VAR(s, dma_m);
+    SNAPSHOT_READ_VAR(s, dmaregs);
+    SNAPSHOT_READ_VAR(s, dma_wp);
+    SNAPSHOT_READ_VAR(s, dma_stat);
+    SNAPSHOT_READ_VAR(s, dma_stat_rq);
+    SNAPSHOT_READ_VAR(s, dma_stat_rq_pc);
+    SNAPSHOT_READ_VAR(s, dma_stat_adv_pend);
+    SNAPSHOT_READ_VAR(s, dma_command);
+    SNAPSHOT_READ_VAR(s, dma_req_is_soft);
+    SNAPSHOT_READ_VAR(s, dma_mask);
+}
@@ -13,6 +13,7 @@
  *          Copyright 2023 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,6 +27,7 @@
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/fifo.h>
+#include <86box/snapshot.h>
 #endif
 
 #ifdef ENABLE_FIFO_LOG
@@ -400,6 +402,30 @@ fifo_init(int len)
     return fifo;
 }
 
+/* Only the state and the buffer are saved, the event callbacks belong to
+   the owner and are left alone. The size is the one the FIFO was allocated
+   with, fifo_set_len() may have made it look shorter. */
+void
+fifo_save_state(void *priv, int size, snapshot_t *s)
+{
+    fifo_t *fifo = (fifo_t *) priv;
+
+    snapshot_write(s, fifo, offsetof(fifo_t, priv));
+    snapshot_write(s, fifo->buf, size);
+}
+
+void
+fifo_load_state(void *priv, int size, snapshot_t *s)
+{
+    fifo_t *fifo = (fifo_t *) priv;
+
+    snapshot_read(s, fifo, offsetof(fifo_t, priv));
+    snapshot_read(s, fifo->buf, size);
+
+    if ((fifo->len < 1) || (fifo->len > size))
+        snapshot_set_error(s, "Invalid FIFO length %i", fifo->len);
+}
+
 #ifdef FIFO_STANDALONE
 enum {
     SERIAL_INT_LSR      = 1,
@@ -17,6 +17,7 @@
  *          Copyright 2008-2020 Sarah Walker.
  *          Copyright 2016-2020 Miran Grca.
  */
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -39,6 +40,7 @@
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
 #include <86box/fifo.h>
+#include <86box/snapshot.h>
 
 extern uint64_t motoron[FDD_NUM];
 
@@ -1857,6 +1859,12 @@ fdc_is_verify(fdc_t *fdc)
     return (fdc->deleted & 2) ? 1 : 0;
 }
 
+int
+fdc_is_dma(fdc_t *fdc)
+{
+    return ((fdc->flags & FDC_FLAG_PCJR) || !fdc->dma) ? 0 : 1;
+}
+
 int
 fdc_data(fdc_t *fdc, uint8_t data, int last)
 {
@@ -2279,6 +2287,66 @@ fdc_reset(void *priv)
     fdc->power_down = 0;
 }
 
+/* A command being executed has its state spread over the image drivers, so
+   only an idle controller, or one exchanging command or result bytes with
+   the host, can be saved. */
+static int
+fdc_busy(const fdc_t *fdc)
+{
+    if (!(fdc->stat & 0x10))
+        return 0;
+
+    return !(fdc->stat & 0x80) || (fdc->stat & 0x20);
+}
+
+static void
+fdc_save_state(void *priv, snapshot_t *s)
+{
+    fdc_t *fdc      = (fdc_t *) priv;
+    int    has_fdds = !(fdc->flags & (FDC_FLAG_SEC | FDC_FLAG_TER | FDC_FLAG_QUA));
+
+    if (fdc_busy(fdc) || (has_fdds && fdd_busy())) {
+        snapshot_set_error(s, "The floppy disk controller is busy");
+        return;
+    }
+
+    snapshot_write(s, fdc, offsetof(fdc_t, fifo_p));
+    fifo_save_state(fdc->fifo_p, 16, s);
+    SNAPSHOT_WRITE_VAR(s, fdc->read_track_sector);
+    SNAPSHOT_WRITE_VAR(s, fdc->format_sector_id);
+    SNAPSHOT_WRITE_VAR(s, fdc->watchdog_count);
+    snapshot_write_timer(s, &fdc->timer);
+    if (fdc->flags & FDC_FLAG_PCJR)
+        snapshot_write_timer(s, &fdc->watchdog_timer);
+
+    /* The drives hang off the primary controller. */
+    if (has_fdds) {
+        SNAPSHOT_WRITE_VAR(s, current_drive);
+        fdd_save_state(s);
+    }
+}
+
+static void
+fdc_load_state(void *priv, snapshot_t *s)
+{
+    fdc_t *fdc      = (fdc_t *) priv;
+    int    has_fdds = !(fdc->flags & (FDC_FLAG_SEC | FDC_FLAG_TER | FDC_FLAG_QUA));
+
+    snapshot_read(s, fdc, offsetof(fdc_t, fifo_p));
+    fifo_load_state(fdc->fifo_p, 16, s);
+    SNAPSHOT_READ_VAR(s, fdc->read_track_sector);
+    SNAPSHOT_READ_VAR(s, fdc->format_sector_id);
+    SNAPSHOT_READ_VAR(s, fdc->watchdog_count);
+    snapshot_read_timer(s, &fdc->timer);
+    if (fdc->flags & FDC_FLAG_PCJR)
+        snapshot_read_timer(s, &fdc->watchdog_timer);
+
+    if (has_fdds) {
+        SNAPSHOT_READ_VAR(s, current_drive);
+        fdd_load_state(s);
+    }
+}
+
 static void
 fdc_close(void *priv)
 {
@@ -2356,7 +2424,9 @@ const device_t fdc_xt_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_xt_sec_device = {
@@ -2370,7 +2440,9 @@ const device_t fdc_xt_sec_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_xt_ter_device = {
@@ -2384,7 +2456,9 @@ const device_t fdc_xt_ter_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_xt_qua_device = {
@@ -2398,7 +2472,9 @@ const device_t fdc_xt_qua_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_xt_t1x00_device = {
@@ -2412,7 +2488,9 @@ const device_t fdc_xt_t1x00_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_xt_amstrad_device = {
@@ -2426,7 +2504,9 @@ const device_t fdc_xt_amstrad_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_xt_tandy_device = {
@@ -2440,7 +2520,9 @@ const device_t fdc_xt_tandy_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_pcjr_device = {
@@ -2454,7 +2536,9 @@ const device_t fdc_pcjr_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_device = {
@@ -2468,7 +2552,9 @@ const device_t fdc_at_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_sec_device = {
@@ -2482,7 +2568,9 @@ const device_t fdc_at_sec_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_ter_device = {
@@ -2496,7 +2584,9 @@ const device_t fdc_at_ter_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_qua_device = {
@@ -2510,7 +2600,9 @@ const device_t fdc_at_qua_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_actlow_device = {
@@ -2524,7 +2616,9 @@ const device_t fdc_at_actlow_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_ps1_device = {
@@ -2538,7 +2632,9 @@ const device_t fdc_at_ps1_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_ps1_2121_device = {
@@ -2552,7 +2648,9 @@ const device_t fdc_at_ps1_2121_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_smc_device = {
@@ -2566,7 +2664,9 @@ const device_t fdc_at_smc_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_ali_device = {
@@ -2580,7 +2680,9 @@ const device_t fdc_at_ali_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_winbond_device = {
@@ -2594,7 +2696,9 @@ const device_t fdc_at_winbond_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_at_nsc_device = {
@@ -2608,7 +2712,9 @@ const device_t fdc_at_nsc_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_dp8473_device = {
@@ -2622,7 +2728,9 @@ const device_t fdc_dp8473_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
 
 const device_t fdc_um8398_device = {
@@ -2636,5 +2744,7 @@ const device_t fdc_um8398_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = fdc_save_state,
+    .load_state    = fdc_load_state
 };
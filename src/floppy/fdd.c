@@ -39,6 +39,7 @@
 #include <86box/fdd_mfm.h>
 #include <86box/fdd_td0.h>
 #include <86box/fdc.h>
+#include <86box/snapshot.h>
 
 /* Flags:
    Bit  0:  300 rpm supported;
@@ -616,6 +617,45 @@ fdd_reset(void)
     }
 }
 
+/* Whether a sector operation is still waiting for the missing image to give up. */
+int
+fdd_busy(void)
+{
+    return !!fdd_notfound;
+}
+
+/* Head positions, motors and disk change lines of the drives, saved along
+   with the FDC that owns them. The images themselves are not saved, only
+   the current track is reloaded from them. */
+void
+fdd_save_state(snapshot_t *s)
+{
+    for (uint8_t i = 0; i < FDD_NUM; i++) {
+        SNAPSHOT_WRITE_VAR(s, fdd[i].track);
+        SNAPSHOT_WRITE_VAR(s, fdd[i].densel);
+        SNAPSHOT_WRITE_VAR(s, fdd[i].head);
+        SNAPSHOT_WRITE_VAR(s, motoron[i]);
+        SNAPSHOT_WRITE_VAR(s, fdd_changed[i]);
+        snapshot_write_timer(s, &fdd_poll_time[i]);
+    }
+}
+
+void
+fdd_load_state(snapshot_t *s)
+{
+    for (uint8_t i = 0; i < FDD_NUM; i++) {
+        SNAPSHOT_READ_VAR(s, fdd[i].track);
+        SNAPSHOT_READ_VAR(s, fdd[i].densel);
+        SNAPSHOT_READ_VAR(s, fdd[i].head);
+        SNAPSHOT_READ_VAR(s, motoron[i]);
+        SNAPSHOT_READ_VAR(s, fdd_changed[i]);
+        snapshot_read_timer(s, &fdd_poll_time[i]);
+
+        if (!snapshot_error(s))
+            fdd_do_seek(i, fdd[i].track);
+    }
+}
+
 void
 fdd_readsector(int drive, int sector, int track, int side, int density, int sector_size)
 {
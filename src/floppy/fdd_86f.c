@@ -2334,6 +2334,7 @@ void
 d86f_turbo_poll(int drive, int side)
 {
     d86f_t *dev = d86f[drive];
+    uint8_t state;
 
     if ((dev->state != STATE_IDLE) && (dev->state != STATE_SECTOR_NOT_FOUND) && ((dev->state & 0xF8) != 0xE8)) {
         if (!d86f_can_read_address(drive)) {
@@ -2431,12 +2432,20 @@ d86f_turbo_poll(int drive, int side)
         case STATE_0C_READ_DATA:
         case STATE_11_SCAN_DATA:
         case STATE_16_VERIFY_DATA:
-            d86f_turbo_read(drive, side);
+            /* Data moved by DMA does not have to be paced for the CPU, so
+               transfer the whole sector in one go. */
+            state = dev->state;
+            do {
+                d86f_turbo_read(drive, side);
+            } while (fdc_is_dma(d86f_fdc) && (dev->state == state));
             break;
 
         case STATE_05_WRITE_DATA:
         case STATE_09_WRITE_DATA:
-            d86f_turbo_write(drive, side);
+            state = dev->state;
+            do {
+                d86f_turbo_write(drive, side);
+            } while (fdc_is_dma(d86f_fdc) && (dev->state == state));
             break;
 
         case STATE_0D_FORMAT_TRACK:
@@ -91,6 +91,7 @@ extern int video_fps; /* (O) render speed in fps */
 #endif
 extern int settings_only;     /* (O) show only the settings dialog */
 extern int confirm_exit_cmdl; /* (O) do not ask for confirmation on quit if set to 0 */
+extern int cfg_cache;         /* (O) keep a binary cache of the config file */
 #ifdef _WIN32
 extern uint64_t unique_id;
 extern uint64_t source_hwnd;
@@ -141,6 +142,8 @@ extern uint32_t mem_size;                   /* (C) memory size (Installed on sys
 extern uint32_t isa_mem_size;               /* (C) memory size (ISA Memory Cards) */
 extern int      cpu;                        /* (C) cpu type */
 extern int      cpu_use_dynarec;            /* (C) cpu uses/needs Dyna */
+extern int      cpu_dynarec_cache;          /* (C) recompiler code cache size in MB, 0 = default */
+extern int      cpu_dynarec_opt;            /* (C) recompiler IR optimisation */
 extern int      fpu_type;                   /* (C) fpu type */
 extern int      fpu_softfloat;              /* (C) fpu uses softfloat */
 extern int      time_sync;                  /* (C) enable time sync */
@@ -150,6 +153,8 @@ extern int      confirm_reset;              /* (C) enable reset confirmation */
 extern int      confirm_exit;               /* (C) enable exit confirmation */
 extern int      confirm_save;               /* (C) enable save confirmation */
 extern int      enable_discord;             /* (C) enable Discord integration */
+extern int      ram_advice;                 /* (C) host paging advice for the guest RAM */
+extern int      rom_mmap;                   /* (C) map ROM images from their files */
 extern int      other_ide_present;          /* IDE controllers from non-IDE cards are present */
 extern int      other_scsi_present;         /* SCSI controllers from non-SCSI cards are present */
 
@@ -215,6 +220,10 @@ extern void pc_send_cab(void);
 extern void pc_run(void);
 extern void pc_start(void);
 extern void pc_onesec(void);
+#ifdef MTR_ENABLED
+extern int  pc_trace_start(const char *fn);
+extern void pc_trace_stop(void);
+#endif
 
 extern uint16_t get_last_addr(void);
 
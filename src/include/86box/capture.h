@@ -0,0 +1,45 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the video and audio capture facility.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#ifndef EMU_CAPTURE_H
+#define EMU_CAPTURE_H
+
+#define CAPTURE_FPS_DEFAULT 60
+
+struct bitmap_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Non-zero while a capture is running; the hooks check it first. */
+extern volatile int capture_active;
+
+/* Starts capturing to base.y4m and base.wav (a trailing .y4m is dropped from
+   base); returns 0 if a capture is already running. */
+extern int  capture_start(const char *base, int fps);
+extern void capture_stop(void);
+extern void capture_close(void);
+
+/* Hooks, for the first monitor's blit thread and the main sound mix. */
+extern void capture_video(struct bitmap_t *b, int x, int y, int w, int h);
+extern void capture_audio(const void *buf, int samples, int is_float);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_CAPTURE_H*/
@@ -164,6 +164,8 @@ typedef struct _device_config_ {
     const device_config_bios_t      bios[32];
 } device_config_t;
 
+struct snapshot_t;
+
 typedef struct _device_ {
     const char *name;
     const char *internal_name;
@@ -184,6 +186,10 @@ typedef struct _device_ {
     void (*force_redraw)(void *priv);
 
     const device_config_t *config;
+
+    /* Machine state snapshot handlers, optional. */
+    void (*save_state)(void *priv, struct snapshot_t *s);
+    void (*load_state)(void *priv, struct snapshot_t *s);
 } device_t;
 
 typedef struct device_context_t {
@@ -215,6 +221,10 @@ extern void  device_close_all(void);
 extern void  device_reset_all(uint32_t match_flags);
 extern void *device_find_first_priv(uint32_t match_flags);
 extern void *device_get_priv(const device_t *dev);
+extern const device_t *device_get_by_priv(const void *priv);
+extern const device_t *device_get_stateless(void);
+extern void  device_save_state_all(struct snapshot_t *s);
+extern void  device_load_state_all(struct snapshot_t *s);
 extern int   device_available(const device_t *dev);
 extern int   device_poll(const device_t *dev);
 extern void  device_speed_changed(void);
@@ -226,6 +236,7 @@ extern const char *device_get_bios_file(const device_t *dev, const char *interna
 extern int device_is_valid(const device_t *, int m);
 
 extern const device_t* device_context_get_device(void);
+extern const char    *device_context_get_name(void);
 
 extern int         device_get_config_int(const char *name);
 extern int         device_get_config_int_ex(const char *s, int dflt_int);
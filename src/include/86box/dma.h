@@ -84,6 +84,11 @@ extern void dma_init(void);
 extern void dma16_init(void);
 extern void ps2_dma_init(void);
 extern void dma_reset(void);
+
+struct snapshot_t;
+extern void dma_save_state(struct snapshot_t *s);
+extern void dma_load_state(struct snapshot_t *s);
+
 extern int  dma_mode(int channel);
 
 extern void    readdma0(void);
@@ -99,6 +99,11 @@ extern void fdd_new(int drive, char *fn);
 extern void fdd_close(int drive);
 extern void fdd_init(void);
 extern void fdd_reset(void);
+
+struct snapshot_t;
+extern int  fdd_busy(void);
+extern void fdd_save_state(struct snapshot_t *s);
+extern void fdd_load_state(struct snapshot_t *s);
 extern void fdd_seek(int drive, int track);
 extern void fdd_readsector(int drive, int sector, int track,
                            int side, int density, int sector_size);
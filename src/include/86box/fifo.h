@@ -75,4 +75,8 @@ extern void       fifo_reset_evt(void *priv);
 extern void       fifo_close(void *priv);
 extern void      *fifo_init(int len);
 
+struct snapshot_t;
+extern void       fifo_save_state(void *priv, int size, struct snapshot_t *s);
+extern void       fifo_load_state(void *priv, int size, struct snapshot_t *s);
+
 #endif /*FIFO_H*/
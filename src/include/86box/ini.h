@@ -31,6 +31,7 @@ typedef void *ini_section_t;
 
 extern ini_t ini_new(void);
 extern ini_t ini_read(const char *fn);
+extern ini_t ini_read_cached(const char *fn, const char *cache_fn);
 extern void  ini_write(ini_t ini, const char *fn);
 extern void  ini_dump(ini_t ini);
 extern void  ini_close(ini_t ini);
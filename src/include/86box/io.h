@@ -110,6 +110,14 @@ extern void     outw(uint16_t port, uint16_t val);
 extern uint32_t inl(uint16_t port);
 extern void     outl(uint16_t port, uint32_t val);
 
+extern void io_set_block_handler(uint16_t port,
+                                 int (*in_block)(uint16_t addr, void *buf, int size, int count, void *priv),
+                                 int (*out_block)(uint16_t addr, const void *buf, int size, int count, void *priv),
+                                 void *priv);
+extern int  io_block_supported(uint16_t port, int out);
+extern int  io_block_in(uint16_t port, void *buf, int size, int count);
+extern int  io_block_out(uint16_t port, const void *buf, int size, int count);
+
 extern void *io_trap_add(void (*func)(int size, uint16_t addr, uint8_t write, uint8_t val, void *priv),
                          void *priv);
 extern void  io_trap_remap(void *handle, int enable, uint16_t addr, uint16_t size);
@@ -93,6 +93,11 @@ extern const char *lpt_device_get_internal_name(int id);
 
 extern int lpt_device_get_from_internal_name(char *s);
 
+struct snapshot_t;
+extern const lpt_device_t *lpt_device_get_stateless(void);
+extern void                lpt_save_state(struct snapshot_t *s);
+extern void                lpt_load_state(struct snapshot_t *s);
+
 extern const lpt_device_t lpt_dac_device;
 extern const lpt_device_t lpt_dac_stereo_device;
 
@@ -348,7 +348,11 @@ typedef struct _machine_ {
 extern const machine_filter_t machine_types[];
 extern const machine_filter_t machine_chipsets[];
 extern const machine_t        machines[];
-extern int                    bios_only;
+#ifdef __cplusplus
+extern thread_local int       bios_only;
+#else
+extern _Thread_local int      bios_only;
+#endif
 extern int                    machine;
 extern void *                 machine_snd;
 
@@ -120,6 +120,20 @@
 #define MEM_MAPPING_CACHE     64 /* Cache or MTRR - please avoid such mappings unless \
                                     stricly necessary (eg. for CoreBoot). */
 
+/* Host paging advice for the guest RAM (ram_advice), only honored on Linux. */
+#define RAM_ADVICE_NONE      0
+#define RAM_ADVICE_MERGEABLE 1 /* Let KSM merge identical pages across instances. */
+#define RAM_ADVICE_HUGEPAGE  2 /* Back the RAM with transparent huge pages. */
+
+/* Size of the software TLB rings (cachesize), in entries per direction. */
+#define MMU_TLB_MIN     256
+#define MMU_TLB_DEFAULT 1024
+#define MMU_TLB_MAX     16384
+
+/* Flags of a software TLB entry. */
+#define MMU_TLB_GLOBAL 1 /* Global page, kept across CR3 loads when CR4.PGE is set. */
+#define MMU_TLB_LARGE  2 /* Part of a 4M or 2M page. */
+
 /* #define's for memory granularity, currently 4k, less does
    not work because of internal 4k pages. */
 #define MEM_GRANULARITY_BITS   12
@@ -263,12 +277,12 @@ extern uint8_t *rom;
 extern uint32_t biosmask;
 extern uint32_t biosaddr;
 
-extern int        readlookup[256];
+extern int       *readlookup;
 extern uintptr_t *readlookup2;
 extern uintptr_t  old_rl2;
 extern uint8_t    uncached;
 extern int        readlnext;
-extern int        writelookup[256];
+extern int       *writelookup;
 extern uintptr_t *writelookup2;
 extern int        writelnext;
 extern uint32_t   ram_mapped_addr[64];
@@ -296,6 +310,18 @@ extern int shadowbios;
 extern int shadowbios_write;
 extern int readlnum;
 extern int writelnum;
+extern int cachesize;
+
+typedef struct mmu_tlb_stats_t {
+    uint64_t walks;        /* page walks, i.e. software TLB misses */
+    uint64_t fills;        /* entries added to the rings */
+    uint64_t flush_full;   /* full flushes (CR0/CR4 changes, CPL changes, chipset remaps) */
+    uint64_t flush_cr3;    /* CR3 loads and task switches */
+    uint64_t flush_invlpg; /* INVLPG */
+    uint64_t kept_global;  /* entries that survived a CR3 load */
+} mmu_tlb_stats_t;
+
+extern mmu_tlb_stats_t mmu_tlb_stats;
 
 extern int memspeed[11];
 
@@ -353,6 +379,7 @@ extern void     writememll_no_mmut_2386(uint32_t addr, uint32_t *a64, uint32_t v
 extern void     do_mmutranslate_2386(uint32_t addr, uint32_t *a64, int num, int write);
 
 extern uint8_t *getpccache(uint32_t a);
+extern void     getpccache_2386(uint32_t a);
 extern uint64_t mmutranslatereal(uint32_t addr, int rw);
 extern uint32_t mmutranslatereal32(uint32_t addr, int rw);
 extern void     addreadlookup(uint32_t virt, uint32_t phys);
@@ -413,6 +440,7 @@ extern uint8_t  mem_readb_phys(uint32_t addr);
 extern uint16_t mem_readw_phys(uint32_t addr);
 extern uint32_t mem_readl_phys(uint32_t addr);
 extern void     mem_read_phys(void *dest, uint32_t addr, int tranfer_size);
+extern uint8_t *mem_get_phys_ptr(uint32_t addr, uint32_t len, int write);
 extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
@@ -448,6 +476,8 @@ extern void mem_reset_page_blocks(void);
 extern void flushmmucache(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
+extern void flushmmucache_cr3(void);
+extern void mmu_invlpg(uint32_t addr);
 
 extern void mem_debug_check_addr(uint32_t addr, int write);
 
@@ -460,6 +490,10 @@ extern void mem_reset(void);
 extern void mem_remap_top_ex(int kb, uint32_t start);
 extern void mem_remap_top(int kb);
 
+struct snapshot_t;
+extern void mem_save_state(struct snapshot_t *s);
+extern void mem_load_state(struct snapshot_t *s);
+
 extern void umc_smram_recalc(uint32_t start, int set);
 
 extern mem_mapping_t *read_mapping[MEM_MAPPINGS_NO];
@@ -46,18 +46,29 @@
 #ifndef EMU_NETWORK_H
 #define EMU_NETWORK_H
 #include <stdint.h>
+#ifdef __cplusplus
+#    include <atomic>
+using atomic_uint = std::atomic_uint;
+#else
+#    include <stdatomic.h>
+#endif
 
 /* Network provider types. */
-#define NET_TYPE_NONE  0 /* use the null network driver */
-#define NET_TYPE_SLIRP 1 /* use the SLiRP port forwarder */
-#define NET_TYPE_PCAP  2 /* use the (Win)Pcap API */
-#define NET_TYPE_VDE   3 /* use the VDE plug API */
+#define NET_TYPE_NONE    0 /* use the null network driver */
+#define NET_TYPE_SLIRP   1 /* use the SLiRP port forwarder */
+#define NET_TYPE_PCAP    2 /* use the (Win)Pcap API */
+#define NET_TYPE_VDE     3 /* use the VDE plug API */
+#define NET_TYPE_TAP     4 /* use a Linux TAP interface */
+#define NET_TYPE_VSWITCH 5 /* use the shared memory virtual switch */
 
 #define NET_MAX_FRAME  1518
-/* Queue size must be a power of 2 */
-#define NET_QUEUE_LEN      16
-#define NET_QUEUE_LEN_MASK (NET_QUEUE_LEN - 1)
-#define NET_QUEUE_COUNT 3
+/* Queue sizes are rounded up to a power of 2 */
+#define NET_QUEUE_LEN_MIN     16
+#define NET_QUEUE_LEN_DEFAULT 64
+#define NET_QUEUE_LEN_MAX     1024
+#define NET_QUEUE_COUNT       3
+/* Packets handed to or taken from a host driver at once */
+#define NET_PKT_BATCH         16
 #define NET_CARD_MAX       4
 #define NET_HOST_INTF_MAX  64
 
@@ -94,6 +105,7 @@ typedef struct netcard_conf_t {
     int      net_type;
     char     host_dev_name[128];
     uint32_t link_state;
+    int      queue_len;
 } netcard_conf_t;
 
 extern netcard_conf_t net_cards_conf[NET_CARD_MAX];
@@ -107,12 +119,17 @@ typedef struct netpkt {
     int      len;
 } netpkt_t;
 
+/* Single producer, single consumer ring; one slot is always kept free. */
 typedef struct netqueue_t {
-    netpkt_t packets[NET_QUEUE_LEN];
-    int      head;
-    int      tail;
+    netpkt_t   *packets;
+    uint32_t    mask;
+    atomic_uint head;
+    atomic_uint tail;
 } netqueue_t;
 
+/* Batched receive: returns the number of packets accepted, in order. */
+typedef int (*NETRXVCB)(void *, netpkt_t *, int);
+
 typedef struct _netcard_t netcard_t;
 
 typedef struct netdrv_t {
@@ -125,6 +142,8 @@ typedef struct netdrv_t {
 extern const netdrv_t net_pcap_drv;
 extern const netdrv_t net_slirp_drv;
 extern const netdrv_t net_vde_drv;
+extern const netdrv_t net_tap_drv;
+extern const netdrv_t net_vswitch_drv;
 extern const netdrv_t net_null_drv;
 
 struct _netcard_t {
@@ -132,10 +151,9 @@ struct _netcard_t {
     void           *card_drv;
     struct netdrv_t host_drv;
     NETRXCB         rx;
+    NETRXVCB        rxv;
     NETSETLINKSTATE set_link_state;
     netqueue_t      queues[NET_QUEUE_COUNT];
-    netpkt_t        queued_pkt;
-    mutex_t        *tx_mutex;
     mutex_t        *rx_mutex;
     pc_timer_t      timer;
     uint16_t        card_num;
@@ -154,10 +172,12 @@ typedef struct {
     int has_slirp;
     int has_pcap;
     int has_vde;
+    int has_tap;
+    int has_vswitch;
 } network_devmap_t;
 
 
-#define HAS_NOSLIRP_NET(x)  (x.has_pcap || x.has_vde)
+#define HAS_NOSLIRP_NET(x)  (x.has_pcap || x.has_vde || x.has_tap || x.has_vswitch)
 
 #ifdef __cplusplus
 extern "C" {
@@ -179,9 +199,11 @@ extern void       network_close(void);
 extern void       network_reset(void);
 extern int        network_available(void);
 extern void       network_tx(netcard_t *card, uint8_t *, int);
+extern void       network_set_rxv(netcard_t *card, NETRXVCB rxv);
 
 extern int net_pcap_prepare(netdev_t *);
 extern int net_vde_prepare(void);
+extern int net_tap_prepare(void);
 
 
 extern void            network_connect(int id, int connect);
@@ -200,6 +222,7 @@ extern int network_tx_pop(netcard_t *card, netpkt_t *out_pkt);
 extern int network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size);
 extern int network_rx_put(netcard_t *card, uint8_t *bufp, int len);
 extern int network_rx_put_pkt(netcard_t *card, netpkt_t *pkt);
+extern int network_rx_putv(netcard_t *card, netpkt_t *pkt, int count);
 
 #ifdef EMU_DEVICE_H
 /* 3Com Etherlink */
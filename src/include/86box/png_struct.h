@@ -56,6 +56,13 @@ extern int png_write_gray(char *path, int invert,
 extern void png_write_rgb(char    *fn,
                           uint8_t *pix, int16_t w, int16_t h, uint16_t pitch, PALETTE palcol);
 
+extern void png_queue_init(void);
+extern void png_queue_rgb(const char *fn, const uint8_t *pix, int16_t w, int16_t h,
+                          uint16_t pitch, PALETTE palcol);
+extern void png_queue_xrgb32(const char *fn, const uint32_t *buf, int start_x, int start_y,
+                             int row_len, int16_t w, int16_t h);
+extern void png_queue_close(void);
+
 #ifdef __cplusplus
 }
 #endif
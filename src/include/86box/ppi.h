@@ -12,4 +12,8 @@ extern PPI ppi;
 
 extern void ppi_reset(void);
 
+struct snapshot_t;
+extern void ppi_save_state(struct snapshot_t *s);
+extern void ppi_load_state(struct snapshot_t *s);
+
 #endif /*EMU_PPI_H*/
@@ -0,0 +1,89 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the per-device emulation time profiler.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#ifndef EMU_PROFILER_H
+#define EMU_PROFILER_H
+
+/* Handler categories the host time is attributed to. */
+enum {
+    PROFILER_TIMER = 0,
+    PROFILER_IO,
+    PROFILER_MMIO,
+    PROFILER_TYPES
+};
+
+#define PROFILER_SLOTS       256
+/* Only one in (PROFILER_SAMPLE_MASK + 1) handler calls is timed. */
+#define PROFILER_SAMPLE_MASK 0x0f
+
+typedef struct profiler_entry_t {
+    char     name[128];
+    uint64_t calls[PROFILER_TYPES]; /* Estimated calls during the last second. */
+    uint64_t us[PROFILER_TYPES];    /* Estimated host microseconds during the last second. */
+    double   percent;               /* Share of the last second's host time. */
+} profiler_entry_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef USE_PROFILER
+extern int      profiler_enabled;
+extern uint32_t profiler_sample_ctr;
+
+extern void     profiler_init(void);
+extern void     profiler_close(void);
+extern void     profiler_reset(void);
+extern void     profiler_set_enabled(int enabled);
+extern void     profiler_register(const void *priv);
+extern uint64_t profiler_ts(void);
+extern void     profiler_account(int type, const void *priv, uint64_t start);
+extern void     profiler_onesec(void);
+extern void     profiler_process(void);
+
+/* Copies the statistics of the last complete second into the entries array,
+   sorted by descending share; returns the number of entries written. */
+extern int      profiler_get_stats(profiler_entry_t *entries, int max);
+/* Returns a malloc'd JSON document with the last second's statistics. */
+extern char    *profiler_dump_json(void);
+
+/* Wraps a handler invocation so that one in every (PROFILER_SAMPLE_MASK + 1)
+   calls is timed and attributed to the device owning priv. */
+#    define PROFILER_CALL(type, priv, call)                              \
+        do {                                                             \
+            if (profiler_enabled &&                                      \
+                !(++profiler_sample_ctr & PROFILER_SAMPLE_MASK)) {       \
+                uint64_t prof_start_ = profiler_ts();                    \
+                call;                                                    \
+                profiler_account(type, priv, prof_start_);               \
+            } else {                                                     \
+                call;                                                    \
+            }                                                            \
+        } while (0)
+#    define PROFILER_REGISTER(priv) profiler_register(priv)
+#else
+#    define PROFILER_CALL(type, priv, call) \
+        do {                                \
+            call;                           \
+        } while (0)
+#    define PROFILER_REGISTER(priv)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_PROFILER_H*/
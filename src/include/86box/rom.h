@@ -52,9 +52,12 @@ extern uint8_t  rom_read(uint32_t addr, void *priv);
 extern uint16_t rom_readw(uint32_t addr, void *priv);
 extern uint32_t rom_readl(uint32_t addr, void *priv);
 
-extern FILE *rom_fopen(const char *fn, char *mode);
-extern int   rom_getfile(char *fn, char *s, int size);
-extern int   rom_present(const char *fn);
+extern FILE    *rom_fopen(const char *fn, char *mode);
+extern int      rom_getfile(char *fn, char *s, int size);
+extern int      rom_present(const char *fn);
+extern uint32_t rom_index_generation(void);
+extern uint8_t *rom_map(const char *fn, int sz, int off);
+extern void     rom_unmap(void *ptr, int sz);
 
 extern int rom_load_linear_oddeven(const char *fn, uint32_t addr, int sz,
                                    int off, uint8_t *ptr);
@@ -0,0 +1,72 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the machine state snapshot facility.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#ifndef EMU_SNAPSHOT_H
+#define EMU_SNAPSHOT_H
+
+#define SNAPSHOT_VERSION 5
+
+typedef struct snapshot_t snapshot_t;
+struct pc_timer_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Requests, processed on the emulation thread by snapshot_process(). */
+extern void snapshot_save_request(const char *fn);
+extern void snapshot_load_request(const char *fn);
+extern void snapshot_check_request(const char *fn);
+extern void snapshot_process(void);
+
+/* Synchronous entry points, must be called from the emulation thread. */
+extern int snapshot_save(const char *fn);
+extern int snapshot_load(const char *fn);
+extern int snapshot_check(const char *fn);
+
+/* Stream accessors for the state handlers. Errors are sticky: once a read or
+   write fails, all further accesses do nothing and reads return zeroes. */
+extern void     snapshot_write(snapshot_t *s, const void *data, size_t len);
+extern void     snapshot_read(snapshot_t *s, void *data, size_t len);
+extern void     snapshot_write_u8(snapshot_t *s, uint8_t val);
+extern void     snapshot_write_u16(snapshot_t *s, uint16_t val);
+extern void     snapshot_write_u32(snapshot_t *s, uint32_t val);
+extern void     snapshot_write_u64(snapshot_t *s, uint64_t val);
+extern uint8_t  snapshot_read_u8(snapshot_t *s);
+extern uint16_t snapshot_read_u16(snapshot_t *s);
+extern uint32_t snapshot_read_u32(snapshot_t *s);
+extern uint64_t snapshot_read_u64(snapshot_t *s);
+extern void     snapshot_write_ram(snapshot_t *s, const uint8_t *data, size_t len);
+extern void     snapshot_read_ram(snapshot_t *s, uint8_t *data, size_t len);
+extern void     snapshot_write_timer(snapshot_t *s, struct pc_timer_t *timer);
+extern void     snapshot_read_timer(snapshot_t *s, struct pc_timer_t *timer);
+extern void     snapshot_set_error(snapshot_t *s, const char *fmt, ...);
+extern int      snapshot_error(snapshot_t *s);
+
+/* Sections, used by device_save_state_all() and device_load_state_all(). */
+extern void        snapshot_section_begin(snapshot_t *s, const char *name, uint32_t instance);
+extern void        snapshot_section_end(snapshot_t *s);
+extern const char *snapshot_section_next(snapshot_t *s, uint32_t *instance);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Convenience wrappers for plain variables and arrays. */
+#define SNAPSHOT_WRITE_VAR(s, var) snapshot_write(s, &(var), sizeof(var))
+#define SNAPSHOT_READ_VAR(s, var)  snapshot_read(s, &(var), sizeof(var))
+
+#endif /*EMU_SNAPSHOT_H*/
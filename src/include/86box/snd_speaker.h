@@ -31,4 +31,8 @@ extern void speaker_init(void);
 extern void speaker_set_count(uint8_t new_m, int new_count);
 extern void speaker_update(void);
 
+struct snapshot_t;
+extern void speaker_save_state(struct snapshot_t *s);
+extern void speaker_load_state(struct snapshot_t *s);
+
 #endif /*SOUND_SPEAKER_H*/
@@ -58,6 +58,7 @@ extern int ui_msgbox_header(int flags, void *header, void *message);
 
 extern wchar_t *ui_window_title(wchar_t *s);
 extern void     ui_hard_reset_completed(void);
+extern void     ui_trace_state_changed(void);
 extern void     ui_init_monitor(int monitor_index);
 extern void     ui_deinit_monitor(int monitor_index);
 extern void     ui_sb_set_ready(int ready);
@@ -336,6 +336,10 @@ extern int  svga_init(const device_t *info, svga_t *svga, void *priv, int memsiz
 extern void svga_recalctimings(svga_t *svga);
 extern void svga_close(svga_t *svga);
 
+struct snapshot_t;
+extern void svga_save_state(svga_t *svga, struct snapshot_t *s);
+extern void svga_load_state(svga_t *svga, struct snapshot_t *s);
+
 uint8_t  svga_read(uint32_t addr, void *priv);
 uint16_t svga_readw(uint32_t addr, void *priv);
 uint32_t svga_readl(uint32_t addr, void *priv);
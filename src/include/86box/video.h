@@ -277,6 +277,7 @@ extern void    video_force_resize_set_monitor(uint8_t res, int monitor_index);
 extern void    video_update_timing(void);
 
 extern void loadfont_ex(char *s, int format, int offset);
+extern void video_ksc5601_close(void);
 extern void loadfont(char *s, int format);
 
 extern int get_actual_size_x(void);
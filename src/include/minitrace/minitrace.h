@@ -37,8 +37,8 @@ extern "C" {
 #endif
 
 // Initializes Minitrace. Must be called very early during startup of your executable,
-// before any MTR_ statements.
-void mtr_init(const char *json_file);
+// before any MTR_ statements. Returns 0 if the output file could not be opened.
+int mtr_init(const char *json_file);
 // Same as above, but allows passing in a custom stream (FILE *), as returned by
 // fopen(). It should be opened for writing, preferably in binary mode to avoid
 // processing of line endings (i.e. the "wb" mode).
@@ -63,6 +63,11 @@ double mtr_time_s(void);
 // Works on Linux and MacOSX, and in Win32 console applications.
 void mtr_register_sigint_handler(void);
 
+// Remembers the name of the calling thread. The names of all registered threads
+// are emitted as metadata whenever tracing is (re)started, so threads created
+// before the trace was started still show up named in the viewer.
+void mtr_register_thread_name(const char *name);
+
 // Utility function that should rarely be used.
 // If str is semi dynamic, store it permanently in a small pool so we don't need to malloc it.
 // The pool fills up fast though and performance isn't great.
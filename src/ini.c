@@ -28,6 +28,7 @@
 
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,25 +39,47 @@
 #include <86box/ini.h>
 #include <86box/plat.h>
 
+#define INI_SECTION_BUCKETS 64
+#define INI_ENTRY_BUCKETS   32
+
 typedef struct _list_ {
     struct _list_ *next;
 } list_t;
 
+typedef struct entry_t {
+    list_t list;
+
+    char    name[128];
+    char    data[512];
+    wchar_t wdata[512];
+
+    uint32_t        hash;
+    struct entry_t *hash_next;
+} entry_t;
+
+/* The part of an entry that is swapped around when sorting a section. */
+#define ENTRY_CONTENTS_SIZE (offsetof(entry_t, hash) - offsetof(entry_t, name))
+
 typedef struct section_t {
     list_t list;
 
     char name[128];
 
     list_t entry_head;
+
+    uint32_t           hash;
+    struct section_t  *hash_next;
+    struct ini_head_t *ini;
+    entry_t           *buckets[INI_ENTRY_BUCKETS];
 } section_t;
 
-typedef struct entry_t {
+/* What an ini_t points to. Sections and entries are kept in lists, in file
+   order, and also hashed by name so that lookups do not have to walk them. */
+typedef struct ini_head_t {
     list_t list;
 
-    char    name[128];
-    char    data[512];
-    wchar_t wdata[512];
-} entry_t;
+    section_t *buckets[INI_SECTION_BUCKETS];
+} ini_head_t;
 
 #define list_add(new, head)        \
     {                              \
@@ -100,20 +123,98 @@ ini_log(const char *fmt, ...)
 #    define ini_log(fmt, ...)
 #endif
 
+static uint32_t
+ini_hash(const char *name)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    while (*name != '\0')
+        hash = (hash ^ (uint8_t) *(name++)) * 0x01000193;
+
+    return hash;
+}
+
+/* New sections and entries go to the end of their hash chain, so that the
+   first one with a given name is still the one found, as with the lists. */
+static void
+section_hash_add(ini_head_t *head, section_t *sec)
+{
+    section_t **link;
+
+    sec->ini       = head;
+    sec->hash      = ini_hash(sec->name);
+    sec->hash_next = NULL;
+
+    link = &head->buckets[sec->hash % INI_SECTION_BUCKETS];
+    while (*link != NULL)
+        link = &(*link)->hash_next;
+    *link = sec;
+}
+
+static void
+section_hash_remove(section_t *sec)
+{
+    section_t **link = &sec->ini->buckets[sec->hash % INI_SECTION_BUCKETS];
+
+    while (*link != NULL) {
+        if (*link == sec) {
+            *link = sec->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+}
+
+static void
+entry_hash_add(section_t *sec, entry_t *ent)
+{
+    entry_t **link;
+
+    ent->hash      = ini_hash(ent->name);
+    ent->hash_next = NULL;
+
+    link = &sec->buckets[ent->hash % INI_ENTRY_BUCKETS];
+    while (*link != NULL)
+        link = &(*link)->hash_next;
+    *link = ent;
+}
+
+static void
+entry_hash_remove(section_t *sec, entry_t *ent)
+{
+    entry_t **link = &sec->buckets[ent->hash % INI_ENTRY_BUCKETS];
+
+    while (*link != NULL) {
+        if (*link == ent) {
+            *link = ent->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+}
+
+static void
+section_rehash_entries(section_t *sec)
+{
+    memset(sec->buckets, 0x00, sizeof(sec->buckets));
+
+    for (entry_t *ent = (entry_t *) sec->entry_head.next; ent != NULL; ent = (entry_t *) ent->list.next)
+        entry_hash_add(sec, ent);
+}
+
 static section_t *
-find_section(list_t *head, const char *name)
+find_section(ini_head_t *head, const char *name)
 {
-    section_t *sec     = (section_t *) head->next;
-    const char blank[] = "";
+    section_t *sec;
+    uint32_t   hash;
 
     if (name == NULL)
-        name = blank;
+        name = "";
 
-    while (sec != NULL) {
-        if (!strncmp(sec->name, name, sizeof(sec->name)))
+    hash = ini_hash(name);
+    for (sec = head->buckets[hash % INI_SECTION_BUCKETS]; sec != NULL; sec = sec->hash_next) {
+        if ((sec->hash == hash) && !strncmp(sec->name, name, sizeof(sec->name)))
             return sec;
-
-        sec = (section_t *) sec->list.next;
     }
 
     return NULL;
@@ -125,7 +226,7 @@ ini_find_section(ini_t ini, const char *name)
     if (ini == NULL)
         return NULL;
 
-    return (ini_section_t) find_section((list_t *) ini, name);
+    return (ini_section_t) find_section((ini_head_t *) ini, name);
 }
 
 void
@@ -136,22 +237,21 @@ ini_rename_section(ini_section_t section, const char *name)
     if (sec == NULL)
         return;
 
+    section_hash_remove(sec);
     memset(sec->name, 0x00, sizeof(sec->name));
     memcpy(sec->name, name, MIN(128, strlen(name) + 1));
+    section_hash_add(sec->ini, sec);
 }
 
 static entry_t *
 find_entry(section_t *section, const char *name)
 {
     entry_t *ent;
+    uint32_t hash = ini_hash(name);
 
-    ent = (entry_t *) section->entry_head.next;
-
-    while (ent != NULL) {
-        if (!strncmp(ent->name, name, sizeof(ent->name)))
+    for (ent = section->buckets[hash % INI_ENTRY_BUCKETS]; ent != NULL; ent = ent->hash_next) {
+        if ((ent->hash == hash) && !strncmp(ent->name, name, sizeof(ent->name)))
             return ent;
-
-        ent = (entry_t *) ent->list.next;
     }
 
     return (NULL);
@@ -203,9 +303,9 @@ delete_section_if_empty(list_t *head, section_t *section)
                             entry_t t_ent = { 0 };
                             memcpy(&t_ent, j_ent, sizeof(entry_t));
                             /* J: Contents of I, list of J */
-                            memcpy(j_ent->name, i_ent->name, sizeof(entry_t) - sizeof(i_ent->list));
+                            memcpy(j_ent->name, i_ent->name, ENTRY_CONTENTS_SIZE);
                             /* I: Contents of J, list of I */
-                            memcpy(i_ent->name, t_ent.name, sizeof(entry_t) - sizeof(i_ent->list));
+                            memcpy(i_ent->name, t_ent.name, ENTRY_CONTENTS_SIZE);
                         }
 
                         j++;
@@ -219,7 +319,11 @@ delete_section_if_empty(list_t *head, section_t *section)
 
             i_ent = (entry_t *) i_next;
         }
+
+        /* The names have moved between the entries. */
+        section_rehash_entries(section);
     } else {
+        section_hash_remove(section);
         list_delete(&section->list, head);
         free(section);
     }
@@ -235,13 +339,14 @@ ini_delete_section_if_empty(ini_t ini, ini_section_t section)
 }
 
 static section_t *
-create_section(list_t *head, const char *name)
+create_section(ini_head_t *head, const char *name)
 {
     section_t *ns = malloc(sizeof(section_t));
 
     memset(ns, 0x00, sizeof(section_t));
-    memcpy(ns->name, name, strlen(name) + 1);
-    list_add(&ns->list, head);
+    memcpy(ns->name, name, MIN(sizeof(ns->name) - 1, strlen(name)));
+    list_add(&ns->list, &head->list);
+    section_hash_add(head, ns);
 
     return ns;
 }
@@ -252,9 +357,9 @@ ini_find_or_create_section(ini_t ini, const char *name)
     if (ini == NULL)
         return NULL;
 
-    section_t *section = find_section((list_t *) ini, name);
+    section_t *section = find_section((ini_head_t *) ini, name);
     if (section == NULL)
-        section = create_section((list_t *) ini, name);
+        section = create_section((ini_head_t *) ini, name);
 
     return (ini_section_t) section;
 }
@@ -265,8 +370,9 @@ create_entry(section_t *section, const char *name)
     entry_t *ne = malloc(sizeof(entry_t));
 
     memset(ne, 0x00, sizeof(entry_t));
-    memcpy(ne->name, name, strlen(name) + 1);
+    memcpy(ne->name, name, MIN(sizeof(ne->name) - 1, strlen(name)));
     list_add(&ne->list, &section->entry_head);
+    entry_hash_add(section, ne);
 
     return ne;
 }
@@ -355,14 +461,13 @@ ini_read(const char *fn)
     char       sname[128];
     char       ename[128];
     wchar_t    buff[1024];
-    section_t *sec;
-    section_t *ns;
-    entry_t   *ne;
-    int        c;
-    int        d;
-    int        bom;
-    FILE      *fp;
-    list_t    *head;
+    section_t  *sec;
+    entry_t    *ne;
+    int         c;
+    int         d;
+    int         bom;
+    FILE       *fp;
+    ini_head_t *head;
 
     bom = ini_detect_bom(fn);
 #if defined(ANSI_CFG) || !defined(_WIN32)
@@ -373,13 +478,10 @@ ini_read(const char *fn)
     if (fp == NULL)
         return NULL;
 
-    head = malloc(sizeof(list_t));
-    memset(head, 0x00, sizeof(list_t));
+    head = calloc(1, sizeof(ini_head_t));
 
-    sec = malloc(sizeof(section_t));
-    memset(sec, 0x00, sizeof(section_t));
+    sec = create_section(head, "");
 
-    list_add(&sec->list, head);
     if (bom)
         fseek(fp, 3, SEEK_SET);
 
@@ -425,14 +527,8 @@ ini_read(const char *fn)
             if (buff[c] != L']')
                 continue;
 
-            /* Create a new section and insert it. */
-            ns = malloc(sizeof(section_t));
-            memset(ns, 0x00, sizeof(section_t));
-            memcpy(ns->name, sname, 128);
-            list_add(&ns->list, head);
-
-            /* New section is now the current one. */
-            sec = ns;
+            /* Create a new section, which is now the current one. */
+            sec = create_section(head, sname);
             continue;
         }
 
@@ -458,9 +554,7 @@ ini_read(const char *fn)
         d = c;
 
         /* Allocate a new variable entry.. */
-        ne = malloc(sizeof(entry_t));
-        memset(ne, 0x00, sizeof(entry_t));
-        memcpy(ne->name, ename, 128);
+        ne = create_entry(sec, ename);
         wcsncpy(ne->wdata, &buff[d], sizeof_w(ne->wdata) - 1);
         ne->wdata[sizeof_w(ne->wdata) - 1] = L'\0';
 #ifdef _WIN32 /* Make sure the string is converted to UTF-8 rather than a legacy codepage */
@@ -469,9 +563,6 @@ ini_read(const char *fn)
         wcstombs(ne->data, ne->wdata, sizeof(ne->data));
 #endif
         ne->data[sizeof(ne->data) - 1] = '\0';
-
-        /* .. and insert it. */
-        list_add(&ne->list, &sec->entry_head);
     }
 
     (void) fclose(fp);
@@ -534,11 +625,234 @@ ini_write(ini_t ini, const char *fn)
     (void) fclose(fp);
 }
 
+/*
+ * Binary cache of a parsed configuration file.
+ *
+ * Parsing goes through the wide character conversion routines line by line,
+ * which adds up when a lot of emulator instances start at the same time. The
+ * cache holds the sections and entries exactly as ini_read() produced them,
+ * together with the size and a hash of the text file they came from; it is
+ * only used while the file is unchanged, and rewritten whenever it is not.
+ * All values are in host byte order, as the cache is never moved anywhere.
+ */
+#define INI_CACHE_MAGIC   0x43494236 /* "6BIC" */
+#define INI_CACHE_VERSION 1
+
+typedef struct ini_cache_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t wchar_size;
+    uint64_t file_size;
+    uint64_t file_hash;
+    uint32_t sections;
+    uint32_t reserved;
+} ini_cache_header_t;
+
+typedef struct ini_cache_reader_t {
+    const uint8_t *ptr;
+    const uint8_t *end;
+} ini_cache_reader_t;
+
+static uint64_t
+ini_cache_hash(const uint8_t *data, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    while (len--)
+        hash = (hash ^ *(data++)) * 0x00000100000001b3ULL;
+
+    return hash;
+}
+
+static uint8_t *
+ini_cache_load_file(const char *fn, size_t *len)
+{
+    FILE    *fp;
+    uint8_t *data = NULL;
+    long     size;
+
+    if ((fp = plat_fopen(fn, "rb")) == NULL)
+        return NULL;
+
+    if ((fseek(fp, 0, SEEK_END) == 0) && ((size = ftell(fp)) >= 0) && (fseek(fp, 0, SEEK_SET) == 0)) {
+        data = malloc(size + 1);
+        if ((data != NULL) && (fread(data, 1, size, fp) != (size_t) size)) {
+            free(data);
+            data = NULL;
+        }
+        *len = size;
+    }
+
+    (void) fclose(fp);
+
+    return data;
+}
+
+static int
+ini_cache_get(ini_cache_reader_t *rd, void *dest, size_t len)
+{
+    if ((size_t) (rd->end - rd->ptr) < len)
+        return 0;
+
+    memcpy(dest, rd->ptr, len);
+    rd->ptr += len;
+
+    return 1;
+}
+
+/* Reads a length-prefixed string of len_max - 1 characters at most. */
+static int
+ini_cache_get_string(ini_cache_reader_t *rd, void *dest, size_t char_size, size_t len_max)
+{
+    uint16_t len;
+
+    if (!ini_cache_get(rd, &len, sizeof(len)) || (len >= len_max))
+        return 0;
+
+    memset(dest, 0x00, len_max * char_size);
+
+    return ini_cache_get(rd, dest, len * char_size);
+}
+
+static ini_t
+ini_cache_read(const char *cache_fn, uint64_t file_size, uint64_t file_hash)
+{
+    ini_cache_header_t hdr;
+    ini_cache_reader_t rd;
+    ini_head_t        *head;
+    section_t         *sec;
+    entry_t           *ent;
+    uint8_t           *data;
+    char               name[128];
+    size_t             len = 0;
+    uint32_t           entries;
+    int                ok = 1;
+
+    if ((data = ini_cache_load_file(cache_fn, &len)) == NULL)
+        return NULL;
+
+    rd.ptr = data;
+    rd.end = data + len;
+    if (!ini_cache_get(&rd, &hdr, sizeof(hdr)) || (hdr.magic != INI_CACHE_MAGIC) ||
+        (hdr.version != INI_CACHE_VERSION) || (hdr.wchar_size != sizeof(wchar_t)) ||
+        (hdr.file_size != file_size) || (hdr.file_hash != file_hash)) {
+        free(data);
+        return NULL;
+    }
+
+    head = calloc(1, sizeof(ini_head_t));
+    for (uint32_t i = 0; ok && (i < hdr.sections); i++) {
+        ok  = ini_cache_get_string(&rd, name, 1, sizeof(name)) && ini_cache_get(&rd, &entries, sizeof(entries));
+        sec = ok ? create_section(head, name) : NULL;
+
+        for (uint32_t j = 0; ok && (j < entries); j++) {
+            ok = ini_cache_get_string(&rd, name, 1, sizeof(name));
+            if (ok) {
+                ent = create_entry(sec, name);
+                ok  = ini_cache_get_string(&rd, ent->data, 1, sizeof(ent->data)) &&
+                     ini_cache_get_string(&rd, ent->wdata, sizeof(wchar_t), sizeof_w(ent->wdata));
+            }
+        }
+    }
+
+    free(data);
+
+    if (!ok || (rd.ptr != rd.end)) {
+        ini_log("INI: cache file '%s' is damaged\n", cache_fn);
+        ini_close((ini_t) head);
+        return NULL;
+    }
+
+    return (ini_t) head;
+}
+
+static void
+ini_cache_put_string(FILE *fp, const void *str, size_t char_size, size_t len)
+{
+    uint16_t len16 = (uint16_t) len;
+
+    fwrite(&len16, sizeof(len16), 1, fp);
+    fwrite(str, char_size, len, fp);
+}
+
+static void
+ini_cache_write(ini_t ini, const char *cache_fn, uint64_t file_size, uint64_t file_hash)
+{
+    ini_cache_header_t hdr = { 0 };
+    char               temp[1024];
+    section_t         *sec;
+    entry_t           *ent;
+    FILE              *fp;
+    uint32_t           entries;
+    int                ok;
+
+    snprintf(temp, sizeof(temp), "%s.tmp", cache_fn);
+    if ((fp = plat_fopen(temp, "wb")) == NULL)
+        return;
+
+    hdr.magic      = INI_CACHE_MAGIC;
+    hdr.version    = INI_CACHE_VERSION;
+    hdr.wchar_size = sizeof(wchar_t);
+    hdr.file_size  = file_size;
+    hdr.file_hash  = file_hash;
+    for (sec = (section_t *) ((list_t *) ini)->next; sec != NULL; sec = (section_t *) sec->list.next)
+        hdr.sections++;
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+
+    for (sec = (section_t *) ((list_t *) ini)->next; sec != NULL; sec = (section_t *) sec->list.next) {
+        entries = 0;
+        for (ent = (entry_t *) sec->entry_head.next; ent != NULL; ent = (entry_t *) ent->list.next)
+            entries++;
+
+        ini_cache_put_string(fp, sec->name, 1, strlen(sec->name));
+        fwrite(&entries, sizeof(entries), 1, fp);
+
+        for (ent = (entry_t *) sec->entry_head.next; ent != NULL; ent = (entry_t *) ent->list.next) {
+            ini_cache_put_string(fp, ent->name, 1, strlen(ent->name));
+            ini_cache_put_string(fp, ent->data, 1, strlen(ent->data));
+            ini_cache_put_string(fp, ent->wdata, sizeof(wchar_t), wcslen(ent->wdata));
+        }
+    }
+
+    ok = !ferror(fp);
+    ok &= (fclose(fp) == 0);
+
+    /* Only ever replace the cache with a complete one. */
+    (void) remove(cache_fn);
+    if (!ok || (rename(temp, cache_fn) != 0))
+        (void) remove(temp);
+}
+
+/* Like ini_read(), but uses (and keeps up to date) a binary cache of the
+   parsed file in cache_fn. */
+ini_t
+ini_read_cached(const char *fn, const char *cache_fn)
+{
+    uint8_t *data;
+    uint64_t hash;
+    size_t   len = 0;
+    ini_t    ini;
+
+    if ((data = ini_cache_load_file(fn, &len)) == NULL)
+        return NULL;
+    hash = ini_cache_hash(data, len);
+    free(data);
+
+    if ((ini = ini_cache_read(cache_fn, len, hash)) != NULL) {
+        ini_log("INI: using cache file '%s'\n", cache_fn);
+        return ini;
+    }
+
+    if ((ini = ini_read(fn)) != NULL)
+        ini_cache_write(ini, cache_fn, len, hash);
+
+    return ini;
+}
+
 ini_t
 ini_new(void)
 {
-    ini_t ini = malloc(sizeof(list_t));
-    memset(ini, 0, sizeof(list_t));
+    ini_t ini = calloc(1, sizeof(ini_head_t));
     return ini;
 }
 
@@ -574,6 +888,7 @@ ini_section_delete_var(ini_section_t self, const char *name)
 
     entry = find_entry(section, name);
     if (entry != NULL) {
+        entry_hash_remove(section, entry);
         list_delete(&entry->list, &section->entry_head);
         free(entry);
     }
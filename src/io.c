@@ -30,6 +30,7 @@
 #include "cpu.h"
 #include <86box/m_amstrad.h>
 #include <86box/pci.h>
+#include <86box/profiler.h>
 
 #define NPORTS 65536 /* PC/AT supports 64K ports */
 
@@ -42,6 +43,10 @@ typedef struct _io_ {
     void (*outw)(uint16_t addr, uint16_t val, void *priv);
     void (*outl)(uint16_t addr, uint32_t val, void *priv);
 
+    /* Optional block transfer handlers, see io_set_block_handler(). */
+    int (*in_block)(uint16_t addr, void *buf, int size, int count, void *priv);
+    int (*out_block)(uint16_t addr, const void *buf, int size, int count, void *priv);
+
     void *priv;
 
     struct _io_ *prev, *next;
@@ -144,6 +149,8 @@ io_sethandler_common(uint16_t base, int size,
         q->priv = priv;
         q->next = NULL;
 
+        PROFILER_REGISTER(priv);
+
         io_last[base + c] = q;
     }
 }
@@ -331,6 +338,98 @@ io_debug_check_addr(uint16_t addr)
 }
 #endif
 
+/* Attaches block transfer handlers to the handler of port owned by priv. They
+   move up to count units of size bytes between the port and a host buffer and
+   return the number of units moved, which may be less than count (or zero) if
+   the device cannot satisfy the whole block, for example at the end of a
+   sector. The handlers are dropped along with the port handler. */
+void
+io_set_block_handler(uint16_t port,
+                     int (*in_block)(uint16_t addr, void *buf, int size, int count, void *priv),
+                     int (*out_block)(uint16_t addr, const void *buf, int size, int count, void *priv),
+                     void *priv)
+{
+    for (io_t *p = io[port]; p != NULL; p = p->next) {
+        if (p->priv == priv) {
+            p->in_block  = in_block;
+            p->out_block = out_block;
+            return;
+        }
+    }
+}
+
+/* Block transfers are only used when the port has a single handler and is not
+   subject to any of the special cases of the unit accessors. */
+static io_t *
+io_block_port(uint16_t port)
+{
+    io_t *p = io[port];
+
+    if ((p == NULL) || (p->next != NULL) || (amstrad_latch & 0x80000000))
+        return NULL;
+
+    if ((pci_flags & FLAG_CONFIG_IO_ON) && (port >= pci_base) && (port < (pci_base + pci_size)))
+        return NULL;
+
+    if ((pci_flags & FLAG_CONFIG_DEV0_IO_ON) && (port >= 0xc000) && (port < 0xc100))
+        return NULL;
+
+    return p;
+}
+
+/* Returns whether a block transfer in the given direction may be attempted on
+   port, so that callers can avoid gathering a block for ports without one. */
+int
+io_block_supported(uint16_t port, int out)
+{
+    io_t *p = io_block_port(port);
+
+    if (p == NULL)
+        return 0;
+
+    return out ? (p->out_block != NULL) : (p->in_block != NULL);
+}
+
+int
+io_block_in(uint16_t port, void *buf, int size, int count)
+{
+    io_t *p = io_block_port(port);
+    int   ret = 0;
+
+    if ((p == NULL) || (p->in_block == NULL))
+        return 0;
+
+#ifdef USE_DEBUG_REGS_486
+    io_debug_check_addr(port);
+#endif
+
+    PROFILER_CALL(PROFILER_IO, p->priv, ret = p->in_block(port, buf, size, count, p->priv));
+
+    io_log("[%04X:%08X] (%i) in block(%04X, %i) = %i/%i\n", CS, cpu_state.pc, in_smm, port, size, ret, count);
+
+    return ret;
+}
+
+int
+io_block_out(uint16_t port, const void *buf, int size, int count)
+{
+    io_t *p = io_block_port(port);
+    int   ret = 0;
+
+    if ((p == NULL) || (p->out_block == NULL))
+        return 0;
+
+#ifdef USE_DEBUG_REGS_486
+    io_debug_check_addr(port);
+#endif
+
+    PROFILER_CALL(PROFILER_IO, p->priv, ret = p->out_block(port, buf, size, count, p->priv));
+
+    io_log("[%04X:%08X] (%i) out block(%04X, %i) = %i/%i\n", CS, cpu_state.pc, in_smm, port, size, ret, count);
+
+    return ret;
+}
+
 uint8_t
 inb(uint16_t port)
 {
@@ -363,7 +462,7 @@ inb(uint16_t port)
         while (p) {
             q = p->next;
             if (p->inb) {
-                ret &= p->inb(port, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, ret &= p->inb(port, p->priv));
                 found |= 1;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -427,7 +526,7 @@ outb(uint16_t port, uint8_t val)
         while (p) {
             q = p->next;
             if (p->outb) {
-                p->outb(port, val, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, p->outb(port, val, p->priv));
                 found |= 1;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -483,7 +582,7 @@ inw(uint16_t port)
         while (p) {
             q = p->next;
             if (p->inw) {
-                ret &= p->inw(port, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, ret &= p->inw(port, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -499,7 +598,7 @@ inw(uint16_t port)
             while (p) {
                 q = p->next;
                 if (p->inb && !p->inw) {
-                    ret8[i] &= p->inb(port + i, p->priv);
+                    PROFILER_CALL(PROFILER_IO, p->priv, ret8[i] &= p->inb(port + i, p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
@@ -559,7 +658,7 @@ outw(uint16_t port, uint16_t val)
         while (p) {
             q = p->next;
             if (p->outw) {
-                p->outw(port, val, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, p->outw(port, val, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -573,7 +672,7 @@ outw(uint16_t port, uint16_t val)
             while (p) {
                 q = p->next;
                 if (p->outb && !p->outw) {
-                    p->outb(port + i, val >> (i << 3), p->priv);
+                    PROFILER_CALL(PROFILER_IO, p->priv, p->outb(port + i, val >> (i << 3), p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
@@ -631,7 +730,7 @@ inl(uint16_t port)
         while (p) {
             q = p->next;
             if (p->inl) {
-                ret &= p->inl(port, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, ret &= p->inl(port, p->priv));
                 found |= 4;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -646,7 +745,7 @@ inl(uint16_t port)
         while (p) {
             q = p->next;
             if (p->inw && !p->inl) {
-                ret16[0] &= p->inw(port, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, ret16[0] &= p->inw(port, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -659,7 +758,7 @@ inl(uint16_t port)
         while (p) {
             q = p->next;
             if (p->inw && !p->inl) {
-                ret16[1] &= p->inw(port + 2, p->priv);
+                PROFILER_CALL(PROFILER_IO, p->priv, ret16[1] &= p->inw(port + 2, p->priv));
                 found |= 2;
 #ifdef ENABLE_IO_LOG
                 qfound++;
@@ -678,7 +777,7 @@ inl(uint16_t port)
             while (p) {
                 q = p->next;
                 if (p->inb && !p->inw && !p->inl) {
-                    ret8[i] &= p->inb(port + i, p->priv);
+                    PROFILER_CALL(PROFILER_IO, p->priv, ret8[i] &= p->inb(port + i, p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
@@ -740,7 +839,7 @@ outl(uint16_t port, uint32_t val)
             while (p) {
                 q = p->next;
                 if (p->outl) {
-                    p->outl(port, val, p->priv);
+                    PROFILER_CALL(PROFILER_IO, p->priv, p->outl(port, val, p->priv));
                     found |= 4;
 #ifdef ENABLE_IO_LOG
                     qfound++;
@@ -755,7 +854,7 @@ outl(uint16_t port, uint32_t val)
             while (p) {
                 q = p->next;
                 if (p->outw && !p->outl) {
-                    p->outw(port + i, val >> (i << 3), p->priv);
+                    PROFILER_CALL(PROFILER_IO, p->priv, p->outw(port + i, val >> (i << 3), p->priv));
                     found |= 2;
 #ifdef ENABLE_IO_LOG
                     qfound++;
@@ -770,7 +869,7 @@ outl(uint16_t port, uint32_t val)
             while (p) {
                 q = p->next;
                 if (p->outb && !p->outw && !p->outl) {
-                    p->outb(port + i, val >> (i << 3), p->priv);
+                    PROFILER_CALL(PROFILER_IO, p->priv, p->outb(port + i, val >> (i << 3), p->priv));
                     found |= 1;
 #ifdef ENABLE_IO_LOG
                     qfound++;
@@ -15,6 +15,7 @@
 #include <86box/timer.h>
 #include <86box/device.h>
 #include <86box/network.h>
+#include <86box/snapshot.h>
 
 lpt_port_t lpt_ports[PARALLEL_MAX];
 
@@ -109,6 +110,39 @@ lpt_devices_close(void)
     }
 }
 
+/* Returns the first device attached to a parallel port, none of which can
+   be saved, or NULL if all the ports are empty. */
+const lpt_device_t *
+lpt_device_get_stateless(void)
+{
+    for (uint8_t i = 0; i < PARALLEL_MAX; i++) {
+        if ((lpt_ports[i].dt != NULL) && (lpt_ports[i].dt != &lpt_none_device))
+            return lpt_ports[i].dt;
+    }
+
+    return NULL;
+}
+
+void
+lpt_save_state(snapshot_t *s)
+{
+    for (uint8_t i = 0; i < PARALLEL_MAX; i++) {
+        SNAPSHOT_WRITE_VAR(s, lpt_ports[i].dat);
+        SNAPSHOT_WRITE_VAR(s, lpt_ports[i].ctrl);
+        SNAPSHOT_WRITE_VAR(s, lpt_ports[i].enable_irq);
+    }
+}
+
+void
+lpt_load_state(snapshot_t *s)
+{
+    for (uint8_t i = 0; i < PARALLEL_MAX; i++) {
+        SNAPSHOT_READ_VAR(s, lpt_ports[i].dat);
+        SNAPSHOT_READ_VAR(s, lpt_ports[i].ctrl);
+        SNAPSHOT_READ_VAR(s, lpt_ports[i].enable_irq);
+    }
+}
+
 void
 lpt_write(uint16_t port, uint8_t val, void *priv)
 {
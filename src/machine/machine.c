@@ -42,7 +42,9 @@
 #include <86box/pci.h>
 #include <86box/plat_unused.h>
 
-int bios_only = 0;
+/* Per thread, so that the UI can check for machine ROMs in the background
+   while the emulator is (re)initializing the machine. */
+_Thread_local int bios_only = 0;
 int machine;
 // int AT, PCI;
 
@@ -23,6 +23,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <wchar.h>
+#ifdef __linux__
+#    include <sys/mman.h>
+#endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/version.h>
@@ -38,6 +41,9 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/gdbstub.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
+#include <86box/profiler.h>
 #ifdef USE_DYNAREC
 #    include "codegen_public.h"
 #else
@@ -84,12 +90,12 @@ uint32_t pccache;
 uint8_t *pccache2;
 
 int        readlnext;
-int        readlookup[256];
+int       *readlookup;
 uintptr_t *readlookup2;
 uintptr_t  old_rl2;
 uint8_t    uncached = 0;
 int        writelnext;
-int        writelookup[256];
+int       *writelookup;
 uintptr_t *writelookup2;
 
 uint32_t mem_logical_addr;
@@ -98,7 +104,9 @@ int shadowbios = 0;
 int shadowbios_write;
 int readlnum  = 0;
 int writelnum = 0;
-int cachesize = 256;
+int cachesize = MMU_TLB_DEFAULT;
+
+mmu_tlb_stats_t mmu_tlb_stats;
 
 uint32_t get_phys_virt;
 uint32_t get_phys_phys;
@@ -125,10 +133,18 @@ mem_mapping_t        *write_mapping[MEM_MAPPINGS_NO];
 
 uint8_t              *_mem_exec[MEM_MAPPINGS_NO];
 
+#define MMU_TLB_NOTES 4 /* page walks remembered for the entries added after them */
+
 /* FIXME: re-do this with a 'mem_ops' struct. */
 static uint8_t       *page_lookupp; /* pagetable mmu_perm lookup */
 static uint8_t       *readlookupp;
 static uint8_t       *writelookupp;
+static uint8_t       *readlookupf;  /* MMU_TLB_* flags of each ring slot */
+static uint8_t       *writelookupf;
+static int            tlb_size;     /* current size of the rings */
+static uint32_t       tlb_note_vpage[MMU_TLB_NOTES];
+static uint8_t        tlb_note_flags[MMU_TLB_NOTES];
+static uint8_t        tlb_large;    /* any large page entries in the rings */
 static mem_mapping_t *base_mapping;
 static mem_mapping_t *last_mapping;
 static mem_mapping_t *read_mapping_bus[MEM_MAPPINGS_NO];
@@ -164,6 +180,53 @@ mem_log(const char *fmt, ...)
 #    define mem_log(fmt, ...)
 #endif
 
+/* Mapping handler dispatch, wrapped so that the profiler can attribute the
+   time spent in them to the owning device. */
+static __inline uint8_t
+mem_mapping_read_b(mem_mapping_t *map, uint32_t addr)
+{
+    uint8_t ret;
+
+    PROFILER_CALL(PROFILER_MMIO, map->priv, ret = map->read_b(addr, map->priv));
+    return ret;
+}
+
+static __inline uint16_t
+mem_mapping_read_w(mem_mapping_t *map, uint32_t addr)
+{
+    uint16_t ret;
+
+    PROFILER_CALL(PROFILER_MMIO, map->priv, ret = map->read_w(addr, map->priv));
+    return ret;
+}
+
+static __inline uint32_t
+mem_mapping_read_l(mem_mapping_t *map, uint32_t addr)
+{
+    uint32_t ret;
+
+    PROFILER_CALL(PROFILER_MMIO, map->priv, ret = map->read_l(addr, map->priv));
+    return ret;
+}
+
+static __inline void
+mem_mapping_write_b(mem_mapping_t *map, uint32_t addr, uint8_t val)
+{
+    PROFILER_CALL(PROFILER_MMIO, map->priv, map->write_b(addr, val, map->priv));
+}
+
+static __inline void
+mem_mapping_write_w(mem_mapping_t *map, uint32_t addr, uint16_t val)
+{
+    PROFILER_CALL(PROFILER_MMIO, map->priv, map->write_w(addr, val, map->priv));
+}
+
+static __inline void
+mem_mapping_write_l(mem_mapping_t *map, uint32_t addr, uint32_t val)
+{
+    PROFILER_CALL(PROFILER_MMIO, map->priv, map->write_l(addr, val, map->priv));
+}
+
 int
 mem_addr_is_ram(uint32_t addr)
 {
@@ -176,14 +239,31 @@ mem_addr_is_ram(uint32_t addr)
 void
 resetreadlookup(void)
 {
+    int size = MMU_TLB_MIN;
+
+    /* The rings are indexed with a mask, so round the size up to a power of two. */
+    while ((size < cachesize) && (size < MMU_TLB_MAX))
+        size <<= 1;
+    cachesize = size;
+
+    if (tlb_size != cachesize) {
+        readlookup   = realloc(readlookup, cachesize * sizeof(int));
+        writelookup  = realloc(writelookup, cachesize * sizeof(int));
+        readlookupf  = realloc(readlookupf, cachesize);
+        writelookupf = realloc(writelookupf, cachesize);
+        tlb_size     = cachesize;
+    }
+
     /* Initialize the page lookup table. */
     memset(page_lookup, 0x00, (1 << 20) * sizeof(page_t *));
 
-    /* Initialize the tables for lower (<= 1024K) RAM. */
-    for (uint16_t c = 0; c < 256; c++) {
+    /* Initialize the translation rings. */
+    for (int c = 0; c < cachesize; c++) {
         readlookup[c]  = 0xffffffff;
         writelookup[c] = 0xffffffff;
     }
+    memset(readlookupf, 0x00, cachesize);
+    memset(writelookupf, 0x00, cachesize);
 
     /* Initialize the tables for high (> 1024K) RAM. */
     memset(readlookup2, 0xff, (1 << 20) * sizeof(uintptr_t));
@@ -194,32 +274,93 @@ resetreadlookup(void)
 
     readlnext  = 0;
     writelnext = 0;
+    readlnum   = 0;
+    writelnum  = 0;
+    tlb_large  = 0;
     pccache    = 0xffffffff;
+    memset(tlb_note_vpage, 0xff, sizeof(tlb_note_vpage));
     high_page  = 0;
+
+    pccache_2386 = 0xffffffff;
+}
+
+static __inline void
+mmu_tlb_invalidate_read(uint32_t vpage)
+{
+    readlookup2[vpage] = LOOKUP_INV;
+    readlookupp[vpage] = 4;
+}
+
+static __inline void
+mmu_tlb_invalidate_write(uint32_t vpage)
+{
+    page_lookup[vpage]  = NULL;
+    page_lookupp[vpage] = 4;
+    writelookup2[vpage] = LOOKUP_INV;
+    writelookupp[vpage] = 4;
+}
+
+/*
+ * Empties the translation rings, optionally keeping the entries of global
+ * pages, which survive CR3 loads when CR4.PGE is set. The kept entries are
+ * packed at the start of the rings so that only the slots filled since are
+ * walked by the next flush.
+ */
+static void
+mmu_tlb_flush(int keep_global)
+{
+    int kept  = 0;
+    int large = 0;
+
+    for (int c = 0; c < readlnum; c++) {
+        if (readlookup[c] == (int) 0xffffffff)
+            continue;
+        if (keep_global && (readlookupf[c] & MMU_TLB_GLOBAL)) {
+            large |= readlookupf[c] & MMU_TLB_LARGE;
+            readlookupf[kept]  = readlookupf[c];
+            readlookup[kept++] = readlookup[c];
+        } else
+            mmu_tlb_invalidate_read(readlookup[c]);
+    }
+    for (int c = kept; c < readlnum; c++)
+        readlookup[c] = 0xffffffff;
+    mmu_tlb_stats.kept_global += kept;
+    readlnum  = kept;
+    readlnext = kept & (cachesize - 1);
+
+    kept = 0;
+    for (int c = 0; c < writelnum; c++) {
+        if (writelookup[c] == (int) 0xffffffff)
+            continue;
+        if (keep_global && (writelookupf[c] & MMU_TLB_GLOBAL)) {
+            large |= writelookupf[c] & MMU_TLB_LARGE;
+            writelookupf[kept]  = writelookupf[c];
+            writelookup[kept++] = writelookup[c];
+        } else
+            mmu_tlb_invalidate_write(writelookup[c]);
+    }
+    for (int c = kept; c < writelnum; c++)
+        writelookup[c] = 0xffffffff;
+    mmu_tlb_stats.kept_global += kept;
+    writelnum  = kept;
+    writelnext = kept & (cachesize - 1);
+
+    tlb_large = large;
+    memset(tlb_note_vpage, 0xff, sizeof(tlb_note_vpage));
 }
 
 void
 flushmmucache(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookupp[readlookup[c]] = 4;
-            readlookup[c]              = 0xffffffff;
-        }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            page_lookupp[writelookup[c]] = 4;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookupp[writelookup[c]] = 4;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    mmu_tlb_flush(0);
+    mmu_tlb_stats.flush_full++;
     mmuflush++;
 
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
 
+    pccache_2386 = 0xffffffff;
+
 #ifdef USE_DYNAREC
     codegen_flush();
 #endif
@@ -233,6 +374,8 @@ flushmmucache_pc(void)
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
 
+    pccache_2386 = 0xffffffff;
+
 #ifdef USE_DYNAREC
     codegen_flush();
 #endif
@@ -241,20 +384,67 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookupp[readlookup[c]] = 4;
-            readlookup[c]              = 0xffffffff;
+    mmu_tlb_flush(0);
+    mmu_tlb_stats.flush_full++;
+
+    pccache_2386 = 0xffffffff;
+}
+
+/* Flush on a CR3 load, which leaves global pages in place. */
+void
+flushmmucache_cr3(void)
+{
+    mmu_tlb_flush(!!(cr4 & CR4_PGE));
+    mmu_tlb_stats.flush_cr3++;
+    mmuflush++;
+
+    pccache  = (uint32_t) 0xffffffff;
+    pccache2 = (uint8_t *) 0xffffffff;
+
+    pccache_2386 = 0xffffffff;
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
+}
+
+/*
+ * INVLPG: drop the translations of a single page, global or not. A large
+ * page is held as 4K entries, so all of those within it are dropped too.
+ */
+void
+mmu_invlpg(uint32_t addr)
+{
+    uint32_t vpage = addr >> 12;
+    int      shift = (cr4 & CR4_PAE) ? 9 : 10;
+
+    mmu_tlb_invalidate_read(vpage);
+    mmu_tlb_invalidate_write(vpage);
+    memset(tlb_note_vpage, 0xff, sizeof(tlb_note_vpage));
+
+    if (tlb_large) {
+        for (int c = 0; c < readlnum; c++) {
+            if ((readlookup[c] != (int) 0xffffffff) && (readlookupf[c] & MMU_TLB_LARGE) &&
+                (((uint32_t) readlookup[c] >> shift) == (vpage >> shift))) {
+                mmu_tlb_invalidate_read(readlookup[c]);
+                readlookup[c] = 0xffffffff;
+            }
         }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            page_lookupp[writelookup[c]] = 4;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookupp[writelookup[c]] = 4;
-            writelookup[c]               = 0xffffffff;
+        for (int c = 0; c < writelnum; c++) {
+            if ((writelookup[c] != (int) 0xffffffff) && (writelookupf[c] & MMU_TLB_LARGE) &&
+                (((uint32_t) writelookup[c] >> shift) == (vpage >> shift))) {
+                mmu_tlb_invalidate_write(writelookup[c]);
+                writelookup[c] = 0xffffffff;
+            }
         }
     }
+
+    mmu_tlb_stats.flush_invlpg++;
+
+    pccache  = (uint32_t) 0xffffffff;
+    pccache2 = (uint8_t *) 0xffffffff;
+
+    pccache_2386 = 0xffffffff;
 }
 
 void
@@ -265,7 +455,7 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
     uint32_t a;
 #endif
 
-    for (uint16_t c = 0; c < 256; c++) {
+    for (int c = 0; c < writelnum; c++) {
         if (writelookup[c] != (int) 0xffffffff) {
 #if (defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64)
             uintptr_t target = (uintptr_t) &ram[(uintptr_t) (addr & ~0xfff) - (virt & ~0xfff)];
@@ -293,6 +483,31 @@ mem_flush_write_page(uint32_t addr, uint32_t virt)
 #define rammap(x)                ((uint32_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 2) & MEM_GRANULARITY_QMASK]
 #define rammap64(x)              ((uint64_t *) (_mem_exec[(x) >> MEM_GRANULARITY_BITS]))[((x) >> 3) & MEM_GRANULARITY_PMASK]
 
+/* Remember what kind of mapping a walk found, for the ring entry that
+   addreadlookup()/addwritelookup() may add for the same page. A cross-page
+   access walks both pages before adding either, so the notes are kept per
+   page rather than for the last walk only. */
+static __inline void
+mmu_tlb_note(uint32_t addr, uint64_t pte, int large)
+{
+    int n = (addr >> 12) & (MMU_TLB_NOTES - 1);
+
+    tlb_note_vpage[n] = addr >> 12;
+    tlb_note_flags[n] = large ? MMU_TLB_LARGE : 0;
+    if ((cr4 & CR4_PGE) && (pte & 0x100))
+        tlb_note_flags[n] |= MMU_TLB_GLOBAL;
+}
+
+/* Flags of a new ring entry; one whose walk is no longer known is taken to be
+   part of a large page, so that INVLPG anywhere near it still drops it. */
+static __inline uint8_t
+mmu_tlb_flags(uint32_t vpage)
+{
+    int n = vpage & (MMU_TLB_NOTES - 1);
+
+    return (tlb_note_vpage[n] == vpage) ? tlb_note_flags[n] : MMU_TLB_LARGE;
+}
+
 static __inline uint64_t
 mmutranslatereal_normal(uint32_t addr, int rw)
 {
@@ -335,6 +550,7 @@ mmutranslatereal_normal(uint32_t addr, int rw)
 
         mmu_perm = temp & 4;
         rammap(addr2) |= (rw ? 0x60 : 0x20);
+        mmu_tlb_note(addr, temp, 1);
 
         return (temp & ~0x3fffff) + (addr & 0x3fffff);
     }
@@ -356,6 +572,7 @@ mmutranslatereal_normal(uint32_t addr, int rw)
     mmu_perm = temp & 4;
     rammap(addr2) |= 0x20;
     rammap((temp2 & ~0xfff) + ((addr >> 10) & 0xffc)) |= (rw ? 0x60 : 0x20);
+    mmu_tlb_note(addr, temp, 0);
 
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
@@ -419,6 +636,7 @@ mmutranslatereal_pae(uint32_t addr, int rw)
         }
         mmu_perm = temp & 4;
         rammap64(addr3) |= (rw ? 0x60 : 0x20);
+        mmu_tlb_note(addr, temp, 1);
 
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffffULL)) & 0x000000ffffffffffULL;
     }
@@ -441,6 +659,7 @@ mmutranslatereal_pae(uint32_t addr, int rw)
     mmu_perm = temp & 4;
     rammap64(addr3) |= 0x20;
     rammap64(addr4) |= (rw ? 0x60 : 0x20);
+    mmu_tlb_note(addr, temp, 0);
 
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
 }
@@ -452,6 +671,8 @@ mmutranslatereal(uint32_t addr, int rw)
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    mmu_tlb_stats.walks++;
+
     if (cr4 & CR4_PAE)
         return mmutranslatereal_pae(addr, rw);
     else
@@ -612,8 +833,13 @@ addreadlookup(uint32_t virt, uint32_t phys)
 #endif
     readlookupp[virt >> 12] = mmu_perm;
 
+    readlookupf[readlnext] = mmu_tlb_flags(virt >> 12);
+    tlb_large |= readlookupf[readlnext] & MMU_TLB_LARGE;
     readlookup[readlnext++] = virt >> 12;
+    if (readlnext > readlnum)
+        readlnum = readlnext;
     readlnext &= (cachesize - 1);
+    mmu_tlb_stats.fills++;
 
     cycles -= 9;
 }
@@ -665,8 +891,13 @@ addwritelookup(uint32_t virt, uint32_t phys)
     }
     writelookupp[virt >> 12] = mmu_perm;
 
+    writelookupf[writelnext] = mmu_tlb_flags(virt >> 12);
+    tlb_large |= writelookupf[writelnext] & MMU_TLB_LARGE;
     writelookup[writelnext++] = virt >> 12;
+    if (writelnext > writelnum)
+        writelnum = writelnext;
     writelnext &= (cachesize - 1);
+    mmu_tlb_stats.fills++;
 
     cycles -= 9;
 }
@@ -723,7 +954,7 @@ read_mem_b(uint32_t addr)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        ret = map->read_b(addr, map->priv);
+        ret = mem_mapping_read_b(map, addr);
 
     resub_cycles(old_cycles);
 
@@ -746,9 +977,9 @@ read_mem_w(uint32_t addr)
         map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
         if (map && map->read_w)
-            ret = map->read_w(addr, map->priv);
+            ret = mem_mapping_read_w(map, addr);
         else if (map && map->read_b)
-            ret = map->read_b(addr, map->priv) | (map->read_b(addr + 1, map->priv) << 8);
+            ret = mem_mapping_read_b(map, addr) | (mem_mapping_read_b(map, addr + 1) << 8);
     }
 
     resub_cycles(old_cycles);
@@ -767,7 +998,7 @@ write_mem_b(uint32_t addr, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 
     resub_cycles(old_cycles);
 }
@@ -788,10 +1019,10 @@ write_mem_w(uint32_t addr, uint16_t val)
         map = write_mapping[addr >> MEM_GRANULARITY_BITS];
         if (map) {
             if (map->write_w)
-                map->write_w(addr, val, map->priv);
+                mem_mapping_write_w(map, addr, val);
             else if (map->write_b) {
-                map->write_b(addr, val, map->priv);
-                map->write_b(addr + 1, val >> 8, map->priv);
+                mem_mapping_write_b(map, addr, val);
+                mem_mapping_write_b(map, addr + 1, val >> 8);
             }
         }
     }
@@ -826,7 +1057,7 @@ readmembl(uint32_t addr)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        return map->read_b(addr, map->priv);
+        return mem_mapping_read_b(map, addr);
 
     return 0xff;
 }
@@ -863,7 +1094,7 @@ writemembl(uint32_t addr, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 /* Read a byte from memory without MMU translation - result of previous MMU translation passed as value. */
@@ -886,7 +1117,7 @@ readmembl_no_mmut(uint32_t addr, uint32_t a64)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_b)
-        return map->read_b(addr, map->priv);
+        return mem_mapping_read_b(map, addr);
 
     return 0xff;
 }
@@ -916,7 +1147,7 @@ writemembl_no_mmut(uint32_t addr, uint32_t a64, uint8_t val)
 
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->write_b)
-        map->write_b(addr, val, map->priv);
+        mem_mapping_write_b(map, addr, val);
 }
 
 uint16_t
@@ -972,10 +1203,10 @@ readmemwl(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv);
+        return mem_mapping_read_w(map, addr);
 
     if (map && map->read_b) {
-        return map->read_b(addr, map->priv) | ((uint16_t) (map->read_b(addr + 1, map->priv)) << 8);
+        return mem_mapping_read_b(map, addr) | ((uint16_t) (mem_mapping_read_b(map, addr + 1)) << 8);
     }
 
     return 0xffff;
@@ -1048,13 +1279,13 @@ writememwl(uint32_t addr, uint16_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
         return;
     }
 
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
         return;
     }
 }
@@ -1096,10 +1327,10 @@ readmemwl_no_mmut(uint32_t addr, uint32_t *a64)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv);
+        return mem_mapping_read_w(map, addr);
 
     if (map && map->read_b) {
-        return map->read_b(addr, map->priv) | ((uint16_t) (map->read_b(addr + 1, map->priv)) << 8);
+        return mem_mapping_read_b(map, addr) | ((uint16_t) (mem_mapping_read_b(map, addr + 1)) << 8);
     }
 
     return 0xffff;
@@ -1151,13 +1382,13 @@ writememwl_no_mmut(uint32_t addr, uint32_t *a64, uint16_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
         return;
     }
 
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
         return;
     }
 }
@@ -1229,13 +1460,13 @@ readmemll(uint32_t addr)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv);
+        return mem_mapping_read_l(map, addr);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) | ((uint32_t) (map->read_w(addr + 2, map->priv)) << 16);
+        return mem_mapping_read_w(map, addr) | ((uint32_t) (mem_mapping_read_w(map, addr + 2)) << 16);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) | ((uint32_t) (map->read_b(addr + 1, map->priv)) << 8) | ((uint32_t) (map->read_b(addr + 2, map->priv)) << 16) | ((uint32_t) (map->read_b(addr + 3, map->priv)) << 24);
+        return mem_mapping_read_b(map, addr) | ((uint32_t) (mem_mapping_read_b(map, addr + 1)) << 8) | ((uint32_t) (mem_mapping_read_b(map, addr + 2)) << 16) | ((uint32_t) (mem_mapping_read_b(map, addr + 3)) << 24);
 
     return 0xffffffff;
 }
@@ -1320,19 +1551,19 @@ writememll(uint32_t addr, uint32_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
         return;
     }
 }
@@ -1374,13 +1605,13 @@ readmemll_no_mmut(uint32_t addr, uint32_t *a64)
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->read_l)
-        return map->read_l(addr, map->priv);
+        return mem_mapping_read_l(map, addr);
 
     if (map && map->read_w)
-        return map->read_w(addr, map->priv) | ((uint32_t) (map->read_w(addr + 2, map->priv)) << 16);
+        return mem_mapping_read_w(map, addr) | ((uint32_t) (mem_mapping_read_w(map, addr + 2)) << 16);
 
     if (map && map->read_b)
-        return map->read_b(addr, map->priv) | ((uint32_t) (map->read_b(addr + 1, map->priv)) << 8) | ((uint32_t) (map->read_b(addr + 2, map->priv)) << 16) | ((uint32_t) (map->read_b(addr + 3, map->priv)) << 24);
+        return mem_mapping_read_b(map, addr) | ((uint32_t) (mem_mapping_read_b(map, addr + 1)) << 8) | ((uint32_t) (mem_mapping_read_b(map, addr + 2)) << 16) | ((uint32_t) (mem_mapping_read_b(map, addr + 3)) << 24);
 
     return 0xffffffff;
 }
@@ -1431,19 +1662,19 @@ writememll_no_mmut(uint32_t addr, uint32_t *a64, uint32_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
         return;
     }
 }
@@ -1513,7 +1744,7 @@ readmemql(uint32_t addr)
 
     map = read_mapping[addr >> MEM_GRANULARITY_BITS];
     if (map && map->read_l)
-        return map->read_l(addr, map->priv) | ((uint64_t) map->read_l(addr + 4, map->priv) << 32);
+        return mem_mapping_read_l(map, addr) | ((uint64_t) mem_mapping_read_l(map, addr + 4) << 32);
 
     return readmemll(addr) | ((uint64_t) readmemll(addr + 4) << 32);
 }
@@ -1596,26 +1827,26 @@ writememql(uint32_t addr, uint64_t val)
     map = write_mapping[addr >> MEM_GRANULARITY_BITS];
 
     if (map && map->write_l) {
-        map->write_l(addr, val, map->priv);
-        map->write_l(addr + 4, val >> 32, map->priv);
+        mem_mapping_write_l(map, addr, val);
+        mem_mapping_write_l(map, addr + 4, val >> 32);
         return;
     }
     if (map && map->write_w) {
-        map->write_w(addr, val, map->priv);
-        map->write_w(addr + 2, val >> 16, map->priv);
-        map->write_w(addr + 4, val >> 32, map->priv);
-        map->write_w(addr + 6, val >> 48, map->priv);
+        mem_mapping_write_w(map, addr, val);
+        mem_mapping_write_w(map, addr + 2, val >> 16);
+        mem_mapping_write_w(map, addr + 4, val >> 32);
+        mem_mapping_write_w(map, addr + 6, val >> 48);
         return;
     }
     if (map && map->write_b) {
-        map->write_b(addr, val, map->priv);
-        map->write_b(addr + 1, val >> 8, map->priv);
-        map->write_b(addr + 2, val >> 16, map->priv);
-        map->write_b(addr + 3, val >> 24, map->priv);
-        map->write_b(addr + 4, val >> 32, map->priv);
-        map->write_b(addr + 5, val >> 40, map->priv);
-        map->write_b(addr + 6, val >> 48, map->priv);
-        map->write_b(addr + 7, val >> 56, map->priv);
+        mem_mapping_write_b(map, addr, val);
+        mem_mapping_write_b(map, addr + 1, val >> 8);
+        mem_mapping_write_b(map, addr + 2, val >> 16);
+        mem_mapping_write_b(map, addr + 3, val >> 24);
+        mem_mapping_write_b(map, addr + 4, val >> 32);
+        mem_mapping_write_b(map, addr + 5, val >> 40);
+        mem_mapping_write_b(map, addr + 6, val >> 48);
+        mem_mapping_write_b(map, addr + 7, val >> 56);
         return;
     }
 }
@@ -1682,7 +1913,7 @@ mem_readb_phys(uint32_t addr)
         if (cpu_use_exec && map->exec)
             ret = map->exec[(addr - map->base) & map->mask];
         else if (map->read_b)
-            ret = map->read_b(addr, map->priv);
+            ret = mem_mapping_read_b(map, addr);
     }
 
     return ret;
@@ -1701,7 +1932,7 @@ mem_readw_phys(uint32_t addr)
         p   = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         ret = *p;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->read_w))
-        ret = map->read_w(addr, map->priv);
+        ret = mem_mapping_read_w(map, addr);
     else {
         ret = mem_readb_phys(addr + 1) << 8;
         ret |= mem_readb_phys(addr);
@@ -1723,7 +1954,7 @@ mem_readl_phys(uint32_t addr)
         p   = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         ret = *p;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->read_l))
-        ret = map->read_l(addr, map->priv);
+        ret = mem_mapping_read_l(map, addr);
     else {
         ret = mem_readw_phys(addr + 2) << 16;
         ret |= mem_readw_phys(addr);
@@ -1732,6 +1963,39 @@ mem_readl_phys(uint32_t addr)
     return ret;
 }
 
+/* Returns a host pointer to len bytes at physical address addr if the whole
+   range lies within one page of a directly backed mapping, or NULL if the
+   access has to go through the mapping handlers. Write pointers are only
+   handed out for plain RAM, whose pages are marked dirty here so that any
+   code recompiled from them is thrown away; anything else with a write
+   handler (flash, shadowed ROM, etc.) must see the writes. */
+uint8_t *
+mem_get_phys_ptr(uint32_t addr, uint32_t len, int write)
+{
+    mem_mapping_t *map;
+    uint32_t       offs;
+
+    if (!cpu_use_exec || !len || ((addr & MEM_GRANULARITY_MASK) + len > MEM_GRANULARITY_SIZE))
+        return NULL;
+
+    map = write ? write_mapping_bus[addr >> MEM_GRANULARITY_BITS] : read_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+    if (!map || !map->exec)
+        return NULL;
+
+    if (write && ((map->write_b != mem_write_ram) || (map->write_w != mem_write_ramw) ||
+                  (map->write_l != mem_write_raml)))
+        return NULL;
+
+    offs = (addr - map->base) & map->mask;
+    if (((addr + len - 1 - map->base) & map->mask) != (offs + len - 1))
+        return NULL;
+
+    if (write)
+        mem_invalidate_range(addr, addr + len - 1);
+
+    return &(map->exec[offs]);
+}
+
 void
 mem_read_phys(void *dest, uint32_t addr, int transfer_size)
 {
@@ -1762,7 +2026,7 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
         if (cpu_use_exec && map->exec)
             map->exec[(addr - map->base) & map->mask] = val;
         else if (map->write_b)
-            map->write_b(addr, val, map->priv);
+            mem_mapping_write_b(map, addr, val);
     }
 }
 
@@ -1778,7 +2042,7 @@ mem_writew_phys(uint32_t addr, uint16_t val)
         p  = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
-        map->write_w(addr, val, map->priv);
+        mem_mapping_write_w(map, addr, val);
     else {
         mem_writeb_phys(addr, val & 0xff);
         mem_writeb_phys(addr + 1, (val >> 8) & 0xff);
@@ -1797,7 +2061,7 @@ mem_writel_phys(uint32_t addr, uint32_t val)
         p  = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
-        map->write_l(addr, val, map->priv);
+        mem_mapping_write_l(map, addr, val);
     else {
         mem_writew_phys(addr, val & 0xffff);
         mem_writew_phys(addr + 2, (val >> 16) & 0xffff);
@@ -2540,6 +2804,8 @@ mem_mapping_add(mem_mapping_t *map,
     }
     last_mapping = map;
 
+    PROFILER_REGISTER(priv);
+
     mem_mapping_set(map, base, size, read_b, read_w, read_l,
                     write_b, write_w, write_l, exec, fl, priv);
 }
@@ -2733,6 +2999,36 @@ mem_init_ram_mapping(mem_mapping_t *mapping, uint32_t base, uint32_t size)
     mem_add_ram_mapping(mapping, base, size);
 }
 
+/* The RAM blocks come zeroed from plat_mmap() and are deliberately not
+   cleared again, so that pages the guest never touches stay unbacked (and
+   shareable) on the host. */
+static void
+mem_advise_ram(void *ptr, size_t size)
+{
+#ifdef __linux__
+    switch (ram_advice) {
+#    ifdef MADV_MERGEABLE
+        case RAM_ADVICE_MERGEABLE:
+            if (madvise(ptr, size, MADV_MERGEABLE) != 0)
+                pclog("MEM: Unable to mark the RAM as mergeable\n");
+            break;
+#    endif
+#    ifdef MADV_HUGEPAGE
+        case RAM_ADVICE_HUGEPAGE:
+            if (madvise(ptr, size, MADV_HUGEPAGE) != 0)
+                pclog("MEM: Unable to back the RAM with huge pages\n");
+            break;
+#    endif
+
+        default:
+            break;
+    }
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
+
 /* Reset the memory state. */
 void
 mem_reset(void)
@@ -2780,15 +3076,15 @@ mem_reset(void)
 #if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
     if (mem_size > 1048576) {
         ram_size = 1 << 30;
-        ram      = (uint8_t *) plat_mmap(ram_size, 0); /* allocate and clear the RAM block of the first 1 GB */
+        ram      = (uint8_t *) plat_mmap(ram_size, 0); /* allocate the (zeroed) RAM block of the first 1 GB */
         if (ram == NULL) {
             fatal("Failed to allocate primary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size);
+        mem_advise_ram(ram, ram_size);
         ram2_size = m - (1 << 30);
         /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram2      = (uint8_t *) plat_mmap(ram2_size + 16, 0); /* allocate and clear the RAM block above 1 GB */
+        ram2      = (uint8_t *) plat_mmap(ram2_size + 16, 0); /* allocate the (zeroed) RAM block above 1 GB */
         if (ram2 == NULL) {
             if (config_changed == 2)
                 fatal(EMU_NAME " must be restarted for the memory amount change to be applied.\n");
@@ -2796,18 +3092,18 @@ mem_reset(void)
                 fatal("Failed to allocate secondary RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram2, 0x00, ram2_size + 16);
+        mem_advise_ram(ram2, ram2_size + 16);
     } else
 #endif
     {
         ram_size = m;
         /* Allocate 16 extra bytes of RAM to mitigate some dynarec recompiler memory access quirks. */
-        ram      = (uint8_t *) plat_mmap(ram_size + 16, 0); /* allocate and clear the RAM block */
+        ram      = (uint8_t *) plat_mmap(ram_size + 16, 0); /* allocate the (zeroed) RAM block */
         if (ram == NULL) {
             fatal("Failed to allocate RAM block. Make sure you have enough RAM available.\n");
             return;
         }
-        memset(ram, 0x00, ram_size + 16);
+        mem_advise_ram(ram, ram_size + 16);
         if (mem_size > 1048576)
             ram2 = &(ram[1 << 30]);
     }
@@ -2962,6 +3258,8 @@ mem_init(void)
     readlookupp  = malloc((1 << 20) * sizeof(uint8_t));
     writelookup2 = malloc((1 << 20) * sizeof(uintptr_t));
     writelookupp = malloc((1 << 20) * sizeof(uint8_t));
+
+    resetreadlookup();
 }
 
 static void
@@ -3178,3 +3476,162 @@ mem_a20_recalc(void)
 
     mem_a20_state = state;
 }
+
+/* Converts an exec pointer to a position independent form: no pointer, an
+   offset into RAM or the BIOS ROM, or (region 4) a buffer owned by a device,
+   which the device restores itself. */
+static void
+mem_save_exec(snapshot_t *s, const uint8_t *exec)
+{
+    uint8_t  region = 4;
+    uint64_t offset = 0;
+
+    if (exec == NULL)
+        region = 0;
+    else if ((exec >= ram) && (exec < (ram + ram_size))) {
+        region = 1;
+        offset = exec - ram;
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    } else if ((ram2 != NULL) && (exec >= ram2) && (exec < (ram2 + ram2_size))) {
+        region = 2;
+        offset = exec - ram2;
+#endif
+    } else if ((rom != NULL) && (exec >= rom) && (exec <= (rom + biosmask))) {
+        region = 3;
+        offset = exec - rom;
+    }
+
+    snapshot_write_u8(s, region);
+    snapshot_write_u64(s, offset);
+}
+
+static uint8_t *
+mem_load_exec(snapshot_t *s, uint8_t *exec)
+{
+    uint8_t  region = snapshot_read_u8(s);
+    uint64_t offset = snapshot_read_u64(s);
+
+    switch (region) {
+        case 0:
+            return NULL;
+        case 1:
+            return ram + offset;
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+        case 2:
+            return ram2 + offset;
+#endif
+        case 3:
+            return rom + offset;
+
+        default:
+            /* Not backed by RAM or the BIOS, leave it to the owner. */
+            return exec;
+    }
+}
+
+void
+mem_save_state(snapshot_t *s)
+{
+    mem_mapping_t *map;
+    uint32_t       count = 0;
+
+    snapshot_write_u64(s, ram_size);
+    snapshot_write_ram(s, ram, ram_size);
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    snapshot_write_u64(s, ram2_size);
+    if (ram2_size)
+        snapshot_write_ram(s, ram2, ram2_size);
+#endif
+
+    snapshot_write(s, _mem_state, sizeof(_mem_state));
+    snapshot_write(s, _mem_wp, sizeof(_mem_wp));
+    snapshot_write(s, _mem_wp_bus, sizeof(_mem_wp_bus));
+
+    SNAPSHOT_WRITE_VAR(s, rammask);
+    SNAPSHOT_WRITE_VAR(s, mem_a20_key);
+    SNAPSHOT_WRITE_VAR(s, mem_a20_alt);
+    SNAPSHOT_WRITE_VAR(s, mem_a20_state);
+    SNAPSHOT_WRITE_VAR(s, shadowbios);
+    SNAPSHOT_WRITE_VAR(s, shadowbios_write);
+    SNAPSHOT_WRITE_VAR(s, remap_start_addr);
+    SNAPSHOT_WRITE_VAR(s, remap_start_addr2);
+
+    /* The mappings are created in the same order for the same configuration,
+       so only the fields that change at run time are needed. */
+    for (map = base_mapping; map != NULL; map = map->next)
+        count++;
+    snapshot_write_u32(s, count);
+
+    for (map = base_mapping; map != NULL; map = map->next) {
+        snapshot_write_u32(s, map->enable);
+        snapshot_write_u32(s, map->base);
+        snapshot_write_u32(s, map->size);
+        snapshot_write_u32(s, map->mask);
+        snapshot_write_u32(s, map->flags);
+        mem_save_exec(s, map->exec);
+    }
+}
+
+void
+mem_load_state(snapshot_t *s)
+{
+    mem_mapping_t *map;
+    uint64_t       size;
+    uint32_t       count = 0;
+
+    size = snapshot_read_u64(s);
+    if (size != ram_size) {
+        snapshot_set_error(s, "RAM size mismatch");
+        return;
+    }
+    snapshot_read_ram(s, ram, ram_size);
+#if (!(defined __amd64__ || defined _M_X64 || defined __aarch64__ || defined _M_ARM64))
+    size = snapshot_read_u64(s);
+    if (size != ram2_size) {
+        snapshot_set_error(s, "RAM size mismatch");
+        return;
+    }
+    if (ram2_size)
+        snapshot_read_ram(s, ram2, ram2_size);
+#endif
+
+    snapshot_read(s, _mem_state, sizeof(_mem_state));
+    snapshot_read(s, _mem_wp, sizeof(_mem_wp));
+    snapshot_read(s, _mem_wp_bus, sizeof(_mem_wp_bus));
+
+    SNAPSHOT_READ_VAR(s, rammask);
+    SNAPSHOT_READ_VAR(s, mem_a20_key);
+    SNAPSHOT_READ_VAR(s, mem_a20_alt);
+    SNAPSHOT_READ_VAR(s, mem_a20_state);
+    SNAPSHOT_READ_VAR(s, shadowbios);
+    SNAPSHOT_READ_VAR(s, shadowbios_write);
+    SNAPSHOT_READ_VAR(s, remap_start_addr);
+    SNAPSHOT_READ_VAR(s, remap_start_addr2);
+
+    for (map = base_mapping; map != NULL; map = map->next)
+        count++;
+    if (snapshot_read_u32(s) != count) {
+        snapshot_set_error(s, "Memory mapping count mismatch");
+        return;
+    }
+
+    for (map = base_mapping; map != NULL; map = map->next) {
+        map->enable = snapshot_read_u32(s);
+        map->base   = snapshot_read_u32(s);
+        map->size   = snapshot_read_u32(s);
+        map->mask   = snapshot_read_u32(s);
+        map->flags  = snapshot_read_u32(s);
+        map->exec   = mem_load_exec(s, map->exec);
+    }
+
+    if (snapshot_error(s))
+        return;
+
+    mem_mapping_recalc(0x0000000000000000ULL, 0x0000000100000000ULL);
+
+    /* Any code compiled from the old RAM contents is now stale. */
+    mem_reset_page_blocks();
+    mem_invalidate_range(0x00000000, (uint32_t) ((((uint64_t) mem_size) << 10) - 1));
+
+    flushmmucache();
+}
@@ -42,6 +42,11 @@
 /* As below, 1 = exec, 4 = read. */
 int    read_type = 4;
 
+/* Code fetch page of the 286/386 interpreter, see getpccache_2386(). */
+uint32_t pccache_2386 = 0xffffffff;
+int      pccache_user_2386;
+uint8_t *pccache2_2386;
+
 /* Set trap for data address breakpoints - 1 = exec, 2 = write, 4 = read. */
 void
 mem_debug_check_addr(uint32_t addr, int flags)
@@ -273,6 +278,37 @@ mmutranslate_noabrt_2386(uint32_t addr, int rw)
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
 
+/*
+ * Called after a code fetch from a page other than the cached one has gone
+ * through the mappings, so any fault has already been raised. If the page is
+ * directly executable memory (RAM or ROM), further fetches from it can read
+ * the host copy until the translation changes, which every MMU cache flush
+ * takes care of. Other pages are cached as well, with no host pointer, so the
+ * translation is not repeated on every fetch just to find that out again.
+ */
+void
+getpccache_2386(uint32_t a)
+{
+    mem_mapping_t *map;
+    uint64_t       a64 = (uint64_t) a;
+
+    pccache_2386      = a >> 12;
+    pccache_user_2386 = (CPL == 3);
+    pccache2_2386     = NULL;
+
+    if (cr0 >> 31) {
+        a64 = mmutranslate_noabrt_2386(a, 0);
+
+        if (a64 > 0xffffffffULL)
+            return;
+    }
+    a64 &= rammask;
+
+    map = read_mapping[a64 >> MEM_GRANULARITY_BITS];
+    if (map && map->exec)
+        pccache2_2386 = &map->exec[(a64 & ~0xfff) - map->base];
+}
+
 uint8_t
 readmembl_2386(uint32_t addr)
 {
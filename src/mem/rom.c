@@ -22,12 +22,19 @@
  *          Copyright 2016-2019 Miran Grca.
  *          Copyright 2018-2019 Fred N. van Kempen.
  */
+#include <ctype.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <wchar.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
@@ -35,6 +42,8 @@
 #include <86box/rom.h>
 #include <86box/path.h>
 #include <86box/plat.h>
+#include <86box/plat_dir.h>
+#include <86box/thread.h>
 #include <86box/machine.h>
 #include <86box/m_xt_xi8088.h>
 
@@ -56,6 +65,363 @@ rom_log(const char *fmt, ...)
 #    define rom_log(fmt, ...)
 #endif
 
+#ifdef _WIN32
+#    define stat _stat64
+typedef struct __stat64 stat_t;
+#else
+typedef struct stat stat_t;
+#endif
+
+/* How often (in ms) the ROM index checks its directories for changes. */
+#define ROM_INDEX_CHECK_MS 1000
+/* How deep the ROM index descends into the ROM directories. */
+#define ROM_INDEX_MAX_DEPTH 8
+
+/* A file found under one of the ROM paths, keyed by its name relative to
+   that path (i.e. the part after "roms/"). */
+typedef struct rom_index_file_t {
+    uint32_t    hash;
+    char       *name;
+    rom_path_t *rom_path;
+} rom_index_file_t;
+
+/* A scanned directory, with what it looked like at the time. */
+typedef struct rom_index_dir_t {
+    char    *path;
+    int64_t  mtime;
+    int64_t  size;
+} rom_index_dir_t;
+
+static struct {
+    int               valid;
+    uint32_t          checked;
+    uint32_t          generation;
+    mutex_t          *mutex;
+    rom_index_file_t *files;
+    uint32_t          files_size;
+    uint32_t          files_used;
+    rom_index_dir_t  *dirs;
+    int               dirs_size;
+    int               dirs_used;
+} rom_index = { 0 };
+
+static int bios_mapped_sz = 0;
+
+/* Maps sz bytes of a ROM image starting at off straight from the file, if
+   rom_mmap is enabled and the image covers the whole range. The mapping is
+   private so that the few devices which patch their ROM after loading get
+   their own copy of the affected pages, while all other pages are shared
+   with other instances through the host page cache. */
+uint8_t *
+rom_map(const char *fn, int sz, int off)
+{
+#ifndef _WIN32
+    struct stat st;
+    FILE       *fp;
+    void       *ptr = MAP_FAILED;
+
+    if (!rom_mmap || (sz <= 0) || (off & (sysconf(_SC_PAGESIZE) - 1)))
+        return NULL;
+
+    fp = rom_fopen(fn, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    if ((fstat(fileno(fp), &st) == 0) && (st.st_size >= ((off_t) off + sz)))
+        ptr = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fp), off);
+
+    (void) fclose(fp);
+
+    if (ptr == MAP_FAILED)
+        return NULL;
+
+    rom_log("ROM: mapped %i bytes of '%s'\n", sz, fn);
+
+    return (uint8_t *) ptr;
+#else
+    return NULL;
+#endif
+}
+
+void
+rom_unmap(void *ptr, int sz)
+{
+#ifndef _WIN32
+    if (ptr != NULL)
+        munmap(ptr, sz);
+#endif
+}
+
+/*
+ * Looking ROMs up on demand means a fopen() on every ROM path for every
+ * file, and the machine and device availability checks do that for every
+ * machine and device there is, which is slow enough to notice on network
+ * storage. Instead, the ROM paths are scanned once into a hash set of the
+ * files they hold, which rom_fopen(), rom_getfile() and rom_present()
+ * consult for relative ("roms/...") names. The directories are stat'ed at
+ * most every ROM_INDEX_CHECK_MS, and the index is rebuilt if any of them
+ * has changed, so ROMs added while the emulator runs are still found.
+ */
+static void
+rom_index_key(char *dest, const char *fn, int size)
+{
+    int i;
+
+    for (i = 0; (i < (size - 1)) && (fn[i] != '\0'); i++) {
+#if defined(_WIN32) || defined(__APPLE__)
+        /* These file systems are usually case-insensitive. */
+        dest[i] = (fn[i] == '\\') ? '/' : tolower((unsigned char) fn[i]);
+#else
+        dest[i] = fn[i];
+#endif
+    }
+    dest[i] = '\0';
+}
+
+static uint32_t
+rom_index_hash(const char *key)
+{
+    uint32_t hash = 0x811c9dc5;
+
+    while (*key != '\0')
+        hash = (hash ^ (uint8_t) *(key++)) * 0x01000193;
+
+    return hash;
+}
+
+static rom_index_file_t *
+rom_index_find(const char *key, uint32_t hash)
+{
+    rom_index_file_t *file;
+    uint32_t          i;
+
+    if (rom_index.files_size == 0)
+        return NULL;
+
+    for (i = hash & (rom_index.files_size - 1);; i = (i + 1) & (rom_index.files_size - 1)) {
+        file = &rom_index.files[i];
+        if (file->name == NULL)
+            return file;
+        if ((file->hash == hash) && !strcmp(file->name, key))
+            return file;
+    }
+}
+
+static void
+rom_index_add_file(const char *name, rom_path_t *rom_path)
+{
+    char              key[1024];
+    rom_index_file_t *old_files = rom_index.files;
+    rom_index_file_t *file;
+    uint32_t          old_size  = rom_index.files_size;
+    uint32_t          hash;
+
+    /* Keep the table at most half full. */
+    if ((rom_index.files_used + 1) * 2 > rom_index.files_size) {
+        rom_index.files_size = old_size ? (old_size << 1) : 1024;
+        rom_index.files      = calloc(rom_index.files_size, sizeof(rom_index_file_t));
+        for (uint32_t i = 0; i < old_size; i++) {
+            if (old_files[i].name != NULL)
+                *rom_index_find(old_files[i].name, old_files[i].hash) = old_files[i];
+        }
+        free(old_files);
+    }
+
+    rom_index_key(key, name, sizeof(key));
+    hash = rom_index_hash(key);
+    file = rom_index_find(key, hash);
+
+    /* The first ROM path holding a file wins, as with the linear search. */
+    if (file->name == NULL) {
+        file->hash     = hash;
+        file->name     = strdup(key);
+        file->rom_path = rom_path;
+        rom_index.files_used++;
+    }
+}
+
+static void
+rom_index_add_dir(const char *path, const stat_t *st)
+{
+    rom_index_dir_t *dir;
+
+    if (rom_index.dirs_used == rom_index.dirs_size) {
+        rom_index.dirs_size = rom_index.dirs_size ? (rom_index.dirs_size << 1) : 256;
+        rom_index.dirs      = realloc(rom_index.dirs, rom_index.dirs_size * sizeof(rom_index_dir_t));
+    }
+
+    dir        = &rom_index.dirs[rom_index.dirs_used++];
+    dir->path  = strdup(path);
+    dir->mtime = st ? (int64_t) st->st_mtime : -1;
+    dir->size  = st ? (int64_t) st->st_size : -1;
+}
+
+static void
+rom_index_scan(rom_path_t *rom_path, char *path, int depth)
+{
+    struct dirent *entry;
+    stat_t         st;
+    DIR           *dirp;
+    size_t         len = strlen(path);
+    int            is_dir;
+
+    if (stat(path, &st) != 0) {
+        /* Remember missing directories too, so that creating them is noticed. */
+        rom_index_add_dir(path, NULL);
+        return;
+    }
+    rom_index_add_dir(path, &st);
+
+    if ((dirp = opendir(path)) == NULL)
+        return;
+
+    while ((entry = readdir(dirp)) != NULL) {
+        if (entry->d_name[0] == '.')
+            continue;
+        if ((len + strlen(entry->d_name) + 2) >= 1024)
+            continue;
+
+        sprintf(&path[len], "%s", entry->d_name);
+#ifdef DT_DIR
+        if ((entry->d_type != DT_UNKNOWN) && (entry->d_type != DT_LNK))
+            is_dir = (entry->d_type == DT_DIR);
+        else
+#endif
+        if (stat(path, &st) == 0)
+            is_dir = S_ISDIR(st.st_mode);
+        else
+            continue;
+
+        if (is_dir) {
+            if (depth < ROM_INDEX_MAX_DEPTH) {
+                path_slash(path);
+                rom_index_scan(rom_path, path, depth + 1);
+            }
+        } else
+            rom_index_add_file(&path[strlen(rom_path->path)], rom_path);
+    }
+    path[len] = '\0';
+
+    (void) closedir(dirp);
+}
+
+static void
+rom_index_free(void)
+{
+    for (uint32_t i = 0; i < rom_index.files_size; i++)
+        free(rom_index.files[i].name);
+    free(rom_index.files);
+    for (int i = 0; i < rom_index.dirs_used; i++)
+        free(rom_index.dirs[i].path);
+    free(rom_index.dirs);
+
+    rom_index.files      = NULL;
+    rom_index.files_size = rom_index.files_used = 0;
+    rom_index.dirs       = NULL;
+    rom_index.dirs_size  = rom_index.dirs_used = 0;
+    rom_index.valid      = 0;
+}
+
+static int
+rom_index_changed(void)
+{
+    const rom_index_dir_t *dir;
+    stat_t                 st;
+
+    for (int i = 0; i < rom_index.dirs_used; i++) {
+        dir = &rom_index.dirs[i];
+        if (stat(dir->path, &st) != 0) {
+            if (dir->mtime != -1)
+                return 1;
+        } else if ((dir->mtime != (int64_t) st.st_mtime) || (dir->size != (int64_t) st.st_size))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Makes sure the index is up to date; called with the index mutex held. */
+static void
+rom_index_update(void)
+{
+    char     path[1024];
+    uint32_t now = plat_get_ticks();
+
+    if (rom_index.valid) {
+        if ((now - rom_index.checked) < ROM_INDEX_CHECK_MS)
+            return;
+        rom_index.checked = now;
+        if (!rom_index_changed())
+            return;
+        rom_log("ROM: ROM directories changed, rebuilding the index\n");
+    }
+
+    rom_index_free();
+    for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
+        if (rom_path->path[0] == '\0')
+            continue;
+        snprintf(path, sizeof(path), "%s", rom_path->path);
+        rom_index_scan(rom_path, path, 0);
+    }
+    rom_index.valid   = 1;
+    rom_index.checked = plat_get_ticks();
+    rom_index.generation++;
+
+    rom_log("ROM: indexed %u files in %i directories\n", rom_index.files_used, rom_index.dirs_used);
+}
+
+/* Looks up a "roms/..." name, and builds its full path into dest if found. */
+static int
+rom_index_lookup(const char *fn, char *dest)
+{
+    const rom_index_file_t *file;
+    char                    key[1024];
+    int                     ret = 0;
+
+    rom_index_key(key, fn + 5, sizeof(key));
+
+    thread_wait_mutex(rom_index.mutex);
+    rom_index_update();
+    file = rom_index_find(key, rom_index_hash(key));
+    if ((file != NULL) && (file->name != NULL)) {
+        path_append_filename(dest, file->rom_path->path, fn + 5);
+        ret = 1;
+    }
+    thread_release_mutex(rom_index.mutex);
+
+    return ret;
+}
+
+/* Returns a number that changes whenever the set of ROM files does, so that
+   the UI knows when to forget what it has cached about ROM availability. */
+uint32_t
+rom_index_generation(void)
+{
+    uint32_t ret;
+
+    if (rom_index.mutex == NULL)
+        return 0;
+
+    thread_wait_mutex(rom_index.mutex);
+    rom_index_update();
+    ret = rom_index.generation;
+    thread_release_mutex(rom_index.mutex);
+
+    return ret;
+}
+
+/* Forgets the index, after a ROM path was added or a lookup went stale. */
+static void
+rom_index_invalidate(void)
+{
+    if (rom_index.mutex == NULL)
+        return;
+
+    thread_wait_mutex(rom_index.mutex);
+    rom_index.valid = 0;
+    thread_release_mutex(rom_index.mutex);
+}
+
 void
 rom_add_path(const char *path)
 {
@@ -84,6 +450,10 @@ rom_add_path(const char *path)
 
     // Ensure the path ends with a separator.
     path_slash(rom_path->path);
+
+    if (rom_index.mutex == NULL)
+        rom_index.mutex = thread_create_mutex();
+    rom_index_invalidate();
 }
 
 FILE *
@@ -94,6 +464,17 @@ rom_fopen(const char *fn, char *mode)
 
     if (strstr(fn, "roms/") == fn) {
         /* Relative path */
+        if ((rom_index.mutex != NULL) && (mode[0] == 'r')) {
+            if (!rom_index_lookup(fn, temp))
+                return NULL;
+
+            if ((fp = plat_fopen(temp, mode)) != NULL)
+                return fp;
+
+            /* The file went away since the last scan, do it the slow way. */
+            rom_index_invalidate();
+        }
+
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -116,6 +497,14 @@ rom_getfile(char *fn, char *s, int size)
 
     if (strstr(fn, "roms/") == fn) {
         /* Relative path */
+        if (rom_index.mutex != NULL) {
+            if (!rom_index_lookup(fn, temp))
+                return 0;
+
+            strncpy(s, temp, size);
+            return 1;
+        }
+
         for (rom_path_t *rom_path = &rom_paths; rom_path != NULL; rom_path = rom_path->next) {
             path_append_filename(temp, rom_path->path, fn + 5);
 
@@ -140,8 +529,13 @@ rom_getfile(char *fn, char *s, int size)
 int
 rom_present(const char *fn)
 {
+    char  temp[1024];
     FILE *fp;
 
+    /* Relative paths are answered from the index, without opening anything. */
+    if ((rom_index.mutex != NULL) && (strstr(fn, "roms/") == fn))
+        return rom_index_lookup(fn, temp);
+
     fp = rom_fopen(fn, "rb");
     if (fp != NULL) {
         (void) fclose(fp);
@@ -377,8 +771,14 @@ rom_reset(uint32_t addr, int sz)
     /* If not done yet, allocate a 128KB buffer for the BIOS ROM. */
     if (rom != NULL) {
         rom_log("ROM allocated, freeing...\n");
-        free(rom);
-        rom = NULL;
+#ifndef _WIN32
+        if (bios_mapped_sz)
+            munmap(rom, bios_mapped_sz);
+        else
+#endif
+            free(rom);
+        rom            = NULL;
+        bios_mapped_sz = 0;
     }
     rom_log("Allocating ROM...\n");
     rom = (uint8_t *) malloc(biosmask + 1);
@@ -484,8 +884,9 @@ bios_add(void)
 int
 bios_load(const char *fn1, const char *fn2, uint32_t addr, int sz, int off, int flags)
 {
-    uint8_t  ret = 0;
-    uint8_t *ptr = NULL;
+    uint8_t  ret    = 0;
+    uint8_t *ptr    = NULL;
+    uint8_t *mapped = NULL;
     int      old_sz = sz;
 
     /*
@@ -505,7 +906,17 @@ bios_load(const char *fn1, const char *fn2, uint32_t addr, int sz, int off, int
         rom_log("%sing %i bytes of %sBIOS starting with ptr[%08X] (ptr = %08X)\n", (bios_only) ? "Check" : "Load", sz, (flags & FLAG_AUX) ? "auxiliary " : "", addr - biosaddr, ptr);
 #endif
 
-    if (flags & FLAG_INT)
+    /* A plain image filling the whole BIOS space can be mapped instead. */
+    if ((ptr != NULL) && !(flags & (FLAG_AUX | FLAG_INT | FLAG_INV | FLAG_REP)) &&
+        (addr == biosaddr) && (sz == (biosmask + 1)))
+        mapped = rom_map(fn1, sz, off);
+
+    if (mapped != NULL) {
+        free(rom);
+        rom = ptr      = mapped;
+        bios_mapped_sz = sz;
+        ret            = 1;
+    } else if (flags & FLAG_INT)
         ret = rom_load_interleaved(fn1, fn2, addr - biosaddr, sz, off, ptr);
     else {
         if (flags & FLAG_INV)
@@ -574,16 +985,24 @@ rom_init(rom_t *rom, const char *fn, uint32_t addr, int sz, int mask, int off, u
 {
     rom_log("rom_init(%08X, %s, %08X, %08X, %08X, %08X, %08X)\n", rom, fn, addr, sz, mask, off, flags);
 
-    /* Allocate a buffer for the image. */
-    rom->rom = malloc(sz);
-    memset(rom->rom, 0xff, sz);
-
-    /* Load the image file into the buffer. */
-    if (!rom_load_linear(fn, addr, sz, off, rom->rom)) {
-        /* Nope.. clean up. */
-        free(rom->rom);
+    /* Map the image if it is loaded at the start of the buffer, see rom_load_linear(). */
+    if ((addr >= 0x40000) || !(addr & 0x03ffff))
+        rom->rom = rom_map(fn, sz, off);
+    else
         rom->rom = NULL;
-        return (-1);
+
+    if (rom->rom == NULL) {
+        /* Allocate a buffer for the image. */
+        rom->rom = malloc(sz);
+        memset(rom->rom, 0xff, sz);
+
+        /* Load the image file into the buffer. */
+        if (!rom_load_linear(fn, addr, sz, off, rom->rom)) {
+            /* Nope.. clean up. */
+            free(rom->rom);
+            rom->rom = NULL;
+            return (-1);
+        }
     }
 
     rom->sz   = sz;
@@ -84,8 +84,19 @@ static pthread_cond_t buffer_full_cond;
 #define STRING_POOL_SIZE 100
 static char *str_pool[100];
 
+// Names of the threads created so far, replayed as metadata events
+// whenever tracing is started so that late traces still get named threads.
+#define THREAD_NAME_POOL_SIZE 128
+typedef struct thread_name {
+    int tid;
+    const char *name;
+} thread_name_t;
+static thread_name_t thread_names[THREAD_NAME_POOL_SIZE];
+static atomic_int thread_name_count;
+
 // forward declaration
 void mtr_flush_with_state(int);
+static void raw_event_arg_tid(const char *category, const char *name, char ph, void *id, mtr_arg_type arg_type, const char *arg_name, void *arg_value, int tid);
 
 // Tiny portability layer.
 // Exposes:
@@ -211,8 +222,8 @@ static void termination_handler(int signum) {
     if (is_tracing) {
         printf("Ctrl-C detected! Flushing trace and shutting down.\n\n");
         mtr_flush();
-        fwrite("\n]}\n", 1, 4, f);
-        fclose(f);
+        fwrite("\n]}\n", 1, 4, fp);
+        fclose(fp);
     }
     exit(1);
 }
@@ -244,11 +255,16 @@ void mtr_init_from_stream(void *stream) {
     pthread_mutex_init(&event_mutex, 0);
 }
 
-void mtr_init(const char *json_file) {
+int mtr_init(const char *json_file) {
 #ifndef MTR_ENABLED
-    return;
+    return 0;
 #endif
-    mtr_init_from_stream(fopen(json_file, "wb"));
+    FILE *stream = fopen(json_file, "wb");
+    if (!stream) {
+        return 0;
+    }
+    mtr_init_from_stream(stream);
+    return 1;
 }
 
 void mtr_shutdown(void) {
@@ -300,6 +316,16 @@ void mtr_start(void) {
 #endif
     atomic_store(&is_tracing, TRUE);
     init_flushing_thread();
+
+    int count = atomic_load(&thread_name_count);
+    if (count > THREAD_NAME_POOL_SIZE) {
+        count = THREAD_NAME_POOL_SIZE;
+    }
+    for (int i = 0; i < count; i++) {
+        if (thread_names[i].tid) {
+            raw_event_arg_tid("", "thread_name", 'M', 0, MTR_ARG_TYPE_STRING_CONST, "name", (void *)thread_names[i].name, thread_names[i].tid);
+        }
+    }
 }
 
 void mtr_stop(void) {
@@ -419,7 +445,7 @@ void mtr_flush_with_state(int is_last) {
         len = snprintf(linebuf, ARRAY_SIZE(linebuf), "%s{\"cat\":\"%s\",\"pid\":%i,\"tid\":%i,\"ts\":%" PRId64 ",\"ph\":\"%c\",\"name\":\"%s\",\"args\":{%s}%s}",
                 first_line ? "" : ",\n",
                 cat, raw->pid, raw->tid, raw->ts - time_offset, raw->ph, raw->name, arg_buf, id_buf);
-        fwrite(linebuf, 1, len, f);
+        fwrite(linebuf, 1, len, fp);
         first_line = 0;
 
         if (raw->arg_type == MTR_ARG_TYPE_STRING_COPY) {
@@ -506,10 +532,7 @@ void internal_mtr_raw_event(const char *category, const char *name, char ph, voi
     pthread_mutex_unlock(&event_mutex);
 }
 
-void internal_mtr_raw_event_arg(const char *category, const char *name, char ph, void *id, mtr_arg_type arg_type, const char *arg_name, void *arg_value) {
-#ifndef MTR_ENABLED
-    return;
-#endif
+static void raw_event_arg_tid(const char *category, const char *name, char ph, void *id, mtr_arg_type arg_type, const char *arg_name, void *arg_value, int tid) {
     if (!atomic_load(&is_tracing)) {
         return;
     }
@@ -554,7 +577,7 @@ void internal_mtr_raw_event_arg(const char *category, const char *name, char ph,
     ev->id = id;
     ev->ts = (int64_t)(ts * 1000000);
     ev->ph = ph;
-    ev->tid = cur_thread_id;
+    ev->tid = tid ? tid : cur_thread_id;
     ev->pid = cur_process_id;
     ev->arg_type = arg_type;
     ev->arg_name = arg_name;
@@ -569,3 +592,28 @@ void internal_mtr_raw_event_arg(const char *category, const char *name, char ph,
     --events_in_progress;
     pthread_mutex_unlock(&event_mutex);
 }
+
+void internal_mtr_raw_event_arg(const char *category, const char *name, char ph, void *id, mtr_arg_type arg_type, const char *arg_name, void *arg_value) {
+#ifndef MTR_ENABLED
+    return;
+#endif
+    raw_event_arg_tid(category, name, ph, id, arg_type, arg_name, arg_value, 0);
+}
+
+void mtr_register_thread_name(const char *name) {
+#ifndef MTR_ENABLED
+    return;
+#endif
+    int i;
+
+    if (!cur_thread_id) {
+        cur_thread_id = get_cur_thread_id();
+    }
+    i = atomic_fetch_add(&thread_name_count, 1);
+    if (i < THREAD_NAME_POOL_SIZE) {
+        thread_names[i].name = name;
+        thread_names[i].tid = cur_thread_id;
+    }
+    // Name the thread right away if a trace is already running.
+    raw_event_arg_tid("", "thread_name", 'M', 0, MTR_ARG_TYPE_STRING_CONST, "name", (void *)name, 0);
+}
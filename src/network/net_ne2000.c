@@ -487,6 +487,59 @@ nic_writel(uint16_t addr, uint32_t val, void *priv)
     nic_write((nic_t *) priv, addr, val, 4);
 }
 
+/* Block transfer handlers for the data port, used by REP INS/OUTS. The block
+   ends early once the remote DMA has completed. */
+static int
+nic_block_ok(const nic_t *dev, int size)
+{
+    if (size == 4)
+        return dev->is_pci;
+
+    return (size == 1) || dev->is_pci || !dev->is_8bit;
+}
+
+static int
+nic_read_block(UNUSED(uint16_t addr), void *buf, int size, int count, void *priv)
+{
+    nic_t   *dev = (nic_t *) priv;
+    uint8_t *p   = (uint8_t *) buf;
+    uint32_t val;
+    int      i   = 0;
+
+    if (!nic_block_ok(dev, size))
+        return 0;
+
+    while (i < count) {
+        val = asic_read(dev, 0x00, size);
+        memcpy(p + (i++ * size), &val, size);
+        if (dev->dp8390->remote_bytes == 0)
+            break;
+    }
+
+    return i;
+}
+
+static int
+nic_write_block(UNUSED(uint16_t addr), const void *buf, int size, int count, void *priv)
+{
+    nic_t         *dev = (nic_t *) priv;
+    const uint8_t *p   = (const uint8_t *) buf;
+    uint32_t       val = 0;
+    int            i   = 0;
+
+    if (!nic_block_ok(dev, size))
+        return 0;
+
+    while (i < count) {
+        memcpy(&val, p + (i++ * size), size);
+        asic_write(dev, 0x00, val, size);
+        if (dev->dp8390->remote_bytes == 0)
+            break;
+    }
+
+    return i;
+}
+
 static void nic_ioset(nic_t *dev, uint16_t addr);
 static void nic_ioremove(nic_t *dev, uint16_t addr);
 
@@ -579,6 +632,8 @@ nic_ioset(nic_t *dev, uint16_t addr)
                           nic_writeb, nic_writew, NULL, dev);
         }
     }
+
+    io_set_block_handler(addr + 0x10, nic_read_block, nic_write_block, dev);
 }
 
 static void
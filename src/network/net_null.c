@@ -52,7 +52,7 @@ enum {
  * excluding NET_EVENT_RX. */
 #define NET_EVENT_TX_MAX NET_EVENT_RX
 
-#define NULL_PKT_BATCH NET_QUEUE_LEN
+#define NULL_PKT_BATCH NET_PKT_BATCH
 
 typedef struct net_null_t {
     uint8_t    mac_addr[6];
@@ -70,7 +70,7 @@
 #include <86box/network.h>
 #include <86box/net_event.h>
 
-#define PCAP_PKT_BATCH NET_QUEUE_LEN
+#define PCAP_PKT_BATCH NET_PKT_BATCH
 
 enum {
     NET_EVENT_STOP = 0,
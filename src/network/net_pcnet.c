@@ -244,6 +244,8 @@ typedef struct {
     uint32_t GCUpperPhys;
     /** We are waiting/about to start waiting for more receive buffers. */
     int fMaybeOutOfSpace;
+    /** Set while receiving a batch, the IRQ is updated once at the end. */
+    int fRxBatch;
     /** True if we signal the guest that RX packets are missing. */
     int fSignalRxMiss;
     /** Link speed to be reported through CSR68. */
@@ -1433,11 +1435,34 @@ pcnetReceiveNoSync(void *priv, uint8_t *buf, int size)
         }
     }
 
-    pcnetUpdateIrq(dev);
+    if (!dev->fRxBatch)
+        pcnetUpdateIrq(dev);
 
     return 1;
 }
 
+/**
+ * Write a batch of packets into guest receive buffers.
+ */
+static int
+pcnetReceiveBatch(void *priv, netpkt_t *pkts, int count)
+{
+    nic_t *dev = (nic_t *) priv;
+    int    i;
+
+    dev->fRxBatch = 1;
+    for (i = 0; i < count; i++) {
+        if (!pcnetReceiveNoSync(dev, pkts[i].data, pkts[i].len))
+            break;
+    }
+    dev->fRxBatch = 0;
+
+    if (i > 0)
+        pcnetUpdateIrq(dev);
+
+    return i;
+}
+
 /**
  * Fails a TMD with a link down error.
  */
@@ -3038,6 +3063,7 @@ pcnet_init(const device_t *info)
     /* Attach ourselves to the network module. */
     dev->netcard              = network_attach(dev, dev->aPROM, pcnetReceiveNoSync, pcnetSetLinkState);
     dev->netcard->byte_period = (dev->board == DEV_AM79C973) ? NET_PERIOD_100M : NET_PERIOD_10M;
+    network_set_rxv(dev->netcard, pcnetReceiveBatch);
 
     timer_add(&dev->timer, pcnetPollTimer, dev, 0);
 
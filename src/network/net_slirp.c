@@ -45,12 +45,18 @@
 #ifdef _WIN32
 #    define WIN32_LEAN_AND_MEAN
 #    include <windows.h>
+#elif defined(__linux__)
+#    include <errno.h>
+#    include <sys/epoll.h>
+#    include <unistd.h>
 #else
 #    include <poll.h>
 #endif
 #include <86box/net_event.h>
 
-#define SLIRP_PKT_BATCH NET_QUEUE_LEN
+#define SLIRP_PKT_BATCH     NET_PKT_BATCH
+#define SLIRP_EPOLL_EVENTS  64
+#define SLIRP_TIMER_GRAIN   1000 /* us */
 
 enum {
     NET_EVENT_STOP = 0,
@@ -59,6 +65,15 @@ enum {
     NET_EVENT_MAX
 };
 
+#ifdef __linux__
+typedef struct slirp_fd_t {
+    uint32_t events;  /* interest currently registered with epoll */
+    uint32_t revents; /* events returned in the current round */
+    uint32_t round;   /* last round SLiRP asked for the descriptor */
+    uint8_t  registered;
+} slirp_fd_t;
+#endif
+
 typedef struct net_slirp_t {
     Slirp     *slirp;
     uint8_t    mac_addr[6];
@@ -68,8 +83,16 @@ typedef struct net_slirp_t {
     net_evt_t  stop_event;
     netpkt_t   pkt;
     netpkt_t   pkt_tx_v[SLIRP_PKT_BATCH];
+    netpkt_t   pkt_rx_v[SLIRP_PKT_BATCH];
+    int        pkt_rx_len;
 #ifdef _WIN32
     HANDLE     sock_event;
+#elif defined(__linux__)
+    int                epfd;
+    int                fd_size;
+    slirp_fd_t        *fd;
+    uint32_t           round;
+    struct epoll_event evs[SLIRP_EPOLL_EVENTS];
 #else
     uint32_t       pfd_len;
     uint32_t       pfd_size;
@@ -77,6 +100,10 @@ typedef struct net_slirp_t {
 #endif
 } net_slirp_t;
 
+/* Set in the polling thread, whose received packets are handed over in
+   batches; SLiRP may also send from the emulation thread through timers. */
+static _Thread_local int slirp_in_thread = 0;
+
 /* Pulled off from libslirp code. This is only needed for modem. */
 #pragma pack(push, 1)
 struct arphdr_local {
@@ -145,12 +172,69 @@ net_slirp_timer_free(void *timer, UNUSED(void *opaque))
     free(timer);
 }
 
+/* The expiry time is absolute, in milliseconds of the SLiRP clock. Timers
+   are aligned to a common grain so that neighbouring ones fire together. */
+static void
+net_slirp_timer_mod(void *timer, int64_t expire_timer, void *opaque)
+{
+    int64_t now    = net_slirp_clock_get_ns(opaque) / 1000;
+    int64_t expire = expire_timer * 1000;
+
+    expire = ((expire + SLIRP_TIMER_GRAIN - 1) / SLIRP_TIMER_GRAIN) * SLIRP_TIMER_GRAIN;
+    timer_on_auto(timer, (expire > now) ? (double) (expire - now) : SLIRP_TIMER_GRAIN);
+}
+
+#ifdef __linux__
+static slirp_fd_t *
+net_slirp_fd(net_slirp_t *slirp, int fd)
+{
+    int size = slirp->fd_size ? slirp->fd_size : 64;
+
+    if (fd >= slirp->fd_size) {
+        while (size <= fd)
+            size <<= 1;
+        slirp->fd = realloc(slirp->fd, size * sizeof(slirp_fd_t));
+        memset(&slirp->fd[slirp->fd_size], 0, (size - slirp->fd_size) * sizeof(slirp_fd_t));
+        slirp->fd_size = size;
+    }
+
+    return &slirp->fd[fd];
+}
+
+/* Update the interest registered with epoll, only when it changed. epoll
+   always reports errors and hang-ups, so a descriptor nobody is interested
+   in is taken out of the set; left in with an empty mask, a dead socket
+   would wake the thread on every round. */
 static void
-net_slirp_timer_mod(void *timer, int64_t expire_timer, UNUSED(void *opaque))
+net_slirp_epoll_set(net_slirp_t *slirp, int fd, uint32_t events)
 {
-    timer_on_auto(timer, expire_timer * 1000);
+    slirp_fd_t        *sfd = net_slirp_fd(slirp, fd);
+    struct epoll_event ev  = { .events = events, .data.fd = fd };
+
+    if (!events) {
+        if (sfd->registered)
+            epoll_ctl(slirp->epfd, EPOLL_CTL_DEL, fd, NULL);
+        sfd->registered = 0;
+        sfd->events     = 0;
+        return;
+    }
+
+    if (sfd->registered && (sfd->events == events))
+        return;
+
+    if (epoll_ctl(slirp->epfd, sfd->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) < 0) {
+        /* The descriptor may have been closed and reused behind our back. */
+        if (errno == ENOENT)
+            epoll_ctl(slirp->epfd, EPOLL_CTL_ADD, fd, &ev);
+        else if (errno == EEXIST)
+            epoll_ctl(slirp->epfd, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    sfd->registered = 1;
+    sfd->events     = events;
 }
 
+/* Descriptors are added to the epoll set once SLiRP asks to poll them. */
 static void
 net_slirp_register_poll_fd(int fd, void *opaque)
 {
@@ -160,17 +244,46 @@ net_slirp_register_poll_fd(int fd, void *opaque)
 
 static void
 net_slirp_unregister_poll_fd(int fd, void *opaque)
+{
+    net_slirp_t *slirp = (net_slirp_t *) opaque;
+    slirp_fd_t  *sfd   = net_slirp_fd(slirp, fd);
+
+    if (sfd->registered)
+        epoll_ctl(slirp->epfd, EPOLL_CTL_DEL, fd, NULL);
+    memset(sfd, 0, sizeof(slirp_fd_t));
+}
+#else
+static void
+net_slirp_register_poll_fd(int fd, void *opaque)
 {
     (void) fd;
     (void) opaque;
 }
 
+static void
+net_slirp_unregister_poll_fd(int fd, void *opaque)
+{
+    (void) fd;
+    (void) opaque;
+}
+#endif
+
 static void
 net_slirp_notify(void *opaque)
 {
     (void) opaque;
 }
 
+/* Hand the packets received in this round to the card queue at once. */
+static void
+net_slirp_flush(net_slirp_t *slirp)
+{
+    if (slirp->pkt_rx_len) {
+        network_rx_putv(slirp->card, slirp->pkt_rx_v, slirp->pkt_rx_len);
+        slirp->pkt_rx_len = 0;
+    }
+}
+
 #if SLIRP_CHECK_VERSION(4, 8, 0)
 slirp_ssize_t
 #else
@@ -182,6 +295,17 @@ net_slirp_send_packet(const void *qp, size_t pkt_len, void *opaque)
 
     slirp_log("SLiRP: received %d-byte packet\n", pkt_len);
 
+    if (pkt_len > NET_MAX_FRAME)
+        return pkt_len;
+
+    if (slirp_in_thread) {
+        if (slirp->pkt_rx_len == SLIRP_PKT_BATCH)
+            net_slirp_flush(slirp);
+        memcpy(slirp->pkt_rx_v[slirp->pkt_rx_len].data, (uint8_t *) qp, pkt_len);
+        slirp->pkt_rx_v[slirp->pkt_rx_len++].len = pkt_len;
+        return pkt_len;
+    }
+
     memcpy(slirp->pkt.data, (uint8_t *) qp, pkt_len);
     slirp->pkt.len = pkt_len;
     network_rx_put_pkt(slirp->card, &slirp->pkt);
@@ -207,6 +331,25 @@ net_slirp_add_poll(int fd, int events, void *opaque)
     WSAEventSelect(fd, slirp->sock_event, bitmask);
     return fd;
 }
+#elif defined(__linux__)
+static int
+net_slirp_add_poll(int fd, int events, void *opaque)
+{
+    net_slirp_t *slirp   = (net_slirp_t *) opaque;
+    uint32_t     pevents = 0;
+
+    if (events & SLIRP_POLL_IN)
+        pevents |= EPOLLIN;
+    if (events & SLIRP_POLL_OUT)
+        pevents |= EPOLLOUT;
+    if (events & SLIRP_POLL_PRI)
+        pevents |= EPOLLPRI;
+
+    net_slirp_epoll_set(slirp, fd, pevents);
+    slirp->fd[fd].round = slirp->round;
+
+    return fd;
+}
 #else
 static int
 net_slirp_add_poll(int fd, int events, void *opaque)
@@ -272,6 +415,26 @@ net_slirp_get_revents(int idx, void *opaque)
 
     return ret;
 }
+#elif defined(__linux__)
+static int
+net_slirp_get_revents(int idx, void *opaque)
+{
+    net_slirp_t *slirp  = (net_slirp_t *) opaque;
+    uint32_t     events = slirp->fd[idx].revents;
+    int          ret    = 0;
+
+    if (events & EPOLLIN)
+        ret |= SLIRP_POLL_IN;
+    if (events & EPOLLOUT)
+        ret |= SLIRP_POLL_OUT;
+    if (events & EPOLLPRI)
+        ret |= SLIRP_POLL_PRI;
+    if (events & EPOLLERR)
+        ret |= SLIRP_POLL_ERR;
+    if (events & EPOLLHUP)
+        ret |= SLIRP_POLL_HUP;
+    return ret;
+}
 #else
 static int
 net_slirp_get_revents(int idx, void *opaque)
@@ -338,6 +501,7 @@ net_slirp_thread(void *priv)
     events[NET_EVENT_TX]   = net_event_get_handle(&slirp->tx_event);
     events[NET_EVENT_RX]   = slirp->sock_event;
     bool run               = true;
+    slirp_in_thread        = 1;
     while (run) {
         uint32_t timeout = -1;
         slirp_pollfds_fill(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
@@ -363,8 +527,82 @@ net_slirp_thread(void *priv)
                 slirp_pollfds_poll(slirp->slirp, ret == WAIT_FAILED, net_slirp_get_revents, slirp);
                 break;
         }
+
+        net_slirp_flush(slirp);
+    }
+
+    slirp_log("SLiRP: polling stopped.\n");
+}
+#elif defined(__linux__)
+/*
+ * Descriptors stay registered with epoll for as long as SLiRP keeps asking
+ * for them, and their interest is only updated when it changes, so each
+ * round costs system calls in proportion to the sockets that changed state
+ * or became ready rather than to all open sockets.
+ */
+static void
+net_slirp_thread(void *priv)
+{
+    net_slirp_t *slirp = (net_slirp_t *) priv;
+    int          stop_fd = net_event_get_fd(&slirp->stop_event);
+    int          tx_fd   = net_event_get_fd(&slirp->tx_event);
+    int          stop    = 0;
+    int          tx;
+    int          ret;
+
+    /* Start polling. */
+    slirp_log("SLiRP: polling started.\n");
+    slirp_in_thread = 1;
+
+    net_slirp_epoll_set(slirp, stop_fd, EPOLLIN);
+    net_slirp_epoll_set(slirp, tx_fd, EPOLLIN);
+
+    while (!stop) {
+        uint32_t timeout = -1;
+
+        slirp->round++;
+        slirp->fd[stop_fd].round = slirp->round;
+        slirp->fd[tx_fd].round   = slirp->round;
+        slirp_pollfds_fill(slirp->slirp, &timeout, net_slirp_add_poll, slirp);
+
+        /* Stop watching whatever SLiRP did not ask for this time. */
+        for (int fd = 0; fd < slirp->fd_size; fd++) {
+            if (slirp->fd[fd].registered && (slirp->fd[fd].round != slirp->round))
+                net_slirp_epoll_set(slirp, fd, 0);
+        }
+
+        ret = epoll_wait(slirp->epfd, slirp->evs, SLIRP_EPOLL_EVENTS, (int) timeout);
+
+        tx = 0;
+        for (int i = 0; i < ret; i++) {
+            int fd = slirp->evs[i].data.fd;
+
+            if (fd == stop_fd)
+                stop = 1;
+            else if (fd == tx_fd)
+                tx = 1;
+            else
+                slirp->fd[fd].revents = slirp->evs[i].events;
+        }
+
+        slirp_pollfds_poll(slirp->slirp, (ret < 0) && (errno != EINTR), net_slirp_get_revents, slirp);
+
+        for (int i = 0; i < ret; i++)
+            slirp->fd[slirp->evs[i].data.fd].revents = 0;
+
+        if (tx) {
+            net_event_clear(&slirp->tx_event);
+
+            int packets = network_tx_popv(slirp->card, slirp->pkt_tx_v, SLIRP_PKT_BATCH);
+            for (int i = 0; i < packets; i++) {
+                net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
+            }
+        }
+
+        net_slirp_flush(slirp);
     }
 
+    net_event_clear(&slirp->stop_event);
     slirp_log("SLiRP: polling stopped.\n");
 }
 #else
@@ -376,6 +614,7 @@ net_slirp_thread(void *priv)
 
     /* Start polling. */
     slirp_log("SLiRP: polling started.\n");
+    slirp_in_thread = 1;
 
     while (1) {
         uint32_t timeout = -1;
@@ -403,6 +642,8 @@ net_slirp_thread(void *priv)
                 net_slirp_in(slirp, slirp->pkt_tx_v[i].data, slirp->pkt_tx_v[i].len);
             }
         }
+
+        net_slirp_flush(slirp);
     }
 
     slirp_log("SLiRP: polling stopped.\n");
@@ -420,7 +661,15 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
     memcpy(slirp->mac_addr, mac_addr, sizeof(slirp->mac_addr));
     slirp->card = (netcard_t *) card;
 
-#ifndef _WIN32
+#if defined(__linux__)
+    slirp->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (slirp->epfd < 0) {
+        slirp_log("SLiRP: epoll_create1() failed\n");
+        snprintf(netdrv_errbuf, NET_DRV_ERRBUF_SIZE, "SLiRP initialization failed");
+        free(slirp);
+        return NULL;
+    }
+#elif !defined(_WIN32)
     slirp->pfd_size = 16 * sizeof(struct pollfd);
     slirp->pfd      = malloc(slirp->pfd_size);
     memset(slirp->pfd, 0, slirp->pfd_size);
@@ -440,6 +689,10 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
     if (!slirp->slirp) {
         slirp_log("SLiRP: initialization failed\n");
         snprintf(netdrv_errbuf, NET_DRV_ERRBUF_SIZE, "SLiRP initialization failed");
+#ifdef __linux__
+        close(slirp->epfd);
+        free(slirp->fd);
+#endif
         free(slirp);
         return NULL;
     }
@@ -476,6 +729,7 @@ net_slirp_init(const netcard_t *card, const uint8_t *mac_addr, UNUSED(void *priv
 
     for (int i = 0; i < SLIRP_PKT_BATCH; i++) {
         slirp->pkt_tx_v[i].data = calloc(1, NET_MAX_FRAME);
+        slirp->pkt_rx_v[i].data = calloc(1, NET_MAX_FRAME);
     }
     slirp->pkt.data = calloc(1, NET_MAX_FRAME);
     net_event_init(&slirp->tx_event);
@@ -537,8 +791,15 @@ net_slirp_close(void *priv)
     slirp_cleanup(slirp->slirp);
     for (int i = 0; i < SLIRP_PKT_BATCH; i++) {
         free(slirp->pkt_tx_v[i].data);
+        free(slirp->pkt_rx_v[i].data);
     }
     free(slirp->pkt.data);
+#ifdef __linux__
+    close(slirp->epfd);
+    free(slirp->fd);
+#elif !defined(_WIN32)
+    free(slirp->pfd);
+#endif
     free(slirp);
     slirp_card_num--;
 }
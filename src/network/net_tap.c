@@ -0,0 +1,264 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Linux TAP network driver.
+ *
+ *          Attaches a card to a kernel TAP interface, which can then be
+ *          bridged or routed by the host like any other interface. The
+ *          interface is either created on the fly (which needs
+ *          CAP_NET_ADMIN) or a persistent one owned by the user, e.g.
+ *          created with "ip tuntap add mode tap user <name>".
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/net_event.h>
+
+#define TAP_PKT_BATCH NET_PKT_BATCH
+#define TAP_DEVICE    "/dev/net/tun"
+
+enum {
+    NET_EVENT_STOP = 0,
+    NET_EVENT_TX,
+    NET_EVENT_RX,
+    NET_EVENT_MAX
+};
+
+typedef struct net_tap_t {
+    int        fd;
+    netcard_t *card;
+    thread_t  *poll_tid;
+    net_evt_t  tx_event;
+    net_evt_t  stop_event;
+    netpkt_t   pkt;
+    netpkt_t   pktv[TAP_PKT_BATCH];
+    char       ifname[IFNAMSIZ];
+} net_tap_t;
+
+#ifdef ENABLE_TAP_LOG
+int tap_do_log = ENABLE_TAP_LOG;
+
+static void
+tap_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (tap_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define tap_log(fmt, ...)
+#endif
+
+/*
+ * Every read() or write() on a TAP descriptor moves exactly one frame, so
+ * batching happens around the syscalls: the TX side takes a whole batch
+ * out of the card queue at once, and the RX side drains every pending
+ * frame before going back to poll. Frames are read straight into a packet
+ * buffer that is then swapped into the card queue, without another copy.
+ */
+static void
+net_tap_rx(net_tap_t *tap)
+{
+    for (int i = 0; i < TAP_PKT_BATCH; i++) {
+        ssize_t len = read(tap->fd, tap->pkt.data, NET_MAX_FRAME);
+
+        if (len <= 0) {
+            if ((len < 0) && (errno != EAGAIN) && (errno != EINTR))
+                tap_log("TAP: read error (%s)\n", strerror(errno));
+            break;
+        }
+
+        tap->pkt.len = len;
+        if (!network_rx_put_pkt(tap->card, &tap->pkt))
+            tap_log("TAP: dropped %d bytes frame, queue full\n", (int) len);
+    }
+}
+
+static void
+net_tap_tx(net_tap_t *tap)
+{
+    int packets;
+
+    do {
+        packets = network_tx_popv(tap->card, tap->pktv, TAP_PKT_BATCH);
+        for (int i = 0; i < packets; i++) {
+            if (write(tap->fd, tap->pktv[i].data, tap->pktv[i].len) < 0)
+                tap_log("TAP: write error (%s)\n", strerror(errno));
+        }
+    } while (packets == TAP_PKT_BATCH);
+}
+
+static void
+net_tap_thread(void *priv)
+{
+    net_tap_t    *tap = (net_tap_t *) priv;
+    struct pollfd pfd[NET_EVENT_MAX];
+
+    tap_log("TAP: polling started.\n");
+
+    pfd[NET_EVENT_STOP].fd     = net_event_get_fd(&tap->stop_event);
+    pfd[NET_EVENT_STOP].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_TX].fd     = net_event_get_fd(&tap->tx_event);
+    pfd[NET_EVENT_TX].events = POLLIN | POLLPRI;
+
+    pfd[NET_EVENT_RX].fd     = tap->fd;
+    pfd[NET_EVENT_RX].events = POLLIN;
+
+    while (1) {
+        if (poll(pfd, NET_EVENT_MAX, -1) < 0)
+            continue;
+
+        if (pfd[NET_EVENT_STOP].revents & POLLIN) {
+            net_event_clear(&tap->stop_event);
+            break;
+        }
+
+        if (pfd[NET_EVENT_TX].revents & POLLIN) {
+            net_event_clear(&tap->tx_event);
+            net_tap_tx(tap);
+        }
+
+        if (pfd[NET_EVENT_RX].revents & POLLIN)
+            net_tap_rx(tap);
+
+        if (pfd[NET_EVENT_RX].revents & (POLLERR | POLLHUP)) {
+            tap_log("TAP: interface %s went away\n", tap->ifname);
+            break;
+        }
+    }
+
+    tap_log("TAP: polling stopped.\n");
+}
+
+/* Returns zero if the TUN/TAP device is present on this host. */
+int
+net_tap_prepare(void)
+{
+    return access(TAP_DEVICE, R_OK | W_OK);
+}
+
+static void
+net_tap_error(char *errbuf, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(errbuf, NET_DRV_ERRBUF_SIZE, fmt, ap);
+    va_end(ap);
+
+    tap_log("TAP: %s\n", errbuf);
+}
+
+/* priv is the interface name; an empty name lets the kernel pick one. */
+static void *
+net_tap_init(const netcard_t *card, UNUSED(const uint8_t *mac_addr), void *priv, char *netdrv_errbuf)
+{
+    const char  *ifname = (const char *) priv;
+    struct ifreq ifr;
+    net_tap_t   *tap;
+    int          fd;
+
+    fd = open(TAP_DEVICE, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        net_tap_error(netdrv_errbuf, "Unable to open %s (%s)", TAP_DEVICE, strerror(errno));
+        return NULL;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    if ((ifname != NULL) && (ifname[0] != '\0') && strcmp(ifname, "none"))
+        strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+
+    if (ioctl(fd, TUNSETIFF, &ifr) < 0) {
+        net_tap_error(netdrv_errbuf, "Unable to attach to TAP interface %s (%s)",
+                      ifr.ifr_name[0] ? ifr.ifr_name : "(new)", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    tap       = calloc(1, sizeof(net_tap_t));
+    tap->fd   = fd;
+    tap->card = (netcard_t *) card;
+    strncpy(tap->ifname, ifr.ifr_name, IFNAMSIZ - 1);
+    tap_log("TAP: attached to %s\n", tap->ifname);
+
+    for (int i = 0; i < TAP_PKT_BATCH; i++)
+        tap->pktv[i].data = calloc(1, NET_MAX_FRAME);
+    tap->pkt.data = calloc(1, NET_MAX_FRAME);
+
+    net_event_init(&tap->tx_event);
+    net_event_init(&tap->stop_event);
+    tap->poll_tid = thread_create_named(net_tap_thread, tap, "TAP network");
+
+    return tap;
+}
+
+static void
+net_tap_in_available(void *priv)
+{
+    net_tap_t *tap = (net_tap_t *) priv;
+
+    net_event_set(&tap->tx_event);
+}
+
+static void
+net_tap_close(void *priv)
+{
+    net_tap_t *tap = (net_tap_t *) priv;
+
+    if (!tap)
+        return;
+
+    tap_log("TAP: closing.\n");
+    net_event_set(&tap->stop_event);
+    thread_wait(tap->poll_tid);
+
+    for (int i = 0; i < TAP_PKT_BATCH; i++)
+        free(tap->pktv[i].data);
+    free(tap->pkt.data);
+
+    close(tap->fd);
+    net_event_close(&tap->tx_event);
+    net_event_close(&tap->stop_event);
+    free(tap);
+}
+
+const netdrv_t net_tap_drv = {
+    &net_tap_in_available,
+    &net_tap_init,
+    &net_tap_close,
+    NULL
+};
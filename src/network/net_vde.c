@@ -46,7 +46,7 @@
 #include <86box/network.h>
 #include <86box/net_event.h>
 
-#define VDE_PKT_BATCH NET_QUEUE_LEN
+#define VDE_PKT_BATCH NET_PKT_BATCH
 #define VDE_DESCRIPTION "86Box virtual card"
 
 enum {
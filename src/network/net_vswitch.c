@@ -0,0 +1,470 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Shared memory virtual switch network driver.
+ *
+ *          Connects the cards of 86Box instances running on the same
+ *          host through a POSIX shared memory segment named after the
+ *          switch, without involving the host network stack. Each pair
+ *          of ports has its own single producer, single consumer ring;
+ *          the sending instance does the switching itself, looking the
+ *          destination up in the table of addresses learned from the
+ *          frames every port sends, and flooding broadcasts and unknown
+ *          destinations. Receivers sleep on a process-shared futex in
+ *          their port, which senders only wake when it is waited on.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+
+#define VSW_MAGIC     0x57535638 /* "8VSW" */
+#define VSW_VERSION   1
+#define VSW_PORTS     8
+#define VSW_SLOTS     64 /* must be a power of 2 */
+#define VSW_SLOT_SIZE 1536
+#define VSW_PKT_BATCH NET_PKT_BATCH
+#define VSW_NAME      "86box"
+#define VSW_POLL_MS   250
+#define VSW_TX_TRIES  1000
+
+enum {
+    VSW_STATE_EMPTY = 0,
+    VSW_STATE_INIT,
+    VSW_STATE_READY
+};
+
+typedef struct vsw_ring_t {
+    atomic_uint head;
+    atomic_uint tail;
+    uint16_t    len[VSW_SLOTS];
+    uint8_t     data[VSW_SLOTS][VSW_SLOT_SIZE];
+} vsw_ring_t;
+
+typedef struct vsw_port_t {
+    atomic_int    owner;    /* pid of the instance using the port, 0 if free */
+    atomic_ullong mac;      /* last source address seen, plus 1 << 63 if valid */
+    atomic_uint   doorbell; /* futex word, bumped on every wakeup */
+    atomic_uint   waiting;
+} vsw_port_t;
+
+typedef struct vsw_shared_t {
+    atomic_uint magic;
+    atomic_uint state;
+    uint32_t    version;
+    uint32_t    ports;
+    vsw_port_t  port[VSW_PORTS];
+    vsw_ring_t  ring[VSW_PORTS][VSW_PORTS]; /* [from][to] */
+} vsw_shared_t;
+
+typedef struct net_vswitch_t {
+    vsw_shared_t *sw;
+    int           port;
+    pid_t         pid;
+    netcard_t    *card;
+    thread_t     *poll_tid;
+    atomic_int    stop;
+    netpkt_t      pktv[VSW_PKT_BATCH];
+    char          shm_name[NAME_MAX];
+} net_vswitch_t;
+
+#ifdef ENABLE_VSWITCH_LOG
+int vswitch_do_log = ENABLE_VSWITCH_LOG;
+
+static void
+vswitch_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (vswitch_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define vswitch_log(fmt, ...)
+#endif
+
+static void
+vsw_futex_wait(atomic_uint *addr, uint32_t val, int ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L };
+
+    syscall(SYS_futex, (uint32_t *) addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void
+vsw_futex_wake(atomic_uint *addr)
+{
+    syscall(SYS_futex, (uint32_t *) addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static void
+vsw_ring_bell(vsw_port_t *port)
+{
+    /* Sequentially consistent, pairs with the waiting check in the thread. */
+    atomic_fetch_add(&port->doorbell, 1);
+    if (atomic_load(&port->waiting))
+        vsw_futex_wake(&port->doorbell);
+}
+
+static uint64_t
+vsw_mac(const uint8_t *p)
+{
+    return ((uint64_t) p[0] << 40) | ((uint64_t) p[1] << 32) | ((uint64_t) p[2] << 24) | ((uint64_t) p[3] << 16) | ((uint64_t) p[4] << 8) | (uint64_t) p[5] | (1ULL << 63);
+}
+
+static int
+vsw_ring_put(vsw_ring_t *ring, const uint8_t *data, int len)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (((head + 1) & (VSW_SLOTS - 1)) == tail)
+        return 0;
+
+    memcpy(ring->data[head], data, len);
+    ring->len[head] = len;
+    atomic_store_explicit(&ring->head, (head + 1) & (VSW_SLOTS - 1), memory_order_release);
+
+    return 1;
+}
+
+/* Drain all rings into our port, returns the number of frames received and
+   sets *pending if some had to be left in a ring. */
+static int
+vsw_receive(net_vswitch_t *vsw, int *pending)
+{
+    vsw_shared_t *sw     = vsw->sw;
+    int           frames = 0;
+
+    *pending = 0;
+
+    for (int i = 0; i < VSW_PORTS; i++) {
+        vsw_ring_t *ring = &sw->ring[i][vsw->port];
+        uint32_t    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint32_t    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        if (i == vsw->port)
+            continue;
+
+        while (tail != head) {
+            /* Stop when the card queue is full, the rest stays in the ring. */
+            if (!network_rx_put(vsw->card, ring->data[tail], ring->len[tail])) {
+                *pending = 1;
+                break;
+            }
+            tail = (tail + 1) & (VSW_SLOTS - 1);
+            frames++;
+        }
+
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+
+    return frames;
+}
+
+/* Switch one frame from our guest to the other ports. */
+static void
+vsw_switch(net_vswitch_t *vsw, const uint8_t *data, int len, uint32_t *rung)
+{
+    vsw_shared_t *sw  = vsw->sw;
+    uint64_t      dst = vsw_mac(data);
+    int           to  = -1;
+    int           pending;
+
+    if ((len < 14) || (len > VSW_SLOT_SIZE))
+        return;
+
+    /* Learn our own address from the source field. */
+    if (atomic_load_explicit(&sw->port[vsw->port].mac, memory_order_relaxed) != vsw_mac(data + 6))
+        atomic_store_explicit(&sw->port[vsw->port].mac, vsw_mac(data + 6), memory_order_relaxed);
+
+    /* Unicast to a known address goes to that port only. */
+    if (!(data[0] & 0x01)) {
+        for (int i = 0; i < VSW_PORTS; i++) {
+            if ((i != vsw->port) && atomic_load_explicit(&sw->port[i].owner, memory_order_relaxed) && (atomic_load_explicit(&sw->port[i].mac, memory_order_relaxed) == dst)) {
+                to = i;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < VSW_PORTS; i++) {
+        if ((i == vsw->port) || ((to >= 0) && (i != to)) || !atomic_load_explicit(&sw->port[i].owner, memory_order_relaxed))
+            continue;
+
+        /* A full ring means the receiver is behind; wake it and give it a
+           moment before dropping the frame, as a real switch would buffer.
+           Keep receiving meanwhile, the receiver may be waiting on us. */
+        for (int tries = 0; !vsw_ring_put(&sw->ring[vsw->port][i], data, len); tries++) {
+            if (tries == VSW_TX_TRIES) {
+                vswitch_log("VSWITCH: port %i full, dropped %i bytes\n", i, len);
+                break;
+            }
+            vsw_ring_bell(&sw->port[i]);
+            vsw_receive(vsw, &pending);
+            sched_yield();
+        }
+        *rung |= (1 << i);
+    }
+}
+
+/* Release ports whose owner has gone away without closing them. */
+static void
+vsw_reap(net_vswitch_t *vsw)
+{
+    for (int i = 0; i < VSW_PORTS; i++) {
+        int owner = atomic_load(&vsw->sw->port[i].owner);
+
+        if ((i != vsw->port) && owner && (kill(owner, 0) < 0) && (errno == ESRCH)) {
+            vswitch_log("VSWITCH: releasing port %i of dead process %i\n", i, owner);
+            atomic_store(&vsw->sw->port[i].mac, 0);
+            atomic_compare_exchange_strong(&vsw->sw->port[i].owner, &owner, 0);
+        }
+    }
+}
+
+static void
+net_vswitch_thread(void *priv)
+{
+    net_vswitch_t *vsw  = (net_vswitch_t *) priv;
+    vsw_port_t    *port = &vsw->sw->port[vsw->port];
+    uint32_t       bell;
+    uint32_t       rung;
+    int            packets;
+    int            pending;
+    int            busy;
+
+    vswitch_log("VSWITCH: polling started.\n");
+
+    while (!atomic_load(&vsw->stop)) {
+        bell = atomic_load_explicit(&port->doorbell, memory_order_acquire);
+        busy = vsw_receive(vsw, &pending);
+
+        rung = 0;
+        do {
+            packets = network_tx_popv(vsw->card, vsw->pktv, VSW_PKT_BATCH);
+            for (int i = 0; i < packets; i++)
+                vsw_switch(vsw, vsw->pktv[i].data, vsw->pktv[i].len, &rung);
+            busy += packets;
+        } while (packets == VSW_PKT_BATCH);
+
+        /* One wakeup per destination and batch. */
+        for (int i = 0; rung; i++, rung >>= 1) {
+            if (rung & 1)
+                vsw_ring_bell(&vsw->sw->port[i]);
+        }
+
+        if (busy)
+            continue;
+
+        /* The card queue is full, give the emulation some time to drain it. */
+        if (pending) {
+            plat_delay_ms(1);
+            continue;
+        }
+
+        atomic_store(&port->waiting, 1);
+        if (atomic_load(&port->doorbell) == bell) {
+            vsw_futex_wait(&port->doorbell, bell, VSW_POLL_MS);
+            if (atomic_load(&port->doorbell) == bell)
+                vsw_reap(vsw);
+        }
+        atomic_store(&port->waiting, 0);
+    }
+
+    vswitch_log("VSWITCH: polling stopped.\n");
+}
+
+static void
+net_vswitch_error(char *errbuf, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(errbuf, NET_DRV_ERRBUF_SIZE, fmt, ap);
+    va_end(ap);
+
+    vswitch_log("VSWITCH: %s\n", errbuf);
+}
+
+static vsw_shared_t *
+vsw_map(const char *shm_name, char *errbuf)
+{
+    vsw_shared_t *sw;
+    uint32_t      state = VSW_STATE_EMPTY;
+    int           fd;
+
+    fd = shm_open(shm_name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        net_vswitch_error(errbuf, "Unable to open shared memory %s (%s)", shm_name, strerror(errno));
+        return NULL;
+    }
+
+    /* Growing an existing segment to the same size is harmless. */
+    if (ftruncate(fd, sizeof(vsw_shared_t)) < 0) {
+        net_vswitch_error(errbuf, "Unable to size shared memory %s (%s)", shm_name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    sw = mmap(NULL, sizeof(vsw_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (sw == MAP_FAILED) {
+        net_vswitch_error(errbuf, "Unable to map shared memory %s (%s)", shm_name, strerror(errno));
+        return NULL;
+    }
+
+    /* The first instance to get here initializes the segment. */
+    if (atomic_compare_exchange_strong(&sw->state, &state, VSW_STATE_INIT)) {
+        sw->version = VSW_VERSION;
+        sw->ports   = VSW_PORTS;
+        atomic_store(&sw->magic, VSW_MAGIC);
+        atomic_store(&sw->state, VSW_STATE_READY);
+    } else {
+        for (int i = 0; (atomic_load(&sw->state) != VSW_STATE_READY) && (i < 1000); i++)
+            plat_delay_ms(1);
+    }
+
+    if ((atomic_load(&sw->state) != VSW_STATE_READY) || (atomic_load(&sw->magic) != VSW_MAGIC) || (sw->version != VSW_VERSION) || (sw->ports != VSW_PORTS)) {
+        net_vswitch_error(errbuf, "Shared memory %s is not a compatible virtual switch", shm_name);
+        munmap(sw, sizeof(vsw_shared_t));
+        return NULL;
+    }
+
+    return sw;
+}
+
+/* priv is the switch name; instances using the same name are connected. */
+static void *
+net_vswitch_init(const netcard_t *card, const uint8_t *mac_addr, void *priv, char *netdrv_errbuf)
+{
+    const char    *name = (const char *) priv;
+    net_vswitch_t *vsw;
+    int            owner;
+
+    if ((name == NULL) || (name[0] == '\0') || !strcmp(name, "none"))
+        name = VSW_NAME;
+    if (strchr(name, '/')) {
+        net_vswitch_error(netdrv_errbuf, "Invalid switch name %s", name);
+        return NULL;
+    }
+
+    vsw       = calloc(1, sizeof(net_vswitch_t));
+    vsw->card = (netcard_t *) card;
+    vsw->pid  = getpid();
+    vsw->port = -1;
+    snprintf(vsw->shm_name, sizeof(vsw->shm_name), "/86box-vswitch-%s", name);
+
+    vsw->sw = vsw_map(vsw->shm_name, netdrv_errbuf);
+    if (vsw->sw == NULL) {
+        free(vsw);
+        return NULL;
+    }
+
+    for (int pass = 0; (pass < 2) && (vsw->port < 0); pass++) {
+        for (int i = 0; i < VSW_PORTS; i++) {
+            owner = 0;
+            if (atomic_compare_exchange_strong(&vsw->sw->port[i].owner, &owner, vsw->pid)) {
+                vsw->port = i;
+                break;
+            }
+        }
+        if (vsw->port < 0)
+            vsw_reap(vsw);
+    }
+    if (vsw->port < 0) {
+        net_vswitch_error(netdrv_errbuf, "All %i ports of switch %s are in use", VSW_PORTS, name);
+        munmap(vsw->sw, sizeof(vsw_shared_t));
+        free(vsw);
+        return NULL;
+    }
+
+    /* Drop anything left over for a previous user of the port. */
+    for (int i = 0; i < VSW_PORTS; i++) {
+        vsw_ring_t *ring = &vsw->sw->ring[i][vsw->port];
+
+        atomic_store(&ring->tail, atomic_load(&ring->head));
+    }
+    atomic_store(&vsw->sw->port[vsw->port].mac, vsw_mac(mac_addr));
+
+    vswitch_log("VSWITCH: connected to %s, port %i\n", name, vsw->port);
+
+    for (int i = 0; i < VSW_PKT_BATCH; i++)
+        vsw->pktv[i].data = calloc(1, NET_MAX_FRAME);
+
+    vsw->poll_tid = thread_create_named(net_vswitch_thread, vsw, "Virtual switch");
+
+    return vsw;
+}
+
+static void
+net_vswitch_in_available(void *priv)
+{
+    net_vswitch_t *vsw = (net_vswitch_t *) priv;
+
+    vsw_ring_bell(&vsw->sw->port[vsw->port]);
+}
+
+static void
+net_vswitch_close(void *priv)
+{
+    net_vswitch_t *vsw = (net_vswitch_t *) priv;
+
+    if (!vsw)
+        return;
+
+    vswitch_log("VSWITCH: closing.\n");
+    atomic_store(&vsw->stop, 1);
+    vsw_ring_bell(&vsw->sw->port[vsw->port]);
+    thread_wait(vsw->poll_tid);
+
+    atomic_store(&vsw->sw->port[vsw->port].mac, 0);
+    atomic_store(&vsw->sw->port[vsw->port].owner, 0);
+    munmap(vsw->sw, sizeof(vsw_shared_t));
+
+    for (int i = 0; i < VSW_PKT_BATCH; i++)
+        free(vsw->pktv[i].data);
+    free(vsw);
+}
+
+const netdrv_t net_vswitch_drv = {
+    &net_vswitch_in_available,
+    &net_vswitch_init,
+    &net_vswitch_close,
+    NULL
+};
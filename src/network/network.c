@@ -68,6 +68,7 @@
 #include <86box/net_ne2000.h>
 #include <86box/net_pcnet.h>
 #include <86box/net_wd8003.h>
+#include <minitrace/minitrace.h>
 
 #ifdef _WIN32
 #    define WIN32_LEAN_AND_MEAN
@@ -227,6 +228,15 @@ network_init(void)
         network_devmap.has_vde = 1;
 #endif
 
+#ifdef HAS_TAP
+    if (!net_tap_prepare())
+        network_devmap.has_tap = 1;
+#endif
+
+#ifdef HAS_VSWITCH
+    network_devmap.has_vswitch = 1;
+#endif
+
 #ifdef ENABLE_NETWORK_LOG
     /* Start packet dump. */
     network_dump = fopen("network.pcap", "wb");
@@ -261,26 +271,82 @@ network_init(void)
 #endif
 }
 
+static int
+network_queue_size(int len)
+{
+    int size = NET_QUEUE_LEN_MIN;
+
+    if (len <= 0)
+        len = NET_QUEUE_LEN_DEFAULT;
+    while ((size < len) && (size < NET_QUEUE_LEN_MAX))
+        size <<= 1;
+
+    return size;
+}
+
 void
-network_queue_init(netqueue_t *queue)
+network_queue_init(netqueue_t *queue, int size)
 {
-    queue->head = queue->tail = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    queue->packets = calloc(size, sizeof(netpkt_t));
+    queue->mask    = size - 1;
+    for (int i = 0; i < size; i++) {
         queue->packets[i].data = calloc(1, NET_MAX_FRAME);
         queue->packets[i].len  = 0;
     }
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
 }
 
+/*
+ * The queues are single producer, single consumer rings: only the producer
+ * moves the head and only the consumer moves the tail. A slot is filled (or
+ * swapped out) before the index that hands it over is published, so the two
+ * sides need no lock between them.
+ */
 static bool
 network_queue_full(netqueue_t *queue)
 {
-    return ((queue->head + 1) & NET_QUEUE_LEN_MASK) == queue->tail;
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    return ((head + 1) & queue->mask) == atomic_load_explicit(&queue->tail, memory_order_acquire);
 }
 
 static bool
 network_queue_empty(netqueue_t *queue)
 {
-    return (queue->head == queue->tail);
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    return (atomic_load_explicit(&queue->head, memory_order_acquire) == tail);
+}
+
+static inline void
+network_queue_push(netqueue_t *queue)
+{
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    atomic_store_explicit(&queue->head, (head + 1) & queue->mask, memory_order_release);
+}
+
+static inline void
+network_queue_pop(netqueue_t *queue, int count)
+{
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&queue->tail, (tail + count) & queue->mask, memory_order_release);
+}
+
+/* Returns the number of queued packets stored contiguously from the tail. */
+static int
+network_queue_peek(netqueue_t *queue, netpkt_t **pkts)
+{
+    uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    *pkts = &queue->packets[tail];
+    if (head >= tail)
+        return head - tail;
+
+    return queue->mask + 1 - tail;
 }
 
 static inline void
@@ -298,10 +364,10 @@ network_queue_put(netqueue_t *queue, uint8_t *data, int len)
         return 0;
     }
 
-    netpkt_t *pkt = &queue->packets[queue->head];
+    netpkt_t *pkt = &queue->packets[atomic_load_explicit(&queue->head, memory_order_relaxed)];
     memcpy(pkt->data, data, len);
-    pkt->len    = len;
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    pkt->len = len;
+    network_queue_push(queue);
     return 1;
 }
 
@@ -321,10 +387,10 @@ network_queue_put_swap(netqueue_t *queue, netpkt_t *src_pkt)
         return 0;
     }
 
-    netpkt_t *dst_pkt = &queue->packets[queue->head];
+    netpkt_t *dst_pkt = &queue->packets[atomic_load_explicit(&queue->head, memory_order_relaxed)];
     network_swap_packet(src_pkt, dst_pkt);
 
-    queue->head = (queue->head + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_push(queue);
     return 1;
 }
 
@@ -334,9 +400,9 @@ network_queue_get_swap(netqueue_t *queue, netpkt_t *dst_pkt)
     if (network_queue_empty(queue))
         return 0;
 
-    netpkt_t *src_pkt = &queue->packets[queue->tail];
+    netpkt_t *src_pkt = &queue->packets[atomic_load_explicit(&queue->tail, memory_order_relaxed)];
     network_swap_packet(src_pkt, dst_pkt);
-    queue->tail = (queue->tail + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_pop(queue, 1);
     return 1;
 }
 
@@ -350,12 +416,12 @@ network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
         return 0;
     }
 
-    netpkt_t *src_pkt = &src_q->packets[src_q->tail];
-    netpkt_t *dst_pkt = &dst_q->packets[dst_q->head];
+    netpkt_t *src_pkt = &src_q->packets[atomic_load_explicit(&src_q->tail, memory_order_relaxed)];
+    netpkt_t *dst_pkt = &dst_q->packets[atomic_load_explicit(&dst_q->head, memory_order_relaxed)];
 
     network_swap_packet(src_pkt, dst_pkt);
-    dst_q->head = (dst_q->head + 1) & NET_QUEUE_LEN_MASK;
-    src_q->tail = (src_q->tail + 1) & NET_QUEUE_LEN_MASK;
+    network_queue_push(dst_q);
+    network_queue_pop(src_q, 1);
 
     return dst_pkt->len;
 }
@@ -363,17 +429,24 @@ network_queue_move(netqueue_t *dst_q, netqueue_t *src_q)
 void
 network_queue_clear(netqueue_t *queue)
 {
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    for (uint32_t i = 0; i <= queue->mask; i++) {
         free(queue->packets[i].data);
         queue->packets[i].len = 0;
     }
-    queue->tail = queue->head = 0;
+    free(queue->packets);
+    queue->packets = NULL;
+    atomic_store(&queue->tail, 0);
+    atomic_store(&queue->head, 0);
 }
 
 static void
 network_rx_queue(void *priv)
 {
-    netcard_t *card = (netcard_t *) priv;
+    netcard_t  *card = (netcard_t *) priv;
+    netqueue_t *queue;
+    netpkt_t   *pkts;
+    int         n;
+    int         k;
 
     uint32_t new_link_state = net_cards_conf[card->card_num].link_state;
     if (new_link_state != card->link_state) {
@@ -382,38 +455,57 @@ network_rx_queue(void *priv)
         card->link_state = new_link_state;
     }
 
+    /* Reception, straight from the queue slots; packets the card does not
+       accept stay queued for the next run. */
     uint32_t rx_bytes = 0;
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
-        if (card->queued_pkt.len == 0) {
-            thread_wait_mutex(card->rx_mutex);
-            int res = network_queue_get_swap(&card->queues[NET_QUEUE_RX], &card->queued_pkt);
-            thread_release_mutex(card->rx_mutex);
-            if (!res)
-                break;
+    queue             = &card->queues[NET_QUEUE_RX];
+    for (int left = queue->mask; left > 0; left -= n) {
+        n = network_queue_peek(queue, &pkts);
+        if (n > left)
+            n = left;
+        if (!n)
+            break;
+
+        MTR_BEGIN_I("network", "rx", "count", n);
+        if (card->rxv)
+            k = card->rxv(card->card_drv, pkts, n);
+        else {
+            for (k = 0; k < n; k++) {
+                if (!card->rx(card->card_drv, pkts[k].data, pkts[k].len))
+                    break;
+            }
         }
+        MTR_END("network", "rx");
 
-        network_dump_packet(&card->queued_pkt);
-        int res = card->rx(card->card_drv, card->queued_pkt.data, card->queued_pkt.len);
-        if (!res)
+        for (int i = 0; i < k; i++) {
+            network_dump_packet(&pkts[i]);
+            rx_bytes += pkts[i].len;
+        }
+        network_queue_pop(queue, k);
+        if (k < n)
             break;
-        rx_bytes += card->queued_pkt.len;
-        card->queued_pkt.len = 0;
     }
 
     /* Transmission. */
     uint32_t tx_bytes = 0;
-    thread_wait_mutex(card->tx_mutex);
-    for (int i = 0; i < NET_QUEUE_LEN; i++) {
+    MTR_BEGIN("network", "tx");
+    for (uint32_t i = 0; i < card->queues[NET_QUEUE_TX_VM].mask; i++) {
         uint32_t bytes = network_queue_move(&card->queues[NET_QUEUE_TX_HOST], &card->queues[NET_QUEUE_TX_VM]);
         if (!bytes)
             break;
         tx_bytes += bytes;
     }
-    thread_release_mutex(card->tx_mutex);
-    if (tx_bytes) {
-        /* Notify host that a packet is available in the TX queue */
+    if (!network_queue_empty(&card->queues[NET_QUEUE_TX_HOST])) {
+        /* Notify host that packets are available in the TX queue; the host
+           drivers take a batch at a time, so keep doing so until it drains. */
         card->host_drv.notify_in(card->host_drv.priv);
     }
+    MTR_END("network", "tx");
+
+    if (rx_bytes)
+        MTR_COUNTER("network", "rx_bytes", rx_bytes);
+    if (tx_bytes)
+        MTR_COUNTER("network", "tx_bytes", tx_bytes);
 
     double timer_period = card->byte_period * (rx_bytes > tx_bytes ? rx_bytes : tx_bytes);
     if (timer_period < 200)
@@ -441,22 +533,21 @@ network_rx_queue(void *priv)
 netcard_t *
 network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_link_state)
 {
-    netcard_t *card       = calloc(1, sizeof(netcard_t));
-    int net_type          = net_cards_conf[net_card_current].net_type;
-    card->queued_pkt.data = calloc(1, NET_MAX_FRAME);
-    card->card_drv        = card_drv;
-    card->rx              = rx;
-    card->set_link_state  = set_link_state;
-    card->tx_mutex        = thread_create_mutex();
-    card->rx_mutex        = thread_create_mutex();
-    card->card_num        = net_card_current;
-    card->byte_period     = NET_PERIOD_10M;
+    netcard_t *card      = calloc(1, sizeof(netcard_t));
+    int net_type         = net_cards_conf[net_card_current].net_type;
+    int queue_size       = network_queue_size(net_cards_conf[net_card_current].queue_len);
+    card->card_drv       = card_drv;
+    card->rx             = rx;
+    card->set_link_state = set_link_state;
+    card->rx_mutex       = thread_create_mutex();
+    card->card_num       = net_card_current;
+    card->byte_period    = NET_PERIOD_10M;
 
     char net_drv_error[NET_DRV_ERRBUF_SIZE];
     wchar_t tempmsg[NET_DRV_ERRBUF_SIZE * 2];
 
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
-        network_queue_init(&card->queues[i]);
+        network_queue_init(&card->queues[i], queue_size);
     }
 
     if ((!strcmp(network_card_get_internal_name(net_cards_conf[net_card_current].device_num), "modem") ||
@@ -480,6 +571,18 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
             card->host_drv      = net_vde_drv;
             card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
             break;
+#endif
+#ifdef HAS_TAP
+        case NET_TYPE_TAP:
+            card->host_drv      = net_tap_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
+            break;
+#endif
+#ifdef HAS_VSWITCH
+        case NET_TYPE_VSWITCH:
+            card->host_drv      = net_vswitch_drv;
+            card->host_drv.priv = card->host_drv.init(card, mac, net_cards_conf[net_card_current].host_dev_name, net_drv_error);
+            break;
 #endif
         default:
             card->host_drv.priv = NULL;
@@ -508,13 +611,11 @@ network_attach(void *card_drv, uint8_t *mac, NETRXCB rx, NETSETLINKSTATE set_lin
         // If null fails, something is very wrong
         // Clean up and fatal
         if(!card->host_drv.priv) {
-            thread_close_mutex(card->tx_mutex);
             thread_close_mutex(card->rx_mutex);
             for (int i = 0; i < NET_QUEUE_COUNT; i++) {
                 network_queue_clear(&card->queues[i]);
             }
 
-            free(card->queued_pkt.data);
             free(card);
             // Placeholder - insert the error message
             fatal("Error initializing the network device: Null driver initialization failed\n");
@@ -535,13 +636,11 @@ netcard_close(netcard_t *card)
     timer_stop(&card->timer);
     card->host_drv.close(card->host_drv.priv);
 
-    thread_close_mutex(card->tx_mutex);
     thread_close_mutex(card->rx_mutex);
     for (int i = 0; i < NET_QUEUE_COUNT; i++) {
         network_queue_clear(&card->queues[i]);
     }
 
-    free(card->queued_pkt.data);
     free(card);
 }
 
@@ -592,16 +691,18 @@ network_tx(netcard_t *card, uint8_t *bufp, int len)
     network_queue_put(&card->queues[NET_QUEUE_TX_VM], bufp, len);
 }
 
+/* Register a batched receive handler, used instead of the per-packet one. */
+void
+network_set_rxv(netcard_t *card, NETRXVCB rxv)
+{
+    card->rxv = rxv;
+}
+
+/* Only to be called from the host driver thread. */
 int
 network_tx_pop(netcard_t *card, netpkt_t *out_pkt)
 {
-    int ret = 0;
-
-    thread_wait_mutex(card->tx_mutex);
-    ret = network_queue_get_swap(&card->queues[NET_QUEUE_TX_HOST], out_pkt);
-    thread_release_mutex(card->tx_mutex);
-
-    return ret;
+    return network_queue_get_swap(&card->queues[NET_QUEUE_TX_HOST], out_pkt);
 }
 
 int
@@ -610,7 +711,6 @@ network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
     int pkt_count = 0;
 
     netqueue_t *queue = &card->queues[NET_QUEUE_TX_HOST];
-    thread_wait_mutex(card->tx_mutex);
     for (int i = 0; i < vec_size; i++) {
         if (!network_queue_get_swap(queue, pkt_vec))
             break;
@@ -618,11 +718,15 @@ network_tx_popv(netcard_t *card, netpkt_t *pkt_vec, int vec_size)
         pkt_count++;
         pkt_vec++;
     }
-    thread_release_mutex(card->tx_mutex);
 
     return pkt_count;
 }
 
+/*
+ * The RX queue is consumed without locking; the mutex only serializes
+ * producers, as loopback frames are put from the emulation thread while the
+ * host driver puts received ones from its own thread.
+ */
 int
 network_rx_put(netcard_t *card, uint8_t *bufp, int len)
 {
@@ -647,6 +751,21 @@ network_rx_put_pkt(netcard_t *card, netpkt_t *pkt)
     return ret;
 }
 
+/* Queues a batch of received packets under a single lock, swapping their
+   buffers into the queue; returns how many packets were queued. */
+int
+network_rx_putv(netcard_t *card, netpkt_t *pkt, int count)
+{
+    int ret = 0;
+
+    thread_wait_mutex(card->rx_mutex);
+    for (int i = 0; i < count; i++)
+        ret += network_queue_put_swap(&card->queues[NET_QUEUE_RX], &pkt[i]);
+    thread_release_mutex(card->rx_mutex);
+
+    return ret;
+}
+
 void
 network_connect(int id, int connect)
 {
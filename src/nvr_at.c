@@ -236,6 +236,7 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/nvr.h>
+#include <86box/snapshot.h>
 
 /* RTC registers and bit definitions. */
 #define RTC_SECONDS        0
@@ -1051,6 +1052,64 @@ nvr_at_reset(void *priv)
     nvr->regs[RTC_REGC] &= ~(REGC_PF | REGC_AF | REGC_UF | REGC_IRQF);
 }
 
+static void
+nvr_at_save_state(void *priv, snapshot_t *s)
+{
+    nvr_t   *nvr   = (nvr_t *) priv;
+    local_t *local = (local_t *) nvr->data;
+
+    snapshot_write(s, nvr->regs, nvr->size);
+    SNAPSHOT_WRITE_VAR(s, nvr->onesec_cnt);
+    snapshot_write_timer(s, &nvr->onesec_time);
+
+    SNAPSHOT_WRITE_VAR(s, local->stat);
+    SNAPSHOT_WRITE_VAR(s, local->read_addr);
+    SNAPSHOT_WRITE_VAR(s, local->wp_0d);
+    SNAPSHOT_WRITE_VAR(s, local->wp_32);
+    SNAPSHOT_WRITE_VAR(s, local->irq_state);
+    SNAPSHOT_WRITE_VAR(s, local->smi_status);
+    SNAPSHOT_WRITE_VAR(s, local->wp);
+    SNAPSHOT_WRITE_VAR(s, local->bank);
+    snapshot_write(s, local->lock, nvr->size);
+    SNAPSHOT_WRITE_VAR(s, local->count);
+    SNAPSHOT_WRITE_VAR(s, local->state);
+    SNAPSHOT_WRITE_VAR(s, local->addr);
+    SNAPSHOT_WRITE_VAR(s, local->smi_enable);
+    SNAPSHOT_WRITE_VAR(s, local->ecount);
+    SNAPSHOT_WRITE_VAR(s, local->rtc_time);
+    snapshot_write_timer(s, &local->update_timer);
+    snapshot_write_timer(s, &local->rtc_timer);
+}
+
+static void
+nvr_at_load_state(void *priv, snapshot_t *s)
+{
+    nvr_t   *nvr   = (nvr_t *) priv;
+    local_t *local = (local_t *) nvr->data;
+
+    snapshot_read(s, nvr->regs, nvr->size);
+    SNAPSHOT_READ_VAR(s, nvr->onesec_cnt);
+    snapshot_read_timer(s, &nvr->onesec_time);
+
+    SNAPSHOT_READ_VAR(s, local->stat);
+    SNAPSHOT_READ_VAR(s, local->read_addr);
+    SNAPSHOT_READ_VAR(s, local->wp_0d);
+    SNAPSHOT_READ_VAR(s, local->wp_32);
+    SNAPSHOT_READ_VAR(s, local->irq_state);
+    SNAPSHOT_READ_VAR(s, local->smi_status);
+    SNAPSHOT_READ_VAR(s, local->wp);
+    SNAPSHOT_READ_VAR(s, local->bank);
+    snapshot_read(s, local->lock, nvr->size);
+    SNAPSHOT_READ_VAR(s, local->count);
+    SNAPSHOT_READ_VAR(s, local->state);
+    SNAPSHOT_READ_VAR(s, local->addr);
+    SNAPSHOT_READ_VAR(s, local->smi_enable);
+    SNAPSHOT_READ_VAR(s, local->ecount);
+    SNAPSHOT_READ_VAR(s, local->rtc_time);
+    snapshot_read_timer(s, &local->update_timer);
+    snapshot_read_timer(s, &local->rtc_timer);
+}
+
 static void *
 nvr_at_init(const device_t *info)
 {
@@ -1227,7 +1286,9 @@ const device_t at_nvr_old_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t at_nvr_device = {
@@ -1241,7 +1302,9 @@ const device_t at_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t at_mb_nvr_device = {
@@ -1255,7 +1318,9 @@ const device_t at_mb_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ps_nvr_device = {
@@ -1269,7 +1334,9 @@ const device_t ps_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t amstrad_nvr_device = {
@@ -1283,7 +1350,9 @@ const device_t amstrad_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ibmat_nvr_device = {
@@ -1297,7 +1366,9 @@ const device_t ibmat_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t piix4_nvr_device = {
@@ -1311,7 +1382,9 @@ const device_t piix4_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ps_no_nmi_nvr_device = {
@@ -1325,7 +1398,9 @@ const device_t ps_no_nmi_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t amstrad_no_nmi_nvr_device = {
@@ -1339,7 +1414,9 @@ const device_t amstrad_no_nmi_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ami_1992_nvr_device = {
@@ -1353,7 +1430,9 @@ const device_t ami_1992_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ami_1994_nvr_device = {
@@ -1367,7 +1446,9 @@ const device_t ami_1994_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t ami_1995_nvr_device = {
@@ -1381,7 +1462,9 @@ const device_t ami_1995_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t via_nvr_device = {
@@ -1395,7 +1478,9 @@ const device_t via_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t p6rp4_nvr_device = {
@@ -1409,7 +1494,9 @@ const device_t p6rp4_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t amstrad_megapc_nvr_device = {
@@ -1423,7 +1510,9 @@ const device_t amstrad_megapc_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
 
 const device_t elt_nvr_device = {
@@ -1437,5 +1526,7 @@ const device_t elt_nvr_device = {
     { .available = NULL },
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = nvr_at_save_state,
+    .load_state    = nvr_at_load_state
 };
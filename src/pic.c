@@ -18,6 +18,7 @@
  *          Copyright 2016-2020 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,6 +38,7 @@
 #include <86box/apm.h>
 #include <86box/nvr.h>
 #include <86box/acpi.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 enum {
@@ -898,3 +900,62 @@ picinterrupt(void)
 
     return ret;
 }
+
+static void
+pic_save_one(snapshot_t *s, pic_t *dev)
+{
+    /* Everything but the slave pointers, which are set up by the machine. */
+    snapshot_write(s, dev, offsetof(pic_t, slaves));
+}
+
+static void
+pic_load_one(snapshot_t *s, pic_t *dev)
+{
+    snapshot_read(s, dev, offsetof(pic_t, slaves));
+}
+
+void
+pic_save_state(snapshot_t *s)
+{
+    pic_save_one(s, &pic);
+    pic_save_one(s, &pic2);
+    snapshot_write_timer(s, &pic_timer);
+
+    SNAPSHOT_WRITE_VAR(s, shadow);
+    SNAPSHOT_WRITE_VAR(s, elcr_enabled);
+    SNAPSHOT_WRITE_VAR(s, pic_pci);
+    SNAPSHOT_WRITE_VAR(s, kbd_latch);
+    SNAPSHOT_WRITE_VAR(s, mouse_latch);
+    SNAPSHOT_WRITE_VAR(s, smi_irq_mask);
+    SNAPSHOT_WRITE_VAR(s, smi_irq_status);
+    SNAPSHOT_WRITE_VAR(s, latched_irqs);
+}
+
+void
+pic_load_state(snapshot_t *s)
+{
+    int kbd;
+    int mouse;
+
+    pic_load_one(s, &pic);
+    pic_load_one(s, &pic2);
+    snapshot_read_timer(s, &pic_timer);
+
+    SNAPSHOT_READ_VAR(s, shadow);
+    SNAPSHOT_READ_VAR(s, elcr_enabled);
+    SNAPSHOT_READ_VAR(s, pic_pci);
+    SNAPSHOT_READ_VAR(s, kbd);
+    SNAPSHOT_READ_VAR(s, mouse);
+    SNAPSHOT_READ_VAR(s, smi_irq_mask);
+    SNAPSHOT_READ_VAR(s, smi_irq_status);
+    SNAPSHOT_READ_VAR(s, latched_irqs);
+
+    if (snapshot_error(s))
+        return;
+
+    /* Go through the setters so the port 60h latch handler follows. */
+    pic_kbd_latch(kbd);
+    pic_mouse_latch(mouse);
+
+    update_pending();
+}
@@ -18,6 +18,7 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -41,6 +42,7 @@
 #include <86box/sound.h>
 #include <86box/snd_speaker.h>
 #include <86box/video.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 pit_intf_t pit_devs[2];
@@ -927,6 +929,29 @@ pit_close(void *priv)
         free(dev);
 }
 
+static void
+pit_save_state(void *priv, snapshot_t *s)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    /* Everything but the load and out callbacks, which are set by the machine. */
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_write(s, &dev->counters[i], offsetof(ctr_t, load_func));
+    SNAPSHOT_WRITE_VAR(s, dev->ctrl);
+    snapshot_write_timer(s, &dev->callback_timer);
+}
+
+static void
+pit_load_state(void *priv, snapshot_t *s)
+{
+    pit_t *dev = (pit_t *) priv;
+
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_read(s, &dev->counters[i], offsetof(ctr_t, load_func));
+    SNAPSHOT_READ_VAR(s, dev->ctrl);
+    snapshot_read_timer(s, &dev->callback_timer);
+}
+
 static void *
 pit_init(const device_t *info)
 {
@@ -963,7 +988,9 @@ const device_t i8253_device = {
     { .available = NULL },
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8253_ext_io_device = {
@@ -977,7 +1004,9 @@ const device_t i8253_ext_io_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_device = {
@@ -991,7 +1020,9 @@ const device_t i8254_device = {
     { .available = NULL },
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_sec_device = {
@@ -1005,7 +1036,9 @@ const device_t i8254_sec_device = {
     { .available = NULL },
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_ext_io_device = {
@@ -1019,7 +1052,9 @@ const device_t i8254_ext_io_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 const device_t i8254_ps2_device = {
@@ -1033,7 +1068,9 @@ const device_t i8254_ps2_device = {
     { .available = NULL },
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = pit_save_state,
+    .load_state    = pit_load_state
 };
 
 pit_t *
@@ -38,6 +38,7 @@
 #include <86box/port_6x.h>
 #include <86box/plat_unused.h>
 #include <86box/random.h>
+#include <86box/snapshot.h>
 
 #define PS2_REFRESH_TIME (16 * TIMER_USEC)
 
@@ -163,6 +164,26 @@ port_6x_refresh(void *priv)
     timer_advance_u64(&dev->refresh_timer, PS2_REFRESH_TIME);
 }
 
+static void
+port_6x_save_state(void *priv, snapshot_t *s)
+{
+    port_6x_t *dev = (port_6x_t *) priv;
+
+    SNAPSHOT_WRITE_VAR(s, dev->refresh);
+    if (dev->flags & PORT_6X_EXT_REF)
+        snapshot_write_timer(s, &dev->refresh_timer);
+}
+
+static void
+port_6x_load_state(void *priv, snapshot_t *s)
+{
+    port_6x_t *dev = (port_6x_t *) priv;
+
+    SNAPSHOT_READ_VAR(s, dev->refresh);
+    if (dev->flags & PORT_6X_EXT_REF)
+        snapshot_read_timer(s, &dev->refresh_timer);
+}
+
 static void
 port_6x_close(void *priv)
 {
@@ -215,7 +236,9 @@ const device_t port_6x_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = port_6x_save_state,
+    .load_state    = port_6x_load_state
 };
 
 const device_t port_6x_xi8088_device = {
@@ -243,7 +266,9 @@ const device_t port_6x_ps2_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = port_6x_save_state,
+    .load_state    = port_6x_load_state
 };
 
 const device_t port_6x_olivetti_device = {
@@ -257,5 +282,7 @@ const device_t port_6x_olivetti_device = {
     { .available = NULL },
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = port_6x_save_state,
+    .load_state    = port_6x_load_state
 };
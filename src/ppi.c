@@ -14,6 +14,7 @@
 #include <86box/timer.h>
 #include <86box/pit.h>
 #include <86box/ppi.h>
+#include <86box/snapshot.h>
 
 PPI ppi;
 int ppispeakon;
@@ -23,3 +24,17 @@ ppi_reset(void)
 {
     memset(&ppi, 0x00, sizeof(PPI));
 }
+
+void
+ppi_save_state(snapshot_t *s)
+{
+    SNAPSHOT_WRITE_VAR(s, ppi);
+    SNAPSHOT_WRITE_VAR(s, ppispeakon);
+}
+
+void
+ppi_load_state(snapshot_t *s)
+{
+    SNAPSHOT_READ_VAR(s, ppi);
+    SNAPSHOT_READ_VAR(s, ppispeakon);
+}
@@ -6,6 +6,10 @@
  *
  *          Provide centralized access to the PNG image handler.
  *
+ *          Images can also be handed to a background encoder, which does
+ *          the compression and the file write on its own thread so that
+ *          the emulation and blit threads do not stall on them.
+ *
  *
  *
  * Authors: Fred N. van Kempen, <decwiz@yahoo.com>
@@ -55,6 +59,7 @@
 #include <86box/86box.h>
 #include <86box/plat.h>
 #include <86box/plat_dynld.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/video.h>
 #include <86box/png_struct.h>
@@ -278,3 +283,251 @@ error:
     /* No longer need the row buffers. */
     free(rows);
 }
+
+/* Write the given 32-bit xRGB image as an 8-bit RGB PNG image file. */
+static void
+png_write_xrgb32(char *fn, const uint32_t *pix, int w, int h)
+{
+    png_structp png  = NULL;
+    png_infop   info = NULL;
+    png_bytep   row  = NULL;
+    FILE       *fp;
+
+    /* Create the image file. */
+    fp = plat_fopen(fn, "wb");
+    if (fp == NULL) {
+        png_log("PNG: File %s could not be opened for writing!\n", fn);
+        return;
+    }
+
+    /* Initialize PNG stuff. */
+    png = PNGFUNC(create_write_struct)(PNG_LIBPNG_VER_STRING, NULL,
+                                       error_handler, warning_handler);
+    if (png == NULL) {
+        png_log("PNG: create_write_struct failed!\n");
+        goto done;
+    }
+
+    info = PNGFUNC(create_info_struct)(png);
+    if (info == NULL) {
+        png_log("PNG: create_info_struct failed!\n");
+        goto done;
+    }
+
+    PNGFUNC(init_io)
+    (png, fp);
+
+    PNGFUNC(set_IHDR)
+    (png, info, w, h, 8, PNG_COLOR_TYPE_RGB,
+     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE,
+     PNG_FILTER_TYPE_BASE);
+
+    PNGFUNC(write_info)
+    (png, info);
+
+    /* Create a buffer for one scanline of pixels. */
+    row = (png_bytep) malloc(PNGFUNC(get_rowbytes)(png, info));
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint32_t temp = pix[(y * w) + x];
+
+            row[x * 3]       = (temp >> 16) & 0xff;
+            row[(x * 3) + 1] = (temp >> 8) & 0xff;
+            row[(x * 3) + 2] = temp & 0xff;
+        }
+
+        PNGFUNC(write_rows)
+        (png, &row, 1);
+    }
+
+    free(row);
+
+    PNGFUNC(write_end)
+    (png, NULL);
+
+done:
+    if (png != NULL)
+        PNGFUNC(destroy_write_struct)
+    (&png, &info);
+
+    (void) fclose(fp);
+}
+
+/* Background encoder. The queue is bounded; a caller that finds it full
+   waits for the worker to catch up. */
+#define PNG_QUEUE_SIZE 16
+
+enum {
+    PNG_JOB_RGB = 0,
+    PNG_JOB_XRGB32
+};
+
+typedef struct png_job_t {
+    int      type;
+    char     fn[1024];
+    uint8_t *pix;
+    int16_t  w;
+    int16_t  h;
+    uint16_t pitch;
+    PALETTE  palcol;
+} png_job_t;
+
+static png_job_t png_queue[PNG_QUEUE_SIZE];
+static int       png_queue_head;
+static int       png_queue_count;
+static int       png_queue_run;
+static mutex_t  *png_queue_mutex;
+static event_t  *png_queue_wake;
+static event_t  *png_queue_done;
+static thread_t *png_queue_thread;
+
+static void
+png_queue_worker(UNUSED(void *priv))
+{
+    png_job_t job;
+
+    while (1) {
+        thread_wait_mutex(png_queue_mutex);
+        if (png_queue_count == 0) {
+            if (!png_queue_run) {
+                thread_release_mutex(png_queue_mutex);
+                break;
+            }
+            thread_reset_event(png_queue_wake);
+            thread_release_mutex(png_queue_mutex);
+            thread_wait_event(png_queue_wake, -1);
+            continue;
+        }
+
+        job            = png_queue[png_queue_head];
+        png_queue_head = (png_queue_head + 1) % PNG_QUEUE_SIZE;
+        png_queue_count--;
+        thread_release_mutex(png_queue_mutex);
+        thread_set_event(png_queue_done);
+
+        png_log("PNG: Encoding %s in the background\n", job.fn);
+
+        if (job.type == PNG_JOB_XRGB32)
+            png_write_xrgb32(job.fn, (uint32_t *) job.pix, job.w, job.h);
+        else
+            png_write_rgb(job.fn, job.pix, job.w, job.h, job.pitch, job.palcol);
+        free(job.pix);
+    }
+}
+
+/* Waits until the queue has room; called and returns with the mutex held. */
+static void
+png_queue_wait(void)
+{
+    while (png_queue_count == PNG_QUEUE_SIZE) {
+        thread_reset_event(png_queue_done);
+        thread_release_mutex(png_queue_mutex);
+        thread_wait_event(png_queue_done, -1);
+        thread_wait_mutex(png_queue_mutex);
+    }
+}
+
+/* Jobs come from the blit threads (screenshots) as well as the emulation
+   thread (printed pages), so the queue is set up once, before either can
+   run, and jobs are refused once it has been closed. */
+void
+png_queue_init(void)
+{
+    if (png_queue_mutex != NULL)
+        return;
+
+    png_queue_mutex  = thread_create_mutex();
+    png_queue_wake   = thread_create_event();
+    png_queue_done   = thread_create_event();
+    png_queue_run    = 1;
+    png_queue_thread = thread_create_named(png_queue_worker, NULL, "PNG encoder");
+}
+
+static void
+png_queue_add(png_job_t *job)
+{
+    if (png_queue_mutex == NULL) {
+        pclog("PNG: Encoder not running, %s not written\n", job->fn);
+        free(job->pix);
+        return;
+    }
+
+    thread_wait_mutex(png_queue_mutex);
+    png_queue_wait();
+    if (!png_queue_run) {
+        thread_release_mutex(png_queue_mutex);
+        pclog("PNG: Encoder closed, %s not written\n", job->fn);
+        free(job->pix);
+        return;
+    }
+    png_queue[(png_queue_head + png_queue_count) % PNG_QUEUE_SIZE] = *job;
+    png_queue_count++;
+    thread_release_mutex(png_queue_mutex);
+
+    thread_set_event(png_queue_wake);
+}
+
+/* Queue an 8-bit paletted image, see png_write_rgb(). The pixels are copied. */
+void
+png_queue_rgb(const char *fn, const uint8_t *pix, int16_t w, int16_t h, uint16_t pitch, PALETTE palcol)
+{
+    png_job_t job;
+
+    job.type  = PNG_JOB_RGB;
+    job.pix   = (uint8_t *) malloc((size_t) h * pitch);
+    job.w     = w;
+    job.h     = h;
+    job.pitch = pitch;
+    snprintf(job.fn, sizeof(job.fn), "%s", fn);
+    memcpy(job.pix, pix, (size_t) h * pitch);
+    memcpy(job.palcol, palcol, sizeof(PALETTE));
+
+    png_queue_add(&job);
+}
+
+/* Queue a w x h region of a 32-bit xRGB buffer with row_len pixels per row,
+   or a black image if buf is NULL. The pixels are copied. */
+void
+png_queue_xrgb32(const char *fn, const uint32_t *buf, int start_x, int start_y, int row_len, int16_t w, int16_t h)
+{
+    png_job_t job;
+    uint32_t *pix;
+
+    memset(&job, 0x00, sizeof(png_job_t));
+    job.type = PNG_JOB_XRGB32;
+    job.pix  = (uint8_t *) calloc((size_t) w * h, sizeof(uint32_t));
+    job.w    = w;
+    job.h    = h;
+    snprintf(job.fn, sizeof(job.fn), "%s", fn);
+
+    pix = (uint32_t *) job.pix;
+    if (buf != NULL) {
+        for (int y = 0; y < h; y++)
+            memcpy(&pix[y * w], &buf[((start_y + y) * row_len) + start_x], w * sizeof(uint32_t));
+    }
+
+    png_queue_add(&job);
+}
+
+/* Writes out whatever is queued and stops the worker. The mutex and events
+   are kept, since a blit thread may still try to queue a screenshot. */
+void
+png_queue_close(void)
+{
+    thread_t *thread;
+
+    if (png_queue_mutex == NULL)
+        return;
+
+    thread_wait_mutex(png_queue_mutex);
+    png_queue_run    = 0;
+    thread           = png_queue_thread;
+    png_queue_thread = NULL;
+    thread_release_mutex(png_queue_mutex);
+
+    if (thread != NULL) {
+        thread_set_event(png_queue_wake);
+        thread_wait(thread);
+    }
+}
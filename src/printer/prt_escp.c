@@ -354,7 +354,7 @@ dump_page(escp_t *dev)
 
     strcpy(path, dev->pagepath);
     strcat(path, dev->page_fn);
-    png_write_rgb(path, dev->page->pixels, dev->page->w, dev->page->h, dev->page->pitch, dev->palcol);
+    png_queue_rgb(path, dev->page->pixels, dev->page->w, dev->page->h, dev->page->pitch, dev->palcol);
 }
 
 static void
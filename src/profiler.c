@@ -0,0 +1,358 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Per-device emulation time profiler.
+ *
+ *          Timer callbacks, I/O port handlers and memory mapping handlers
+ *          are sampled (one in PROFILER_SAMPLE_MASK + 1 calls is timed
+ *          with the host TSC) and the elapsed host time is attributed to
+ *          the device owning the handler's private pointer. Ownership is
+ *          learned when the handler is registered from within a device
+ *          context, or looked up lazily in the device table otherwise.
+ *          The totals are rolled over once per second on the emulation
+ *          thread.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#    include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#    include <x86intrin.h>
+#endif
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/plat.h>
+#include <86box/thread.h>
+#include <86box/profiler.h>
+#include <cJSON.h>
+
+#define PROFILER_MAP_SIZE 4096 /* must be a power of two */
+
+typedef struct prof_map_t {
+    const void *priv;
+    int         slot;
+} prof_map_t;
+
+typedef struct prof_slot_t {
+    char     name[128];
+    uint64_t ticks[PROFILER_TYPES];
+    uint64_t samples[PROFILER_TYPES];
+} prof_slot_t;
+
+int      profiler_enabled    = 0;
+uint32_t profiler_sample_ctr = 0;
+
+static prof_map_t       prof_map[PROFILER_MAP_SIZE];
+static prof_slot_t      prof_slots[PROFILER_SLOTS];
+static int              prof_slots_used;
+static profiler_entry_t prof_last[PROFILER_SLOTS];
+static int              prof_last_num;
+static uint64_t         prof_last_total_us;
+static mutex_t         *prof_mutex;
+static atomic_bool_t    prof_onesec_pending;
+static uint64_t         prof_start_ts;
+static uint32_t         prof_start_ms;
+
+#ifdef ENABLE_PROFILER_LOG
+int profiler_do_log = ENABLE_PROFILER_LOG;
+
+static void
+profiler_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (profiler_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define profiler_log(fmt, ...)
+#endif
+
+uint64_t
+profiler_ts(void)
+{
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    return __rdtsc();
+#else
+    return plat_timer_read();
+#endif
+}
+
+static int
+profiler_slot_for_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < prof_slots_used; i++) {
+        if (!strcmp(prof_slots[i].name, name))
+            return i;
+    }
+
+    if (prof_slots_used >= PROFILER_SLOTS)
+        return 0;
+
+    snprintf(prof_slots[prof_slots_used].name, sizeof(prof_slots[0].name), "%s", name);
+    profiler_log("PROFILER: New slot %i: %s\n", prof_slots_used, name);
+
+    return prof_slots_used++;
+}
+
+static prof_map_t *
+profiler_map_find(const void *priv)
+{
+    uint32_t h = (uint32_t) (((uintptr_t) priv >> 4) * 2654435761U) & (PROFILER_MAP_SIZE - 1);
+
+    for (int i = 0; i < PROFILER_MAP_SIZE; i++) {
+        prof_map_t *m = &prof_map[(h + i) & (PROFILER_MAP_SIZE - 1)];
+
+        if ((m->priv == priv) || (m->priv == NULL))
+            return m;
+    }
+
+    /* Map is full, everything else goes to the unattributed slot. */
+    return NULL;
+}
+
+void
+profiler_register(const void *priv)
+{
+    const device_t *dev = device_context_get_device();
+    prof_map_t     *m;
+
+    if ((priv == NULL) || (dev == NULL))
+        return;
+
+    m = profiler_map_find(priv);
+    if ((m != NULL) && (m->priv == NULL)) {
+        m->priv = priv;
+        m->slot = profiler_slot_for_name(device_context_get_name());
+    }
+}
+
+static int
+profiler_resolve(const void *priv)
+{
+    const device_t *dev;
+    prof_map_t     *m;
+
+    if (priv == NULL)
+        return 0;
+
+    m = profiler_map_find(priv);
+    if (m == NULL)
+        return 0;
+
+    if (m->priv == NULL) {
+        /* Not registered from a device context, try the device table. */
+        dev     = device_get_by_priv(priv);
+        m->priv = priv;
+        m->slot = (dev != NULL) ? profiler_slot_for_name(dev->name) : 0;
+    }
+
+    return m->slot;
+}
+
+void
+profiler_account(int type, const void *priv, uint64_t start)
+{
+    uint64_t     elapsed = profiler_ts() - start;
+    prof_slot_t *s       = &prof_slots[profiler_resolve(priv)];
+
+    s->ticks[type] += elapsed;
+    s->samples[type]++;
+}
+
+static int
+profiler_entry_compare(const void *a, const void *b)
+{
+    const profiler_entry_t *ea = (const profiler_entry_t *) a;
+    const profiler_entry_t *eb = (const profiler_entry_t *) b;
+
+    if (ea->percent < eb->percent)
+        return 1;
+    if (ea->percent > eb->percent)
+        return -1;
+    return 0;
+}
+
+/* Called from the one-second timer, on whatever thread that runs on. */
+void
+profiler_onesec(void)
+{
+    atomic_store(&prof_onesec_pending, 1);
+}
+
+/* Called from the emulation thread; rolls the per-second totals over. */
+void
+profiler_process(void)
+{
+    uint64_t now_ts;
+    uint32_t now_ms;
+    uint64_t total_ticks;
+    uint64_t total_us;
+    int      num = 0;
+
+    if (!atomic_exchange(&prof_onesec_pending, 0))
+        return;
+
+    now_ts      = profiler_ts();
+    now_ms      = plat_get_ticks();
+    total_ticks = now_ts - prof_start_ts;
+    total_us    = ((uint64_t) (now_ms - prof_start_ms)) * 1000ULL;
+
+    thread_wait_mutex(prof_mutex);
+
+    if (total_ticks && total_us) {
+        for (int i = 0; i < prof_slots_used; i++) {
+            profiler_entry_t *e = &prof_last[num];
+            uint64_t          t = 0;
+
+            for (int j = 0; j < PROFILER_TYPES; j++)
+                t += prof_slots[i].ticks[j];
+            if (t == 0)
+                continue;
+
+            memcpy(e->name, prof_slots[i].name, sizeof(e->name));
+            for (int j = 0; j < PROFILER_TYPES; j++) {
+                e->calls[j] = prof_slots[i].samples[j] * (PROFILER_SAMPLE_MASK + 1);
+                e->us[j]    = (uint64_t) (((double) prof_slots[i].ticks[j] * (PROFILER_SAMPLE_MASK + 1) *
+                                        (double) total_us) / (double) total_ticks);
+            }
+            e->percent = ((double) t * (PROFILER_SAMPLE_MASK + 1) * 100.0) / (double) total_ticks;
+            num++;
+        }
+
+        qsort(prof_last, num, sizeof(profiler_entry_t), profiler_entry_compare);
+    }
+
+    prof_last_num      = num;
+    prof_last_total_us = total_us;
+
+    thread_release_mutex(prof_mutex);
+
+    for (int i = 0; i < prof_slots_used; i++) {
+        memset(prof_slots[i].ticks, 0x00, sizeof(prof_slots[i].ticks));
+        memset(prof_slots[i].samples, 0x00, sizeof(prof_slots[i].samples));
+    }
+
+    prof_start_ts = now_ts;
+    prof_start_ms = now_ms;
+}
+
+int
+profiler_get_stats(profiler_entry_t *entries, int max)
+{
+    int num;
+
+    if (prof_mutex == NULL)
+        return 0;
+
+    thread_wait_mutex(prof_mutex);
+    num = (prof_last_num < max) ? prof_last_num : max;
+    memcpy(entries, prof_last, num * sizeof(profiler_entry_t));
+    thread_release_mutex(prof_mutex);
+
+    return num;
+}
+
+char *
+profiler_dump_json(void)
+{
+    static const char *type_names[PROFILER_TYPES] = { "timer", "io", "mmio" };
+    profiler_entry_t  *entries;
+    cJSON             *root;
+    cJSON             *devs;
+    char              *ret;
+    int                num;
+
+    entries = (profiler_entry_t *) calloc(PROFILER_SLOTS, sizeof(profiler_entry_t));
+    num     = profiler_get_stats(entries, PROFILER_SLOTS);
+
+    root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", profiler_enabled);
+    cJSON_AddNumberToObject(root, "sample_rate", PROFILER_SAMPLE_MASK + 1);
+    cJSON_AddNumberToObject(root, "period_us", (double) prof_last_total_us);
+    devs = cJSON_AddArrayToObject(root, "devices");
+
+    for (int i = 0; i < num; i++) {
+        cJSON *dev = cJSON_CreateObject();
+
+        cJSON_AddStringToObject(dev, "name", entries[i].name);
+        cJSON_AddNumberToObject(dev, "percent", entries[i].percent);
+        for (int j = 0; j < PROFILER_TYPES; j++) {
+            cJSON *t = cJSON_AddObjectToObject(dev, type_names[j]);
+
+            cJSON_AddNumberToObject(t, "us", (double) entries[i].us[j]);
+            cJSON_AddNumberToObject(t, "calls", (double) entries[i].calls[j]);
+        }
+        cJSON_AddItemToArray(devs, dev);
+    }
+
+    ret = cJSON_Print(root);
+    cJSON_Delete(root);
+    free(entries);
+
+    return ret;
+}
+
+void
+profiler_set_enabled(int enabled)
+{
+    profiler_enabled = !!enabled;
+
+    prof_start_ts = profiler_ts();
+    prof_start_ms = plat_get_ticks();
+}
+
+/* Forget the priv to device associations, they are invalid after a hard reset. */
+void
+profiler_reset(void)
+{
+    memset(prof_map, 0x00, sizeof(prof_map));
+}
+
+void
+profiler_init(void)
+{
+    memset(prof_map, 0x00, sizeof(prof_map));
+    memset(prof_slots, 0x00, sizeof(prof_slots));
+    prof_last_num = 0;
+
+    strcpy(prof_slots[0].name, "Unattributed");
+    prof_slots_used = 1;
+
+    atomic_store(&prof_onesec_pending, 0);
+
+    if (prof_mutex == NULL)
+        prof_mutex = thread_create_mutex();
+}
+
+void
+profiler_close(void)
+{
+    profiler_enabled = 0;
+
+    if (prof_mutex != NULL) {
+        thread_close_mutex(prof_mutex);
+        prof_mutex = NULL;
+    }
+}
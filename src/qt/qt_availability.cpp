@@ -0,0 +1,228 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine and device availability cache for the settings UI.
+ *
+ *          Whether a machine or a card is available comes down to
+ *          whether its ROMs are present, and the settings pages ask for
+ *          every machine and card in the lists each time the machine or
+ *          one of its buses changes. The answers are computed once, in
+ *          batches on the global thread pool, and kept until the ROM
+ *          set changes; whatever is not known yet when asked for is
+ *          computed on the spot.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include "qt_availability.hpp"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+
+#include <utility>
+
+extern "C" {
+#include <86box/86box.h>
+#include <86box/device.h>
+#include <86box/machine.h>
+#include <86box/mem.h>
+#include <86box/rom.h>
+#include <86box/video.h>
+#include <86box/sound.h>
+#include <86box/thread.h>
+#include <86box/timer.h>
+#include <86box/network.h>
+#include <86box/vid_xga_device.h>
+}
+
+namespace {
+
+/* How many machines or devices a single background task checks. */
+constexpr int BatchSize = 32;
+
+QMutex                        mutex;
+uint32_t                      generation = 0;
+QVector<signed char>          machineCache;
+QHash<const device_t *, bool> deviceCache;
+
+void
+storeMachine(uint32_t gen, int m, bool available)
+{
+    QMutexLocker locker(&mutex);
+
+    if ((gen == generation) && (m < machineCache.size()))
+        machineCache[m] = available ? 1 : 0;
+}
+
+void
+storeDevice(uint32_t gen, const device_t *dev, bool available)
+{
+    QMutexLocker locker(&mutex);
+
+    if (gen == generation)
+        deviceCache.insert(dev, available);
+}
+
+class MachineTask : public QRunnable {
+public:
+    MachineTask(uint32_t gen, int first, int last)
+        : gen(gen)
+        , first(first)
+        , last(last)
+    {
+    }
+
+    void run() override
+    {
+        for (int m = first; m < last; m++)
+            storeMachine(gen, m, machine_available(m));
+    }
+
+private:
+    uint32_t gen;
+    int      first;
+    int      last;
+};
+
+class DeviceTask : public QRunnable {
+public:
+    DeviceTask(uint32_t gen, QVector<const device_t *> list)
+        : gen(gen)
+        , list(std::move(list))
+    {
+    }
+
+    void run() override
+    {
+        for (const auto *dev : list)
+            storeDevice(gen, dev, device_available(dev) != 0);
+    }
+
+private:
+    uint32_t                  gen;
+    QVector<const device_t *> list;
+};
+
+void
+addDevice(QVector<const device_t *> &list, const device_t *dev)
+{
+    if ((dev != nullptr) && !list.contains(dev))
+        list.append(dev);
+}
+
+/* The cards the settings pages offer, as in their own loops. */
+QVector<const device_t *>
+cardList()
+{
+    QVector<const device_t *> list;
+
+    for (int c = 0; video_get_internal_name(c)[0] != '\0'; c++)
+        addDevice(list, video_card_getdevice(c));
+    for (int c = 0; sound_card_get_internal_name(c)[0] != '\0'; c++)
+        addDevice(list, sound_card_getdevice(c));
+    for (int c = 0; network_card_get_internal_name(c)[0] != '\0'; c++)
+        addDevice(list, network_card_getdevice(c));
+    addDevice(list, &xga_device);
+    addDevice(list, &xga_isa_device);
+
+    return list;
+}
+
+}
+
+void
+Availability::start()
+{
+    const auto cards = cardList();
+    const int  count = machine_count();
+    uint32_t   gen;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        generation = rom_index_generation();
+        gen        = generation;
+        machineCache.fill(-1, count);
+        deviceCache.clear();
+    }
+
+    auto *pool = QThreadPool::globalInstance();
+    for (int m = 0; m < count; m += BatchSize)
+        pool->start(new MachineTask(gen, m, qMin(m + BatchSize, count)));
+    for (int i = 0; i < cards.size(); i += BatchSize)
+        pool->start(new DeviceTask(gen, cards.mid(i, BatchSize)));
+}
+
+void
+Availability::refresh()
+{
+    uint32_t gen = rom_index_generation();
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if ((gen == generation) && !machineCache.isEmpty())
+            return;
+    }
+
+    start();
+}
+
+bool
+Availability::machine(int m)
+{
+    uint32_t gen;
+    bool     available;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if ((m < machineCache.size()) && (machineCache[m] >= 0))
+            return machineCache[m] > 0;
+        gen = generation;
+    }
+
+    available = machine_available(m);
+    storeMachine(gen, m, available);
+
+    return available;
+}
+
+bool
+Availability::device(const device_t *dev)
+{
+    uint32_t gen;
+    bool     available;
+
+    if (dev == nullptr)
+        return true;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        auto it = deviceCache.constFind(dev);
+        if (it != deviceCache.constEnd())
+            return it.value();
+        gen = generation;
+    }
+
+    available = device_available(dev) != 0;
+    storeDevice(gen, dev, available);
+
+    return available;
+}
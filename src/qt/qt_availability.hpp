@@ -0,0 +1,18 @@
+#ifndef QT_AVAILABILITY_HPP
+#define QT_AVAILABILITY_HPP
+
+struct _device_;
+
+/* Cached answers to machine_available() and device_available() for the
+   settings dialog, computed in the background on the global thread pool. */
+namespace Availability {
+/* Forgets everything and starts checking all machines and cards. */
+void start();
+/* Starts over if the set of ROM files has changed since the last start(). */
+void refresh();
+
+bool machine(int m);
+bool device(const struct _device_ *dev);
+};
+
+#endif
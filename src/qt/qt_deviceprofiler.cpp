@@ -0,0 +1,89 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Device profiler window, shows the per-device emulation time
+ *          of the last second.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include "qt_deviceprofiler.hpp"
+#include "ui_qt_deviceprofiler.h"
+
+#include <QHeaderView>
+#include <QTableWidgetItem>
+
+#include <vector>
+
+extern "C" {
+#include <86box/86box.h>
+#include <86box/profiler.h>
+}
+
+DeviceProfiler::DeviceProfiler(QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::DeviceProfiler)
+{
+    ui->setupUi(this);
+
+    ui->tableWidget->setHorizontalHeaderLabels({ tr("Device"), tr("Host time"), tr("Timers (µs)"),
+                                                 tr("I/O (µs)"), tr("MMIO (µs)"), tr("Calls") });
+    ui->tableWidget->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    ui->tableWidget->verticalHeader()->setVisible(false);
+
+#ifdef USE_PROFILER
+    ui->checkBoxEnable->setChecked(profiler_enabled);
+#endif
+
+    connect(&timer, &QTimer::timeout, this, &DeviceProfiler::refresh);
+    timer.start(1000);
+    refresh();
+}
+
+DeviceProfiler::~DeviceProfiler()
+{
+    delete ui;
+}
+
+void
+DeviceProfiler::on_checkBoxEnable_toggled(bool checked)
+{
+#ifdef USE_PROFILER
+    profiler_set_enabled(checked ? 1 : 0);
+#else
+    (void) checked;
+#endif
+}
+
+void
+DeviceProfiler::refresh()
+{
+#ifdef USE_PROFILER
+    std::vector<profiler_entry_t> entries(PROFILER_SLOTS);
+    int                           num = profiler_get_stats(entries.data(), PROFILER_SLOTS);
+
+    ui->tableWidget->setRowCount(num);
+    for (int i = 0; i < num; i++) {
+        const auto &e     = entries[i];
+        uint64_t    calls = 0;
+
+        for (int j = 0; j < PROFILER_TYPES; j++)
+            calls += e.calls[j];
+
+        ui->tableWidget->setItem(i, 0, new QTableWidgetItem(QString::fromUtf8(e.name)));
+        ui->tableWidget->setItem(i, 1, new QTableWidgetItem(QString::asprintf("%.2f%%", e.percent)));
+        ui->tableWidget->setItem(i, 2, new QTableWidgetItem(QString::number(e.us[PROFILER_TIMER])));
+        ui->tableWidget->setItem(i, 3, new QTableWidgetItem(QString::number(e.us[PROFILER_IO])));
+        ui->tableWidget->setItem(i, 4, new QTableWidgetItem(QString::number(e.us[PROFILER_MMIO])));
+        ui->tableWidget->setItem(i, 5, new QTableWidgetItem(QString::number(calls)));
+    }
+#endif
+}
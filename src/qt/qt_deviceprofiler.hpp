@@ -0,0 +1,27 @@
+#ifndef QT_DEVICEPROFILER_HPP
+#define QT_DEVICEPROFILER_HPP
+
+#include <QDialog>
+#include <QTimer>
+
+namespace Ui {
+class DeviceProfiler;
+}
+
+class DeviceProfiler : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit DeviceProfiler(QWidget *parent = nullptr);
+    ~DeviceProfiler();
+
+private slots:
+    void on_checkBoxEnable_toggled(bool checked);
+    void refresh();
+
+private:
+    Ui::DeviceProfiler *ui;
+    QTimer              timer;
+};
+
+#endif // QT_DEVICEPROFILER_HPP
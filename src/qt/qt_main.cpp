@@ -62,10 +62,15 @@ extern "C" {
 #include <86box/version.h>
 }
 
+#ifdef MTR_ENABLED
+#    include <minitrace/minitrace.h>
+#endif
+
 #include <thread>
 #include <iostream>
 #include <memory>
 
+#include "qt_availability.hpp"
 #include "qt_mainwindow.hpp"
 #include "qt_progsettings.hpp"
 #include "qt_settings.hpp"
@@ -95,6 +100,9 @@ main_thread_fn()
 
     QThread::currentThread()->setPriority(QThread::HighestPriority);
     plat_set_thread_name(nullptr, "main_thread_fn");
+#ifdef MTR_ENABLED
+    mtr_register_thread_name("main_thread_fn");
+#endif
     framecountx = 0;
     // title_update = 1;
     uint64_t old_time = elapsed_timer.elapsed();
@@ -193,6 +201,10 @@ main(int argc, char *argv[])
 #endif
     elapsed_timer.start();
 
+#ifdef MTR_ENABLED
+    mtr_register_thread_name("qt_gui_thread");
+#endif
+
     if (!pc_init(argc, argv)) {
         return 0;
     }
@@ -230,6 +242,9 @@ main(int argc, char *argv[])
         return 6;
     }
 
+    // Get the settings dialog's machine and card lists going in the background
+    Availability::start();
+
     // UUID / copy / move detection
     if(!util::compareUuid()) {
         QMessageBox movewarnbox;
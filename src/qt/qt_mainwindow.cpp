@@ -29,6 +29,7 @@
 #include "qt_soundgain.hpp"
 #include "qt_progsettings.hpp"
 #include "qt_mcadevicelist.hpp"
+#include "qt_deviceprofiler.hpp"
 
 #include "qt_rendererstack.hpp"
 #include "qt_renderercommon.hpp"
@@ -48,6 +49,8 @@ extern "C" {
 #include <86box/machine.h>
 #include <86box/vid_ega.h>
 #include <86box/version.h>
+#include <86box/snapshot.h>
+#include <86box/capture.h>
 #if 0
 #include <86box/acpi.h> /* Requires timer.h include, which conflicts with Qt headers */
 #endif
@@ -85,6 +88,7 @@ extern int qt_nvr_save(void);
 #include <QString>
 #include <QDir>
 #include <QSysInfo>
+#include <QFileDialog>
 #if QT_CONFIG(vulkan)
 #    include <QVulkanInstance>
 #    include <QVulkanFunctions>
@@ -627,39 +631,27 @@ MainWindow::MainWindow(QWidget *parent)
         ui->actionEnd_trace->setVisible(true);
         ui->actionBegin_trace->setShortcut(QKeySequence(Qt::Key_Control + Qt::Key_T));
         ui->actionEnd_trace->setShortcut(QKeySequence(Qt::Key_Control + Qt::Key_T));
-        ui->actionEnd_trace->setDisabled(true);
-        static auto init_trace = [&] {
-            mtr_init("trace.json");
-            mtr_start();
-        };
-        static auto shutdown_trace = [&] {
-            mtr_stop();
-            mtr_shutdown();
-        };
+        /* Tracing may already have been started from the command line, and
+           can be started or stopped from the monitor at any time. */
+        ui->actionBegin_trace->setDisabled(tracing_on);
+        ui->actionEnd_trace->setDisabled(!tracing_on);
+        connect(this, &MainWindow::traceStateChanged, this, [this] {
+            ui->actionBegin_trace->setDisabled(tracing_on);
+            ui->actionEnd_trace->setDisabled(!tracing_on);
+        });
 #    ifdef Q_OS_MACOS
         ui->actionBegin_trace->setShortcutVisibleInContextMenu(true);
         ui->actionEnd_trace->setShortcutVisibleInContextMenu(true);
 #    endif
-        static bool trace = false;
-        connect(ui->actionBegin_trace, &QAction::triggered, this, [this] {
-            if (trace)
-                return;
-            ui->actionBegin_trace->setDisabled(true);
-            ui->actionEnd_trace->setDisabled(false);
-            init_trace();
-            trace = true;
-        });
-        connect(ui->actionEnd_trace, &QAction::triggered, this, [this] {
-            if (!trace)
-                return;
-            ui->actionBegin_trace->setDisabled(false);
-            ui->actionEnd_trace->setDisabled(true);
-            shutdown_trace();
-            trace = false;
-        });
+        connect(ui->actionBegin_trace, &QAction::triggered, this, [] { pc_trace_start("trace.json"); });
+        connect(ui->actionEnd_trace, &QAction::triggered, this, [] { pc_trace_stop(); });
     }
 #endif
 
+#ifdef USE_PROFILER
+    ui->actionDevice_profiler->setVisible(true);
+#endif
+
     setContextMenuPolicy(Qt::PreventContextMenu);
     /* Remove default Shift+F10 handler, which unfocuses keyboard input even with no context menu. */
     connect(new QShortcut(QKeySequence(Qt::SHIFT + Qt::Key_F10), this), &QShortcut::activated, this, [](){});
@@ -905,6 +897,24 @@ MainWindow::on_actionHard_Reset_triggered()
     pc_reset_hard();
 }
 
+void
+MainWindow::on_actionSave_state_triggered()
+{
+    auto fileName = QFileDialog::getSaveFileName(this, tr("Save machine state"), QString(),
+                                                 tr("Machine state snapshots (*.86s)"));
+    if (!fileName.isEmpty())
+        snapshot_save_request(fileName.toUtf8().constData());
+}
+
+void
+MainWindow::on_actionLoad_state_triggered()
+{
+    auto fileName = QFileDialog::getOpenFileName(this, tr("Load machine state"), QString(),
+                                                 tr("Machine state snapshots (*.86s)"));
+    if (!fileName.isEmpty())
+        snapshot_load_request(fileName.toUtf8().constData());
+}
+
 void
 MainWindow::on_actionCtrl_Alt_Del_triggered()
 {
@@ -1881,6 +1891,18 @@ MainWindow::on_actionTake_screenshot_triggered()
     device_force_redraw();
 }
 
+void
+MainWindow::on_actionRecord_video_triggered(bool checked)
+{
+    if (checked) {
+        auto fileName = QFileDialog::getSaveFileName(this, tr("Record video"), QString(),
+                                                     tr("YUV4MPEG2 video (*.y4m)"));
+        if (fileName.isEmpty() || !capture_start(fileName.toUtf8().constData(), CAPTURE_FPS_DEFAULT))
+            ui->actionRecord_video->setChecked(capture_active);
+    } else
+        capture_stop();
+}
+
 void
 MainWindow::on_actionSound_gain_triggered()
 {
@@ -1986,6 +2008,14 @@ MainWindow::on_actionMCA_devices_triggered()
         dlg->exec();
 }
 
+void
+MainWindow::on_actionDevice_profiler_triggered()
+{
+    auto dlg = new DeviceProfiler(this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    dlg->show();
+}
+
 void
 MainWindow::on_actionShow_non_primary_monitors_triggered()
 {
@@ -50,6 +50,7 @@ signals:
     void initRendererMonitorForNonQtThread(int monitor_index);
     void destroyRendererMonitorForNonQtThread(int monitor_index);
     void hardResetCompleted();
+    void traceStateChanged();
 
     void setTitle(const QString &title);
     void setFullscreen(bool state);
@@ -74,6 +75,9 @@ private slots:
     void on_actionCtrl_Alt_Del_triggered();
     void on_actionCtrl_Alt_Esc_triggered();
     void on_actionHard_Reset_triggered();
+    void on_actionSave_state_triggered();
+    void on_actionLoad_state_triggered();
+    void on_actionRecord_video_triggered(bool checked);
     void on_actionRight_CTRL_is_left_ALT_triggered();
     static void on_actionKeyboard_requires_capture_triggered();
     void on_actionResizable_window_triggered(bool checked);
@@ -126,6 +130,7 @@ private slots:
     void getTitle_(wchar_t *title);
 
     void on_actionMCA_devices_triggered();
+    void on_actionDevice_profiler_triggered();
 
 protected:
     void keyPressEvent(QKeyEvent *event) override;
@@ -1061,6 +1061,12 @@ MediaMenu::nicUpdateMenu(int i)
         case NET_TYPE_VDE:
             netType = "VDE";
             break;
+        case NET_TYPE_TAP:
+            netType = "TAP";
+            break;
+        case NET_TYPE_VSWITCH:
+            netType = tr("Virtual switch");
+            break;
     }
 
     QString devName = DeviceConfig::DeviceName(network_card_getdevice(net_cards_conf[i].device_num), network_card_get_internal_name(net_cards_conf[i].device_num), 1);
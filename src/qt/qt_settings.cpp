@@ -34,6 +34,7 @@
 #include "qt_progsettings.hpp"
 #include "qt_harddrive_common.hpp"
 #include "qt_settings_bus_tracking.hpp"
+#include "qt_availability.hpp"
 
 extern "C" {
 #include <86box/86box.h>
@@ -120,6 +121,8 @@ Settings::Settings(QWidget *parent)
     auto *model = new SettingsModel(this);
     ui->listView->setModel(model);
 
+    Availability::refresh();
+
     Harddrives::busTrackClass = new SettingsBusTracking;
     machine                   = new SettingsMachine(this);
     display                   = new SettingsDisplay(this);
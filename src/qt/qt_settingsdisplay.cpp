@@ -28,6 +28,7 @@ extern "C" {
 #include <86box/vid_xga_device.h>
 }
 
+#include "qt_availability.hpp"
 #include "qt_deviceconfig.hpp"
 #include "qt_models_common.hpp"
 
@@ -85,7 +86,7 @@ SettingsDisplay::onCurrentMachineChanged(int machineId)
             break;
         }
 
-        if (video_card_available(c) && device_is_valid(video_dev, machineId)) {
+        if (Availability::device(video_dev) && device_is_valid(video_dev, machineId)) {
             int row = Models::AddEntry(model, name, c);
             if (c == curVideoCard) {
                 selectedRow = row - removeRows;
@@ -173,7 +174,7 @@ SettingsDisplay::on_comboBoxVideo_currentIndexChanged(int index)
     bool videoCardHasXga  = ((videoCard[0] == VID_INTERNAL) ? machine_has_flags(machineId, MACHINE_VIDEO_XGA) : (video_card_get_flags(videoCard[0]) == VIDEO_FLAG_TYPE_XGA));
 
     bool machineSupports8514 = ((machineHasIsa16 || machineHasMca) && !videoCardHas8514);
-    bool machineSupportsXga  = (((machineHasIsa16 && device_available(&xga_isa_device)) || (machineHasMca && device_available(&xga_device))) && !videoCardHasXga);
+    bool machineSupportsXga  = (((machineHasIsa16 && Availability::device(&xga_isa_device)) || (machineHasMca && Availability::device(&xga_device))) && !videoCardHasXga);
 
     ui->checkBox8514->setEnabled(machineSupports8514);
     ui->checkBox8514->setChecked(ibm8514_standalone_enabled && machineSupports8514);
@@ -205,7 +206,7 @@ SettingsDisplay::on_comboBoxVideo_currentIndexChanged(int index)
 
         int primaryFlags   = video_card_get_flags(videoCard[0]);
         int secondaryFlags = video_card_get_flags(c);
-        if (video_card_available(c)
+        if (Availability::device(video_dev)
             && device_is_valid(video_dev, machineId)
             && !((secondaryFlags == primaryFlags) && (secondaryFlags != VIDEO_FLAG_TYPE_SPECIAL))
             && !(((primaryFlags == VIDEO_FLAG_TYPE_8514) || (primaryFlags == VIDEO_FLAG_TYPE_XGA)) && (secondaryFlags != VIDEO_FLAG_TYPE_MDA) && (secondaryFlags != VIDEO_FLAG_TYPE_SPECIAL))
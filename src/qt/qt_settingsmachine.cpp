@@ -39,6 +39,7 @@ extern "C" {
 #define TIME_SYNC_ENABLED  1
 #define TIME_SYNC_UTC      2
 
+#include "qt_availability.hpp"
 #include "qt_deviceconfig.hpp"
 #include "qt_models_common.hpp"
 
@@ -97,7 +98,7 @@ SettingsMachine::SettingsMachine(QWidget *parent)
     for (int i = 1; i < MACHINE_TYPE_MAX; ++i) {
         int j = 0;
         while (machine_get_internal_name_ex(j) != nullptr) {
-            if (machine_available(j) && (machine_get_type(j) == i)) {
+            if (Availability::machine(j) && (machine_get_type(j) == i)) {
                 int row = Models::AddEntry(machineTypesModel, machine_types[i].name, machine_types[i].id);
                 if (machine_types[i].id == machine_get_type(machine))
                     selectedMachineType = row;
@@ -168,7 +169,7 @@ SettingsMachine::on_comboBoxMachineType_currentIndexChanged(int index)
         int selectedMachineRow = 0;
         for (int i = 0; i < machine_count(); ++i) {
             if ((machine_get_type(i) == ui->comboBoxMachineType->currentData().toInt()) &&
-                machine_available(i)) {
+                Availability::machine(i)) {
                 int row = Models::AddEntry(model, machines[i].name, i);
                 if (i == machine)
                     selectedMachineRow = row - removeRows;
@@ -26,6 +26,7 @@ extern "C" {
 #include <86box/network.h>
 }
 
+#include "qt_availability.hpp"
 #include "qt_models_common.hpp"
 #include "qt_deviceconfig.hpp"
 
@@ -43,6 +44,8 @@ SettingsNetwork::enableElements(Ui::SettingsNetwork *ui)
         bool adaptersEnabled =  netType == NET_TYPE_NONE
                             ||  netType == NET_TYPE_SLIRP
                             ||  netType == NET_TYPE_VDE
+                            ||  netType == NET_TYPE_TAP
+                            ||  netType == NET_TYPE_VSWITCH
                             || (netType == NET_TYPE_PCAP && intf_cbox->currentData().toInt() > 0);
 
         intf_cbox->setEnabled(net_type_cbox->currentData().toInt() == NET_TYPE_PCAP);
@@ -53,7 +56,7 @@ SettingsNetwork::enableElements(Ui::SettingsNetwork *ui)
                                  device_has_config(machine_get_net_device(machineId)));
         else
             conf_btn->setEnabled(adaptersEnabled && network_card_has_config(nic_cbox->currentData().toInt()));
-        socket_line->setEnabled(net_type_cbox->currentData().toInt() == NET_TYPE_VDE);
+        socket_line->setEnabled((netType == NET_TYPE_VDE) || (netType == NET_TYPE_TAP) || (netType == NET_TYPE_VSWITCH));
     }
 }
 
@@ -93,7 +96,7 @@ SettingsNetwork::save()
         memset(net_cards_conf[i].host_dev_name, '\0', sizeof(net_cards_conf[i].host_dev_name));
         if (net_cards_conf[i].net_type == NET_TYPE_PCAP) {
             strncpy(net_cards_conf[i].host_dev_name, network_devs[cbox->currentData().toInt()].device, sizeof(net_cards_conf[i].host_dev_name) - 1);
-        } else if (net_cards_conf[i].net_type == NET_TYPE_VDE) {
+        } else if ((net_cards_conf[i].net_type == NET_TYPE_VDE) || (net_cards_conf[i].net_type == NET_TYPE_TAP) || (net_cards_conf[i].net_type == NET_TYPE_VSWITCH)) {
             strncpy(net_cards_conf[i].host_dev_name, socket_line->text().toUtf8().constData(), sizeof(net_cards_conf[i].host_dev_name));
         }
     }
@@ -126,7 +129,7 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
                 break;
             }
 
-            if (network_card_available(c) && device_is_valid(network_card_getdevice(c), machineId)) {
+            if (Availability::device(network_card_getdevice(c)) && device_is_valid(network_card_getdevice(c), machineId)) {
                 int row = Models::AddEntry(model, name, c);
                 if (c == net_cards_conf[i].device_num) {
                     selectedRow = row - removeRows;
@@ -152,9 +155,15 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
         if (network_devmap.has_vde) {
             Models::AddEntry(model, "VDE", NET_TYPE_VDE);
         }
+        if (network_devmap.has_tap) {
+            Models::AddEntry(model, "TAP", NET_TYPE_TAP);
+        }
+        if (network_devmap.has_vswitch) {
+            Models::AddEntry(model, tr("Virtual switch"), NET_TYPE_VSWITCH);
+        }
         
         model->removeRows(0, removeRows);
-        cbox->setCurrentIndex(net_cards_conf[i].net_type);
+        cbox->setCurrentIndex(cbox->findData(net_cards_conf[i].net_type));
 
         selectedRow = 0;
 
@@ -172,7 +181,7 @@ SettingsNetwork::onCurrentMachineChanged(int machineId)
             model->removeRows(0, removeRows);
             cbox->setCurrentIndex(selectedRow);
         }  
-        if (net_cards_conf[i].net_type == NET_TYPE_VDE) {
+        if ((net_cards_conf[i].net_type == NET_TYPE_VDE) || (net_cards_conf[i].net_type == NET_TYPE_TAP) || (net_cards_conf[i].net_type == NET_TYPE_VSWITCH)) {
             QString currentVdeSocket = net_cards_conf[i].host_dev_name;
             auto editline = findChild<QLineEdit *>(QString("socketVDENIC%1").arg(i+1));
             editline->setText(currentVdeSocket);
@@ -30,6 +30,7 @@ extern "C" {
 #include <86box/snd_opl.h>
 }
 
+#include "qt_availability.hpp"
 #include "qt_deviceconfig.hpp"
 #include "qt_models_common.hpp"
 
@@ -93,7 +94,7 @@ SettingsSound::onCurrentMachineChanged(const int machineId)
                 break;
             }
 
-            if (sound_card_available(c) && device_is_valid(sound_card_getdevice(c), machineId)) {
+            if (Availability::device(sound_card_getdevice(c)) && device_is_valid(sound_card_getdevice(c), machineId)) {
                 int row = Models::AddEntry(model, name, c);
                 if (c == sound_card_current[i]) {
                     selectedRow = row - removeRows;
@@ -82,6 +82,14 @@ ui_hard_reset_completed()
     emit main_window->hardResetCompleted();
 }
 
+void
+ui_trace_state_changed()
+{
+    /* Tracing may be started from the command line before the window exists. */
+    if (main_window)
+        emit main_window->traceStateChanged();
+}
+
 extern "C" void
 qt_blit(int x, int y, int w, int h, int monitor_index)
 {
@@ -30,16 +30,46 @@
 #include <86box/86box.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <minitrace/minitrace.h>
 
 typedef struct {
     HANDLE handle;
 } win_event_t;
 
-/* For compatibility with thread.h, but Win32 does not allow named threads. */
+#ifdef MTR_ENABLED
+typedef struct {
+    void      (*func)(void *param);
+    void       *param;
+    const char *name;
+} win_thread_param_t;
+
+static void
+thread_run_wrapper(void *arg)
+{
+    win_thread_param_t local = *(win_thread_param_t *) arg;
+
+    free(arg);
+    mtr_register_thread_name(local.name);
+    local.func(local.param);
+}
+#endif
+
+/* For compatibility with thread.h, but Win32 does not allow named threads.
+   The name is only used for the trace timeline. */
 thread_t *
 thread_create_named(void (*func)(void *param), void *param, UNUSED(const char *name))
 {
+#ifdef MTR_ENABLED
+    win_thread_param_t *p = malloc(sizeof(win_thread_param_t));
+
+    p->func  = func;
+    p->param = param;
+    p->name  = name;
+
+    uintptr_t bt = _beginthread(thread_run_wrapper, 0, p);
+#else
     uintptr_t bt = _beginthread(func, 0, param);
+#endif
     return ((thread_t *) bt);
 }
 
@@ -310,6 +310,10 @@ typedef struct ncr53c8xx_t {
 
     uint8_t sstop;
 
+    /* Host mapping of the page the SCRIPTS are currently fetched from. */
+    uint32_t       script_page;
+    const uint8_t *script_ptr;
+
     uint8_t  regop;
     uint32_t adder;
 
@@ -457,6 +461,46 @@ ncr53c8xx_soft_reset(ncr53c8xx_t *dev)
     }
 }
 
+/* Bus master transfers, a page at a time, copied directly when the page is
+   plain memory and through the DMA bus master routines otherwise. */
+static void
+ncr53c8xx_dma_read(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    const uint8_t *p;
+    uint32_t       n;
+
+    while (len) {
+        n = MIN(len, MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK));
+        p = mem_get_phys_ptr(addr, n, 0);
+        if (p)
+            memcpy(buf, p, n);
+        else
+            dma_bm_read(addr, buf, n, 4);
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+static void
+ncr53c8xx_dma_write(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    uint8_t *p;
+    uint32_t n;
+
+    while (len) {
+        n = MIN(len, MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK));
+        p = mem_get_phys_ptr(addr, n, 1);
+        if (p)
+            memcpy(p, buf, n);
+        else
+            dma_bm_write(addr, buf, n, 4);
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+}
+
 static void
 ncr53c8xx_read(ncr53c8xx_t *dev, uint32_t addr, uint8_t *buf, uint32_t len)
 {
@@ -468,7 +512,7 @@ ncr53c8xx_read(ncr53c8xx_t *dev, uint32_t addr, uint8_t *buf, uint32_t len)
             buf[i] = inb((uint16_t) (addr + i));
     } else {
         ncr53c8xx_log("NCR 810: Reading from memory address %08X\n", addr);
-        dma_bm_read(addr, buf, len, 4);
+        ncr53c8xx_dma_read(addr, buf, len);
     }
 }
 
@@ -483,7 +527,7 @@ ncr53c8xx_write(ncr53c8xx_t *dev, uint32_t addr, uint8_t *buf, uint32_t len)
             outb((uint16_t) (addr + i), buf[i]);
     } else {
         ncr53c8xx_log("NCR 810: Writing to memory address %08X\n", addr);
-        dma_bm_write(addr, buf, len, 4);
+        ncr53c8xx_dma_write(addr, buf, len);
     }
 }
 
@@ -496,6 +540,29 @@ read_dword(UNUSED(ncr53c8xx_t *dev), uint32_t addr)
     return buf;
 }
 
+/* Fetch a SCRIPTS dword. The host pointer of the current page is looked up
+   only when execution moves to another page, and the memory itself is read
+   on every fetch, so guest and SCRIPTS writes to the code are always seen. */
+static __inline uint32_t
+ncr53c8xx_fetch(ncr53c8xx_t *dev, uint32_t addr)
+{
+    uint32_t ret;
+
+    if ((addr & MEM_GRANULARITY_MASK) > MEM_GRANULARITY_QBOUND)
+        return read_dword(dev, addr);
+
+    if ((addr & ~MEM_GRANULARITY_MASK) != dev->script_page) {
+        dev->script_page = addr & ~MEM_GRANULARITY_MASK;
+        dev->script_ptr  = mem_get_phys_ptr(dev->script_page, MEM_GRANULARITY_SIZE, 0);
+    }
+
+    if (dev->script_ptr == NULL)
+        return read_dword(dev, addr);
+
+    memcpy(&ret, &dev->script_ptr[addr & MEM_GRANULARITY_MASK], 4);
+    return ret;
+}
+
 static void
 do_irq(ncr53c8xx_t *dev, int level)
 {
@@ -1033,9 +1100,11 @@ ncr53c8xx_process_script(ncr53c8xx_t *dev)
     uint8_t  data[7];
 
     dev->sstop = 0;
+    /* The memory map may have changed since the last run. */
+    dev->script_page = 0xffffffff;
 again:
     insn_processed++;
-    insn = read_dword(dev, dev->dsp);
+    insn = ncr53c8xx_fetch(dev, dev->dsp);
     if (!insn) {
         /* If we receive an empty opcode increment the DSP by 4 bytes
            instead of 8 and execute the next opcode at that location */
@@ -1047,7 +1116,7 @@ again:
             return;
         }
     }
-    addr = read_dword(dev, dev->dsp + 4);
+    addr = ncr53c8xx_fetch(dev, dev->dsp + 4);
     ncr53c8xx_log("SCRIPTS dsp=%08x opcode %08x arg %08x\n", dev->dsp, insn, addr);
     dev->dsps = addr;
     dev->dcmd = insn >> 24;
@@ -1362,7 +1431,7 @@ again:
                 /* ??? The docs imply the destination address is loaded into
                    the TEMP register.  However the Linux drivers rely on
                    the value being presrved.  */
-                dest = read_dword(dev, dev->dsp);
+                dest = ncr53c8xx_fetch(dev, dev->dsp);
                 dev->dsp += 4;
                 ncr53c8xx_memcpy(dev, dest, addr, insn & 0xffffff);
             } else {
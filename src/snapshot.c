@@ -0,0 +1,1134 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine state snapshot facility.
+ *
+ *          A snapshot is a gzip compressed stream made of a header
+ *          identifying the build and the machine configuration, followed
+ *          by sections. The core sections (CPU, memory, PIC, DMA, PPI,
+ *          PC speaker, parallel ports) come first, in a fixed order, then
+ *          one section per device. Each section is a sequence of
+ *          length-prefixed chunks terminated by an empty chunk, so it can
+ *          be written and read in a single pass without knowing its size
+ *          in advance. Machines with a device that has no state handlers,
+ *          or with anything attached to a parallel port, cannot be saved
+ *          or restored.
+ *
+ *          This currently covers the IBM PC/AT class: the IBM AT and the
+ *          other machines built only from the generic AT devices (PIT,
+ *          AT NVR, port 61h, AT keyboard controller and keyboard, AT
+ *          floppy controller, serial ports), with a VGA card, IDE disks
+ *          or none, and no sound, network, mouse or other expansion
+ *          cards. Everything else is refused up front, naming the first
+ *          device in the way. A snapshot cannot be taken while the floppy
+ *          controller executes a command. snapshot_check() saves,
+ *          restores and saves again, then compares the two snapshots, to
+ *          find state that does not survive the round trip.
+ *
+ *          Guest RAM is not part of the compressed stream, it is written
+ *          uncompressed to a companion file (the snapshot name with .ram
+ *          appended) at page-aligned offsets, with all-zero pages left as
+ *          holes. On hosts with mmap, it is mapped privately (copy-on-write)
+ *          straight into the guest RAM block when loading, so pages are
+ *          only read in when the guest touches them and identical machines
+ *          resumed from the same snapshot share the clean pages through
+ *          the host page cache. Both files are written under temporary
+ *          names and renamed in place, so that a machine which is still
+ *          mapping an older copy is not affected by a new save, and both
+ *          carry the same random identifier, so that a RAM image left over
+ *          from another save is refused instead of being loaded.
+ *
+ *          Snapshots are only valid for the build and the configuration
+ *          they were made with, and do not include the contents of disk
+ *          images, which must be in the state they were in when the
+ *          snapshot was saved.
+ *
+ *
+ *
+ * Authors: 86Box contributors.
+ *
+ *          Copyright 2026 86Box contributors.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#ifndef _WIN32
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+#include <zlib.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/timer.h>
+#include <86box/device.h>
+#include <86box/machine.h>
+#include <86box/mem.h>
+#include <86box/pic.h>
+#include <86box/dma.h>
+#include <86box/ppi.h>
+#include <86box/snd_speaker.h>
+#include <86box/lpt.h>
+#include <86box/plat.h>
+#include <86box/random.h>
+#include <86box/thread.h>
+#include <86box/ui.h>
+#include <86box/version.h>
+#include <86box/snapshot.h>
+
+#define SNAPSHOT_MAGIC     "86BXSNAP"
+#define SNAPSHOT_RAM_MAGIC "86BXSRAM"
+#define SNAPSHOT_ID_LEN    16
+#define SNAPSHOT_CHUNK_LEN 65536
+/* Alignment of the RAM blocks in the companion file, a multiple of any host page size. */
+#define SNAPSHOT_RAM_ALIGN 65536
+#define SNAPSHOT_RAM_PAGE  4096
+
+#ifdef _WIN32
+#    define snapshot_fseek _fseeki64
+#else
+#    define snapshot_fseek fseeko
+#endif
+
+struct snapshot_t {
+    gzFile   fp;
+    int      writing;
+    int      error;
+    int      in_section;
+    int      section_end;
+    uint8_t *buf;
+    uint32_t buf_len;
+    uint32_t buf_pos;
+    char     section[256];
+    char     message[512];
+    char     fn[1024];
+    char     tmp_fn[1040];
+
+    /* Random identifier shared by the stream and its RAM image. */
+    uint8_t  id[SNAPSHOT_ID_LEN];
+
+    /* Companion RAM file. */
+    FILE    *ram_fp;
+    uint64_t ram_pos;
+    char     ram_fn[1024];
+    char     ram_tmp_fn[1040];
+};
+
+typedef struct snapshot_section_t {
+    const char *name;
+    void (*save)(snapshot_t *s);
+    void (*load)(snapshot_t *s);
+} snapshot_section_t;
+
+static const snapshot_section_t core_sections[] = {
+    { "core.cpu",     cpu_save_state,     cpu_load_state     },
+    { "core.mem",     mem_save_state,     mem_load_state     },
+    { "core.pic",     pic_save_state,     pic_load_state     },
+    { "core.dma",     dma_save_state,     dma_load_state     },
+    { "core.ppi",     ppi_save_state,     ppi_load_state     },
+    { "core.speaker", speaker_save_state, speaker_load_state },
+    { "core.lpt",     lpt_save_state,     lpt_load_state     },
+    { NULL,           NULL,               NULL               }
+};
+
+enum {
+    SNAPSHOT_OP_SAVE = 0,
+    SNAPSHOT_OP_LOAD,
+    SNAPSHOT_OP_CHECK
+};
+
+static mutex_t *snapshot_mutex;
+static char     snapshot_request_fn[1024];
+static int      snapshot_request_op;
+static volatile int snapshot_request_pending;
+static char     snapshot_message[512]; /* reason for the last failure */
+
+#ifdef ENABLE_SNAPSHOT_LOG
+int snapshot_do_log = ENABLE_SNAPSHOT_LOG;
+
+static void
+snapshot_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (snapshot_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define snapshot_log(fmt, ...)
+#endif
+
+void
+snapshot_set_error(snapshot_t *s, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (s->error)
+        return;
+
+    s->error = 1;
+
+    va_start(ap, fmt);
+    vsnprintf(s->message, sizeof(s->message), fmt, ap);
+    va_end(ap);
+
+    snapshot_log("SNAPSHOT: Error in section \"%s\": %s\n", s->section, s->message);
+}
+
+int
+snapshot_error(snapshot_t *s)
+{
+    return s->error;
+}
+
+static void
+snapshot_raw_write(snapshot_t *s, const void *data, uint32_t len)
+{
+    if (s->error || !len)
+        return;
+
+    if (gzwrite(s->fp, data, len) != (int) len)
+        snapshot_set_error(s, "Write error");
+}
+
+static void
+snapshot_raw_read(snapshot_t *s, void *data, uint32_t len)
+{
+    if (s->error) {
+        memset(data, 0x00, len);
+        return;
+    }
+
+    if (gzread(s->fp, data, len) != (int) len) {
+        snapshot_set_error(s, "Unexpected end of file");
+        memset(data, 0x00, len);
+    }
+}
+
+static void
+snapshot_raw_write_u32(snapshot_t *s, uint32_t val)
+{
+    snapshot_raw_write(s, &val, sizeof(val));
+}
+
+static uint32_t
+snapshot_raw_read_u32(snapshot_t *s)
+{
+    uint32_t val;
+
+    snapshot_raw_read(s, &val, sizeof(val));
+
+    return val;
+}
+
+static void
+snapshot_raw_write_string(snapshot_t *s, const char *str)
+{
+    uint16_t len = (uint16_t) strlen(str);
+
+    snapshot_raw_write(s, &len, sizeof(len));
+    snapshot_raw_write(s, str, len);
+}
+
+static void
+snapshot_raw_read_string(snapshot_t *s, char *str, int size)
+{
+    uint16_t len = 0;
+
+    snapshot_raw_read(s, &len, sizeof(len));
+    if (len >= size) {
+        snapshot_set_error(s, "Malformed string");
+        len = 0;
+    }
+
+    snapshot_raw_read(s, str, len);
+    str[len] = '\0';
+}
+
+/* Writes out the pending chunk, if any. */
+static void
+snapshot_flush_chunk(snapshot_t *s)
+{
+    if (s->buf_pos == 0)
+        return;
+
+    snapshot_raw_write_u32(s, s->buf_pos);
+    snapshot_raw_write(s, s->buf, s->buf_pos);
+    s->buf_pos = 0;
+}
+
+void
+snapshot_write(snapshot_t *s, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t       n;
+
+    if (s->error || !s->writing || !s->in_section)
+        return;
+
+    if (len >= SNAPSHOT_CHUNK_LEN) {
+        /* Large blocks (such as RAM) bypass the chunk buffer. */
+        snapshot_flush_chunk(s);
+        while (len > 0) {
+            n = (len > 0x40000000) ? 0x40000000 : (uint32_t) len;
+            snapshot_raw_write_u32(s, n);
+            snapshot_raw_write(s, p, n);
+            p += n;
+            len -= n;
+        }
+        return;
+    }
+
+    while (len > 0) {
+        n = SNAPSHOT_CHUNK_LEN - s->buf_pos;
+        if (n > len)
+            n = (uint32_t) len;
+        memcpy(&s->buf[s->buf_pos], p, n);
+        s->buf_pos += n;
+        p += n;
+        len -= n;
+
+        if (s->buf_pos == SNAPSHOT_CHUNK_LEN)
+            snapshot_flush_chunk(s);
+    }
+}
+
+/* Makes the next chunk of the current section available in the buffer. */
+static int
+snapshot_next_chunk(snapshot_t *s)
+{
+    uint32_t len;
+
+    if (s->section_end)
+        return 0;
+
+    len = snapshot_raw_read_u32(s);
+    if (s->error)
+        return 0;
+
+    if (len == 0) {
+        s->section_end = 1;
+        return 0;
+    }
+
+    if (len > s->buf_len) {
+        s->buf = (uint8_t *) realloc(s->buf, len);
+        if (s->buf == NULL) {
+            s->buf_len = 0;
+            snapshot_set_error(s, "Out of memory");
+            return 0;
+        }
+        s->buf_len = len;
+    }
+
+    snapshot_raw_read(s, s->buf, len);
+    s->buf_pos = 0;
+    s->buf_len = len;
+
+    return !s->error;
+}
+
+void
+snapshot_read(snapshot_t *s, void *data, size_t len)
+{
+    uint8_t *p = (uint8_t *) data;
+    uint32_t n;
+
+    if (s->error || s->writing || !s->in_section) {
+        memset(data, 0x00, len);
+        return;
+    }
+
+    while (len > 0) {
+        if (s->buf_pos == s->buf_len) {
+            /* Large reads that line up with a chunk go straight to the destination. */
+            if (!s->section_end && (len >= SNAPSHOT_CHUNK_LEN)) {
+                n = snapshot_raw_read_u32(s);
+                if (n == 0)
+                    s->section_end = 1;
+                else if (n <= len) {
+                    snapshot_raw_read(s, p, n);
+                    p += n;
+                    len -= n;
+                    continue;
+                } else {
+                    /* Chunk is larger than what is being read, buffer it. */
+                    if (n > s->buf_len) {
+                        uint8_t *buf = (uint8_t *) realloc(s->buf, n);
+                        if (buf == NULL) {
+                            snapshot_set_error(s, "Out of memory");
+                            break;
+                        }
+                        s->buf = buf;
+                    }
+                    snapshot_raw_read(s, s->buf, n);
+                    s->buf_pos = 0;
+                    s->buf_len = n;
+                }
+            } else if (!snapshot_next_chunk(s)) {
+                snapshot_set_error(s, "Section is shorter than expected");
+                break;
+            }
+
+            if (s->error || s->section_end) {
+                snapshot_set_error(s, "Section is shorter than expected");
+                break;
+            }
+        }
+
+        n = s->buf_len - s->buf_pos;
+        if (n > len)
+            n = (uint32_t) len;
+        memcpy(p, &s->buf[s->buf_pos], n);
+        s->buf_pos += n;
+        p += n;
+        len -= n;
+    }
+
+    if (len > 0)
+        memset(p, 0x00, len);
+}
+
+void
+snapshot_write_u8(snapshot_t *s, uint8_t val)
+{
+    snapshot_write(s, &val, sizeof(val));
+}
+
+void
+snapshot_write_u16(snapshot_t *s, uint16_t val)
+{
+    snapshot_write(s, &val, sizeof(val));
+}
+
+void
+snapshot_write_u32(snapshot_t *s, uint32_t val)
+{
+    snapshot_write(s, &val, sizeof(val));
+}
+
+void
+snapshot_write_u64(snapshot_t *s, uint64_t val)
+{
+    snapshot_write(s, &val, sizeof(val));
+}
+
+uint8_t
+snapshot_read_u8(snapshot_t *s)
+{
+    uint8_t val;
+
+    snapshot_read(s, &val, sizeof(val));
+
+    return val;
+}
+
+uint16_t
+snapshot_read_u16(snapshot_t *s)
+{
+    uint16_t val;
+
+    snapshot_read(s, &val, sizeof(val));
+
+    return val;
+}
+
+uint32_t
+snapshot_read_u32(snapshot_t *s)
+{
+    uint32_t val;
+
+    snapshot_read(s, &val, sizeof(val));
+
+    return val;
+}
+
+uint64_t
+snapshot_read_u64(snapshot_t *s)
+{
+    uint64_t val;
+
+    snapshot_read(s, &val, sizeof(val));
+
+    return val;
+}
+
+/* Timers are stored relative to the TSC, so they survive the TSC being changed
+   by the CPU section. */
+void
+snapshot_write_timer(snapshot_t *s, pc_timer_t *timer)
+{
+    snapshot_write_u32(s, timer->flags & (TIMER_ENABLED | TIMER_SPLIT));
+    snapshot_write_u64(s, timer->ts.ts64 - (tsc << 32));
+    snapshot_write(s, &timer->period, sizeof(timer->period));
+}
+
+void
+snapshot_read_timer(snapshot_t *s, pc_timer_t *timer)
+{
+    uint32_t flags = snapshot_read_u32(s);
+    uint64_t delta = snapshot_read_u64(s);
+    double   period;
+
+    snapshot_read(s, &period, sizeof(period));
+    if (s->error)
+        return;
+
+    timer_disable(timer);
+    timer->ts.ts64     = (tsc << 32) + delta;
+    timer->period      = period;
+    timer->in_callback = 0;
+    timer->flags       = (timer->flags & ~TIMER_SPLIT) | (flags & TIMER_SPLIT);
+    if (flags & TIMER_ENABLED)
+        timer_enable(timer);
+}
+
+/* The RAM image starts with the identifier of the snapshot it belongs to,
+   in a block of its own so that the RAM blocks stay aligned. */
+static FILE *
+snapshot_ram_file(snapshot_t *s)
+{
+    uint8_t magic[8];
+    uint8_t id[SNAPSHOT_ID_LEN];
+
+    if ((s->ram_fp != NULL) || s->error)
+        return s->ram_fp;
+
+    s->ram_fp = plat_fopen64(s->writing ? s->ram_tmp_fn : s->ram_fn, s->writing ? "wb" : "rb");
+    if (s->ram_fp == NULL) {
+        snapshot_set_error(s, "Unable to open the RAM image \"%s\"", s->ram_fn);
+        return NULL;
+    }
+
+    if (s->writing) {
+        if ((fwrite(SNAPSHOT_RAM_MAGIC, 1, 8, s->ram_fp) != 8) ||
+            (fwrite(s->id, 1, SNAPSHOT_ID_LEN, s->ram_fp) != SNAPSHOT_ID_LEN))
+            snapshot_set_error(s, "RAM image write error");
+    } else {
+        if ((fread(magic, 1, 8, s->ram_fp) != 8) || memcmp(magic, SNAPSHOT_RAM_MAGIC, 8) ||
+            (fread(id, 1, SNAPSHOT_ID_LEN, s->ram_fp) != SNAPSHOT_ID_LEN) ||
+            memcmp(id, s->id, SNAPSHOT_ID_LEN))
+            snapshot_set_error(s, "The RAM image \"%s\" does not belong to this snapshot", s->ram_fn);
+    }
+
+    return s->ram_fp;
+}
+
+static int
+snapshot_page_is_zero(const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len; i += sizeof(uint64_t)) {
+        if (*(const uint64_t *) &p[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+/* Writes a block of guest RAM to the companion file; only its location goes
+   into the stream. */
+void
+snapshot_write_ram(snapshot_t *s, const uint8_t *data, size_t len)
+{
+    FILE  *fp = snapshot_ram_file(s);
+    size_t n;
+    int    hole = 0;
+
+    snapshot_write_u64(s, s->ram_pos);
+    snapshot_write_u64(s, len);
+    if ((fp == NULL) || !len)
+        return;
+
+    if (snapshot_fseek(fp, s->ram_pos, SEEK_SET) != 0) {
+        snapshot_set_error(s, "RAM image write error");
+        return;
+    }
+
+    for (size_t i = 0; (i < len) && !s->error; i += n) {
+        n = ((len - i) > SNAPSHOT_RAM_PAGE) ? SNAPSHOT_RAM_PAGE : (len - i);
+
+        if ((n == SNAPSHOT_RAM_PAGE) && snapshot_page_is_zero(&data[i], n)) {
+            /* Leave a hole, the file system fills it with zeroes. */
+            hole = 1;
+            if (snapshot_fseek(fp, n, SEEK_CUR) != 0)
+                snapshot_set_error(s, "RAM image write error");
+        } else {
+            hole = 0;
+            if (fwrite(&data[i], 1, n, fp) != n)
+                snapshot_set_error(s, "RAM image write error");
+        }
+    }
+
+    /* Make sure a trailing hole still extends the file. */
+    if (hole && !s->error) {
+        if ((snapshot_fseek(fp, -1, SEEK_CUR) != 0) || (fputc(0x00, fp) == EOF))
+            snapshot_set_error(s, "RAM image write error");
+    }
+
+    s->ram_pos = (s->ram_pos + len + SNAPSHOT_RAM_ALIGN - 1) & ~((uint64_t) SNAPSHOT_RAM_ALIGN - 1);
+}
+
+/* Restores a block of guest RAM from the companion file, mapping it when the
+   host and the block allow it and reading it otherwise. */
+void
+snapshot_read_ram(snapshot_t *s, uint8_t *data, size_t len)
+{
+    uint64_t pos = snapshot_read_u64(s);
+    uint64_t size = snapshot_read_u64(s);
+    FILE    *fp;
+    size_t   mapped = 0;
+
+    if (!s->error && (size != len))
+        snapshot_set_error(s, "RAM block size mismatch");
+    if (s->error || !len)
+        return;
+
+    fp = snapshot_ram_file(s);
+    if (fp == NULL)
+        return;
+
+#ifndef _WIN32
+    {
+        size_t page = (size_t) sysconf(_SC_PAGESIZE);
+
+        if (!((uintptr_t) data & (page - 1)) && !(pos & (page - 1))) {
+            mapped = len & ~(page - 1);
+            if (mapped && (mmap(data, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                                fileno(fp), (off_t) pos) == MAP_FAILED)) {
+                snapshot_log("SNAPSHOT: Unable to map the RAM image, reading it instead\n");
+                mapped = 0;
+            }
+        }
+    }
+#endif
+
+    if (mapped < len) {
+        if ((snapshot_fseek(fp, pos + mapped, SEEK_SET) != 0) ||
+            (fread(&data[mapped], 1, len - mapped, fp) != (len - mapped)))
+            snapshot_set_error(s, "RAM image read error");
+    }
+
+    snapshot_log("SNAPSHOT: RAM block at %016" PRIX64 ": %zu bytes mapped, %zu bytes read\n",
+                 pos, mapped, len - mapped);
+}
+
+void
+snapshot_section_begin(snapshot_t *s, const char *name, uint32_t instance)
+{
+    snprintf(s->section, sizeof(s->section), "%s", name);
+
+    snapshot_raw_write_string(s, name);
+    snapshot_raw_write_u32(s, instance);
+
+    s->in_section = 1;
+    s->buf_pos    = 0;
+}
+
+void
+snapshot_section_end(snapshot_t *s)
+{
+    if (s->writing) {
+        snapshot_flush_chunk(s);
+        snapshot_raw_write_u32(s, 0);
+    } else {
+        if (s->buf_pos != s->buf_len)
+            snapshot_log("SNAPSHOT: Section \"%s\" not fully read\n", s->section);
+
+        /* Skip whatever the handler did not consume. */
+        while (!s->error && snapshot_next_chunk(s))
+            ;
+    }
+
+    s->in_section = 0;
+}
+
+/* Reads the next section header; returns NULL at the end of the snapshot. */
+const char *
+snapshot_section_next(snapshot_t *s, uint32_t *instance)
+{
+    snapshot_raw_read_string(s, s->section, sizeof(s->section));
+    if (s->error || (s->section[0] == '\0'))
+        return NULL;
+
+    *instance = snapshot_raw_read_u32(s);
+
+    s->in_section  = 1;
+    s->section_end = 0;
+    s->buf_pos     = 0;
+    s->buf_len     = 0;
+
+    return s->error ? NULL : s->section;
+}
+
+static snapshot_t *
+snapshot_open(const char *fn, int writing)
+{
+    snapshot_t *s = (snapshot_t *) calloc(1, sizeof(snapshot_t));
+
+    snprintf(s->fn, sizeof(s->fn), "%s", fn);
+    snprintf(s->tmp_fn, sizeof(s->tmp_fn), "%s.tmp", fn);
+    snprintf(s->ram_fn, sizeof(s->ram_fn), "%s.ram", fn);
+    snprintf(s->ram_tmp_fn, sizeof(s->ram_tmp_fn), "%s.tmp", s->ram_fn);
+
+    /* Both files are written under temporary names, see snapshot_close(). */
+    s->fp = gzopen(writing ? s->tmp_fn : fn, writing ? "wb6" : "rb");
+    if (s->fp == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    s->writing = writing;
+    if (writing) {
+        s->buf     = (uint8_t *) malloc(SNAPSHOT_CHUNK_LEN);
+        s->buf_len = SNAPSHOT_CHUNK_LEN;
+        s->ram_pos = SNAPSHOT_RAM_ALIGN;
+
+        for (int i = 0; i < SNAPSHOT_ID_LEN; i++)
+            s->id[i] = random_generate();
+    }
+
+    return s;
+}
+
+static int
+snapshot_replace(const char *tmp_fn, const char *fn)
+{
+#ifdef _WIN32
+    remove(fn);
+#endif
+    return rename(tmp_fn, fn);
+}
+
+/* When writing, the old files are only replaced once both new ones are
+   complete. The RAM image goes first: should the stream fail to follow,
+   the identifiers no longer match and loading the pair is refused. */
+static int
+snapshot_close(snapshot_t *s)
+{
+    int ret = s->error ? -1 : 0;
+
+    if (gzclose(s->fp) != Z_OK)
+        ret = -1;
+
+    if ((s->ram_fp != NULL) && (fclose(s->ram_fp) != 0))
+        ret = -1;
+
+    if (s->writing) {
+        if ((ret == 0) && (s->ram_fp != NULL) && (snapshot_replace(s->ram_tmp_fn, s->ram_fn) != 0))
+            ret = -1;
+        if ((ret == 0) && (snapshot_replace(s->tmp_fn, s->fn) != 0))
+            ret = -1;
+
+        if (ret != 0) {
+            remove(s->tmp_fn);
+            if (s->ram_fp != NULL)
+                remove(s->ram_tmp_fn);
+        }
+    }
+
+    free(s->buf);
+    free(s);
+
+    return ret;
+}
+
+static void
+snapshot_write_header(snapshot_t *s)
+{
+    snapshot_raw_write(s, SNAPSHOT_MAGIC, 8);
+    snapshot_raw_write_u32(s, SNAPSHOT_VERSION);
+    snapshot_raw_write_u32(s, sizeof(void *));
+    snapshot_raw_write_string(s, EMU_VERSION_FULL);
+    snapshot_raw_write_string(s, machine_get_internal_name());
+    snapshot_raw_write_string(s, cpu_f->internal_name);
+    snapshot_raw_write_u32(s, cpu);
+    snapshot_raw_write_u32(s, mem_size);
+    snapshot_raw_write(s, s->id, SNAPSHOT_ID_LEN);
+}
+
+static void
+snapshot_check_header(snapshot_t *s)
+{
+    char     magic[8];
+    char     str[256];
+    uint32_t val;
+
+    snapshot_raw_read(s, magic, 8);
+    if (s->error || memcmp(magic, SNAPSHOT_MAGIC, 8)) {
+        snapshot_set_error(s, "Not a snapshot file");
+        return;
+    }
+
+    val = snapshot_raw_read_u32(s);
+    if (val != SNAPSHOT_VERSION) {
+        snapshot_set_error(s, "Unsupported snapshot version %i", val);
+        return;
+    }
+
+    val = snapshot_raw_read_u32(s);
+    snapshot_raw_read_string(s, str, sizeof(str));
+    if ((val != sizeof(void *)) || strcmp(str, EMU_VERSION_FULL)) {
+        snapshot_set_error(s, "Snapshot was made by a different build (%s)", str);
+        return;
+    }
+
+    snapshot_raw_read_string(s, str, sizeof(str));
+    if (strcmp(str, machine_get_internal_name())) {
+        snapshot_set_error(s, "Snapshot was made with a different machine (%s)", str);
+        return;
+    }
+
+    snapshot_raw_read_string(s, str, sizeof(str));
+    val = snapshot_raw_read_u32(s);
+    if (strcmp(str, cpu_f->internal_name) || (val != (uint32_t) cpu)) {
+        snapshot_set_error(s, "Snapshot was made with a different CPU (%s)", str);
+        return;
+    }
+
+    val = snapshot_raw_read_u32(s);
+    if (val != mem_size) {
+        snapshot_set_error(s, "Snapshot was made with a different amount of memory (%i KB)", val);
+        return;
+    }
+
+    snapshot_raw_read(s, s->id, SNAPSHOT_ID_LEN);
+}
+
+/* A device without state handlers would resume in whatever state it is in,
+   which does not match the rest of the machine, so refuse up front. */
+static int
+snapshot_check_devices(const char *fn, const char *op)
+{
+    const device_t     *dev = device_get_stateless();
+    const lpt_device_t *lpt = lpt_device_get_stateless();
+
+    if ((dev == NULL) && (lpt == NULL))
+        return 0;
+
+    snprintf(snapshot_message, sizeof(snapshot_message), "Device \"%s\" does not support snapshots",
+             (dev != NULL) ? dev->name : lpt->name);
+    pclog("SNAPSHOT: Unable to %s \"%s\": %s\n", op, fn, snapshot_message);
+
+    return -1;
+}
+
+int
+snapshot_save(const char *fn)
+{
+    snapshot_t *s;
+    char        message[512];
+
+    snapshot_message[0] = '\0';
+    if (snapshot_check_devices(fn, "save") != 0)
+        return -1;
+
+    s = snapshot_open(fn, 1);
+    if (s == NULL) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "Unable to create the file");
+        pclog("SNAPSHOT: Unable to create \"%s\"\n", fn);
+        return -1;
+    }
+
+    snapshot_log("SNAPSHOT: Saving to \"%s\"\n", fn);
+
+    snapshot_write_header(s);
+
+    for (const snapshot_section_t *sec = core_sections; sec->name != NULL; sec++) {
+        snapshot_section_begin(s, sec->name, 0);
+        sec->save(s);
+        snapshot_section_end(s);
+    }
+
+    device_save_state_all(s);
+
+    /* End marker. */
+    snapshot_raw_write_string(s, "");
+
+    snprintf(message, sizeof(message), "%s", s->message);
+    if (snapshot_close(s) != 0) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "%s", message[0] ? message : "Write error");
+        pclog("SNAPSHOT: Unable to save \"%s\": %s\n", fn, snapshot_message);
+        return -1;
+    }
+
+    pclog("SNAPSHOT: Saved \"%s\"\n", fn);
+
+    return 0;
+}
+
+int
+snapshot_load(const char *fn)
+{
+    snapshot_t *s;
+    const char *name;
+    uint32_t    instance;
+    char        message[512];
+    int         touched = 0;
+
+    snapshot_message[0] = '\0';
+    if (snapshot_check_devices(fn, "load") != 0)
+        return -1;
+
+    s = snapshot_open(fn, 0);
+    if (s == NULL) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "Unable to open the file");
+        pclog("SNAPSHOT: Unable to open \"%s\"\n", fn);
+        return -1;
+    }
+
+    snapshot_log("SNAPSHOT: Loading from \"%s\"\n", fn);
+
+    snapshot_check_header(s);
+
+    for (const snapshot_section_t *sec = core_sections; !s->error && (sec->name != NULL); sec++) {
+        name = snapshot_section_next(s, &instance);
+        if ((name == NULL) || strcmp(name, sec->name)) {
+            snapshot_set_error(s, "Missing section \"%s\"", sec->name);
+            break;
+        }
+
+        touched = 1;
+        sec->load(s);
+        snapshot_section_end(s);
+    }
+
+    if (!s->error)
+        device_load_state_all(s);
+
+    snprintf(message, sizeof(message), "%s", s->message);
+    if (snapshot_close(s) != 0) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "%s", message[0] ? message : "Read error");
+        pclog("SNAPSHOT: Unable to load \"%s\": %s\n", fn, snapshot_message);
+
+        /* The machine state is inconsistent if we got past the header. */
+        if (touched)
+            pc_reset_hard();
+
+        return -1;
+    }
+
+    device_force_redraw();
+
+    pclog("SNAPSHOT: Loaded \"%s\"\n", fn);
+
+    return 0;
+}
+
+/* Compares the guest RAM images of two snapshots, past their identifiers. */
+static int
+snapshot_compare_ram(const char *fn, const char *check_fn)
+{
+    FILE   *fp       = plat_fopen64(fn, "rb");
+    FILE   *check_fp = plat_fopen64(check_fn, "rb");
+    uint8_t buf[2][SNAPSHOT_RAM_PAGE];
+    size_t  n[2];
+    int     ret = 0;
+
+    if ((fp == NULL) || (check_fp == NULL) ||
+        (snapshot_fseek(fp, SNAPSHOT_RAM_ALIGN, SEEK_SET) != 0) ||
+        (snapshot_fseek(check_fp, SNAPSHOT_RAM_ALIGN, SEEK_SET) != 0))
+        ret = -1;
+
+    while (ret == 0) {
+        n[0] = fread(buf[0], 1, SNAPSHOT_RAM_PAGE, fp);
+        n[1] = fread(buf[1], 1, SNAPSHOT_RAM_PAGE, check_fp);
+        if ((n[0] != n[1]) || memcmp(buf[0], buf[1], n[0]))
+            ret = -1;
+        else if (n[0] < SNAPSHOT_RAM_PAGE)
+            break;
+    }
+
+    if (fp != NULL)
+        fclose(fp);
+    if (check_fp != NULL)
+        fclose(check_fp);
+
+    return ret;
+}
+
+/* Compares two snapshots section by section, leaving the first difference
+   in snapshot_message. */
+static int
+snapshot_compare(const char *fn, const char *check_fn)
+{
+    snapshot_t *s[2];
+    const char *name[2];
+    uint32_t    instance[2];
+    char        section[256];
+    int         more[2];
+    int         ret = 0;
+
+    s[0] = snapshot_open(fn, 0);
+    s[1] = snapshot_open(check_fn, 0);
+    if ((s[0] == NULL) || (s[1] == NULL)) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "Unable to open the file");
+        ret = -1;
+        goto done;
+    }
+
+    snapshot_check_header(s[0]);
+    snapshot_check_header(s[1]);
+
+    while ((ret == 0) && !s[0]->error && !s[1]->error) {
+        name[0] = snapshot_section_next(s[0], &instance[0]);
+        name[1] = snapshot_section_next(s[1], &instance[1]);
+        if ((name[0] == NULL) || (name[1] == NULL)) {
+            if (name[0] != name[1]) {
+                snprintf(snapshot_message, sizeof(snapshot_message), "The restored machine has different sections");
+                ret = -1;
+            }
+            break;
+        }
+
+        snprintf(section, sizeof(section), "%s", name[0]);
+        if (strcmp(name[0], name[1]) || (instance[0] != instance[1])) {
+            snprintf(snapshot_message, sizeof(snapshot_message),
+                     "Section \"%s\" was saved as \"%s\" after restoring", section, name[1]);
+            ret = -1;
+            break;
+        }
+
+        do {
+            more[0] = snapshot_next_chunk(s[0]);
+            more[1] = snapshot_next_chunk(s[1]);
+            if ((more[0] != more[1]) ||
+                (more[0] && ((s[0]->buf_len != s[1]->buf_len) || memcmp(s[0]->buf, s[1]->buf, s[0]->buf_len)))) {
+                snprintf(snapshot_message, sizeof(snapshot_message),
+                         "Section \"%s\" (%u) changed after restoring", section, instance[0]);
+                ret = -1;
+            }
+        } while ((ret == 0) && more[0]);
+    }
+
+    if ((ret == 0) && (s[0]->error || s[1]->error)) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "%s", s[0]->error ? s[0]->message : s[1]->message);
+        ret = -1;
+    }
+
+    if ((ret == 0) && (snapshot_compare_ram(s[0]->ram_fn, s[1]->ram_fn) != 0)) {
+        snprintf(snapshot_message, sizeof(snapshot_message), "Guest RAM changed after restoring");
+        ret = -1;
+    }
+
+done:
+    for (int i = 0; i < 2; i++) {
+        if (s[i] != NULL)
+            snapshot_close(s[i]);
+    }
+
+    return ret;
+}
+
+/* Saves the machine to fn, restores it from there and saves it again next to
+   it; both snapshots must match, or some state did not survive the round
+   trip. The second snapshot is kept on failure so that it can be examined. */
+int
+snapshot_check(const char *fn)
+{
+    char check_fn[1040];
+    char check_ram_fn[1048];
+
+    if ((snapshot_save(fn) != 0) || (snapshot_load(fn) != 0))
+        return -1;
+
+    snprintf(check_fn, sizeof(check_fn), "%s.check", fn);
+    snprintf(check_ram_fn, sizeof(check_ram_fn), "%s.ram", check_fn);
+    if (snapshot_save(check_fn) != 0)
+        return -1;
+
+    if (snapshot_compare(fn, check_fn) != 0) {
+        pclog("SNAPSHOT: \"%s\" and \"%s\" differ: %s\n", fn, check_fn, snapshot_message);
+        return -1;
+    }
+
+    remove(check_fn);
+    remove(check_ram_fn);
+
+    pclog("SNAPSHOT: Checked \"%s\"\n", fn);
+
+    return 0;
+}
+
+static void
+snapshot_request(const char *fn, int op)
+{
+    if (snapshot_mutex == NULL)
+        snapshot_mutex = thread_create_mutex();
+
+    thread_wait_mutex(snapshot_mutex);
+    snprintf(snapshot_request_fn, sizeof(snapshot_request_fn), "%s", fn);
+    snapshot_request_op      = op;
+    snapshot_request_pending = 1;
+    thread_release_mutex(snapshot_mutex);
+}
+
+void
+snapshot_save_request(const char *fn)
+{
+    snapshot_request(fn, SNAPSHOT_OP_SAVE);
+}
+
+void
+snapshot_load_request(const char *fn)
+{
+    snapshot_request(fn, SNAPSHOT_OP_LOAD);
+}
+
+void
+snapshot_check_request(const char *fn)
+{
+    snapshot_request(fn, SNAPSHOT_OP_CHECK);
+}
+
+/* Called from the emulation thread between two blocks of emulated code. */
+void
+snapshot_process(void)
+{
+    static const char *op_names[] = { "save", "load", "check" };
+    char               fn[1024];
+    char               message[1800];
+    int                op;
+    int                ret;
+
+    if (!snapshot_request_pending)
+        return;
+
+    thread_wait_mutex(snapshot_mutex);
+    snprintf(fn, sizeof(fn), "%s", snapshot_request_fn);
+    op                       = snapshot_request_op;
+    snapshot_request_pending = 0;
+    thread_release_mutex(snapshot_mutex);
+
+    switch (op) {
+        case SNAPSHOT_OP_LOAD:
+            ret = snapshot_load(fn);
+            break;
+        case SNAPSHOT_OP_CHECK:
+            ret = snapshot_check(fn);
+            break;
+        default:
+            ret = snapshot_save(fn);
+            break;
+    }
+
+    if (ret != 0) {
+        snprintf(message, sizeof(message), "Unable to %s the machine state snapshot \"%s\":\n\n%s.",
+                 op_names[op], fn, snapshot_message);
+        ui_msgbox(MBX_ERROR | MBX_ANSI, message);
+    } else if (op == SNAPSHOT_OP_CHECK) {
+        snprintf(message, sizeof(message), "The machine state snapshot \"%s\" was restored without any difference.", fn);
+        ui_msgbox(MBX_INFO | MBX_ANSI, message);
+    }
+}
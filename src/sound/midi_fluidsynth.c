@@ -4,8 +4,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
-#ifdef __unix__
+#ifndef _WIN32
+#    include <fcntl.h>
 #    include <unistd.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
 #endif
 #include <fluidsynth.h>
 
@@ -26,6 +29,11 @@
 #    define USE_OLD_FLUIDSYNTH_API
 #endif
 
+/* Custom SoundFont file callbacks need FluidSynth 2.0 or newer. */
+#if !defined(_WIN32) && (FLUIDSYNTH_VERSION_MAJOR >= 2)
+#    define USE_SF_MMAP
+#endif
+
 extern void givealbuffer_midi(void *buf, uint32_t size);
 extern void al_set_midi(int freq, int buf_size);
 
@@ -47,6 +55,109 @@ typedef struct fluidsynth {
 
 fluidsynth_t fsdev;
 
+#ifdef USE_SF_MMAP
+/*
+ * With rom_mmap enabled, SoundFonts are read through a mapping of the whole
+ * file instead of stdio, and FluidSynth is told to load the samples of a
+ * preset only once a channel selects it. Large General MIDI SoundFonts then
+ * only cost each instance the samples the guest actually uses, copied out
+ * of the host page cache, which all instances share.
+ */
+typedef struct fluidsynth_sf_file_t {
+    uint8_t *data;
+    size_t   size;
+    size_t   pos;
+} fluidsynth_sf_file_t;
+
+static void *
+fluidsynth_sf_open(const char *filename)
+{
+    fluidsynth_sf_file_t *sf;
+    struct stat           st;
+    void                 *ptr = MAP_FAILED;
+    int                   fd;
+
+    fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+        ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+        return NULL;
+
+    sf       = calloc(1, sizeof(fluidsynth_sf_file_t));
+    sf->data = (uint8_t *) ptr;
+    sf->size = st.st_size;
+
+    return sf;
+}
+
+static int
+fluidsynth_sf_read(void *buf, fluid_long_long_t count, void *handle)
+{
+    fluidsynth_sf_file_t *sf = (fluidsynth_sf_file_t *) handle;
+
+    if ((count < 0) || ((size_t) count > (sf->size - sf->pos)))
+        return FLUID_FAILED;
+
+    memcpy(buf, sf->data + sf->pos, count);
+    sf->pos += count;
+
+    return FLUID_OK;
+}
+
+static int
+fluidsynth_sf_seek(void *handle, fluid_long_long_t offset, int origin)
+{
+    fluidsynth_sf_file_t *sf = (fluidsynth_sf_file_t *) handle;
+    fluid_long_long_t     pos;
+
+    switch (origin) {
+        case SEEK_SET:
+            pos = offset;
+            break;
+        case SEEK_CUR:
+            pos = (fluid_long_long_t) sf->pos + offset;
+            break;
+        case SEEK_END:
+            pos = (fluid_long_long_t) sf->size + offset;
+            break;
+        default:
+            return FLUID_FAILED;
+    }
+
+    if ((pos < 0) || ((size_t) pos > sf->size))
+        return FLUID_FAILED;
+
+    sf->pos = pos;
+
+    return FLUID_OK;
+}
+
+static fluid_long_long_t
+fluidsynth_sf_tell(void *handle)
+{
+    const fluidsynth_sf_file_t *sf = (fluidsynth_sf_file_t *) handle;
+
+    return sf->pos;
+}
+
+static int
+fluidsynth_sf_close(void *handle)
+{
+    fluidsynth_sf_file_t *sf = (fluidsynth_sf_file_t *) handle;
+
+    munmap(sf->data, sf->size);
+    free(sf);
+
+    return FLUID_OK;
+}
+#endif
+
 int
 fluidsynth_available(void)
 {
@@ -161,9 +272,27 @@ fluidsynth_init(UNUSED(const device_t *info))
 
     fluid_settings_setnum(data->settings, "synth.sample-rate", 44100);
     fluid_settings_setnum(data->settings, "synth.gain", device_get_config_int("output_gain") / 100.0f);
+#ifdef USE_SF_MMAP
+    /* Not known to FluidSynth before 2.1, in which case this does nothing. */
+    if (rom_mmap)
+        fluid_settings_setint(data->settings, "synth.dynamic-sample-loading", 1);
+#endif
 
     data->synth = new_fluid_synth(data->settings);
 
+#ifdef USE_SF_MMAP
+    if (rom_mmap) {
+        /* Added loaders are tried before the stock one, which stays as the fallback. */
+        fluid_sfloader_t *loader = new_fluid_defsfloader(data->settings);
+
+        if (loader != NULL) {
+            fluid_sfloader_set_callbacks(loader, fluidsynth_sf_open, fluidsynth_sf_read,
+                                         fluidsynth_sf_seek, fluidsynth_sf_tell, fluidsynth_sf_close);
+            fluid_synth_add_sfloader(data->synth, loader);
+        }
+    }
+#endif
+
     const char *sound_font = device_get_config_string("sound_font");
 #ifdef __unix__
     if (!sound_font || sound_font[0] == 0)
@@ -1,8 +1,11 @@
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <86box/86box.h>
 #include <86box/device.h>
@@ -108,6 +111,8 @@ static const mt32emu_report_handler_i handler_cm32l = { &handler_cm32l_v0 };
 
 static mt32emu_context context         = NULL;
 static int             roms_present[2] = { -1, -1 };
+static uint8_t        *rom_mapped[2]   = { NULL, NULL };
+static int             rom_mapped_sz[2];
 
 mt32emu_return_code
 mt32_check(UNUSED(const char *func), mt32emu_return_code ret, mt32emu_return_code expected)
@@ -258,25 +263,75 @@ mt32_sysex(uint8_t *data, unsigned int len)
         mt32_check("mt32emu_play_sysex", mt32emu_play_sysex(context, data, len), MT32EMU_RC_OK);
 }
 
+/* Hands a ROM to munt. With rom_mmap, the image is mapped from the file and
+   passed as data, which munt keeps a pointer to rather than reading the file
+   into a buffer of its own, so the raw ROMs are shared between instances. */
+static int
+mt32_add_rom(const char *rom, int idx, mt32emu_return_code expected)
+{
+    char fn[512];
+
+    /* Never hand munt a mapping left over from a previous instance. */
+    rom_mapped[idx]    = NULL;
+    rom_mapped_sz[idx] = 0;
+
+    if (!rom_getfile((char *) rom, fn, 512))
+        return 0;
+
+    if (rom_mmap) {
+        struct stat st;
+
+        if ((stat(fn, &st) == 0) && (st.st_size > 0) && (st.st_size <= INT_MAX)) {
+            rom_mapped[idx] = rom_map(fn, (int) st.st_size, 0);
+            if (rom_mapped[idx] != NULL)
+                rom_mapped_sz[idx] = (int) st.st_size;
+        }
+    }
+
+    if (rom_mapped[idx] != NULL)
+        return mt32_check("mt32emu_add_rom_data",
+                          mt32emu_add_rom_data(context, rom_mapped[idx], rom_mapped_sz[idx], NULL), expected);
+
+    return mt32_check("mt32emu_add_rom_file", mt32emu_add_rom_file(context, fn), expected);
+}
+
+static void
+mt32_unmap_roms(void)
+{
+    for (int i = 0; i < 2; i++) {
+        rom_unmap(rom_mapped[i], rom_mapped_sz[i]);
+        rom_mapped[i]    = NULL;
+        rom_mapped_sz[i] = 0;
+    }
+}
+
+/* Undoes a partial mt32emu_init(); the context goes first, as munt may
+   still point into the mapped images. */
+static void *
+mt32_init_fail(void)
+{
+    mt32emu_free_context(context);
+    context = NULL;
+
+    mt32_unmap_roms();
+
+    return NULL;
+}
+
 void *
 mt32emu_init(char *control_rom, char *pcm_rom)
 {
     midi_device_t *dev;
-    char           fn[512];
 
     context = mt32emu_create_context(strstr(control_rom, "MT32_CONTROL.ROM") ? handler_mt32 : handler_cm32l, NULL);
 
-    if (!rom_getfile(control_rom, fn, 512))
-        return 0;
-    if (!mt32_check("mt32emu_add_rom_file", mt32emu_add_rom_file(context, fn), MT32EMU_RC_ADDED_CONTROL_ROM))
-        return 0;
-    if (!rom_getfile(pcm_rom, fn, 512))
-        return 0;
-    if (!mt32_check("mt32emu_add_rom_file", mt32emu_add_rom_file(context, fn), MT32EMU_RC_ADDED_PCM_ROM))
-        return 0;
+    if (!mt32_add_rom(control_rom, 0, MT32EMU_RC_ADDED_CONTROL_ROM))
+        return mt32_init_fail();
+    if (!mt32_add_rom(pcm_rom, 1, MT32EMU_RC_ADDED_PCM_ROM))
+        return mt32_init_fail();
 
     if (!mt32_check("mt32emu_open_synth", mt32emu_open_synth(context), MT32EMU_RC_OK))
-        return 0;
+        return mt32_init_fail();
 
     samplerate = mt32emu_get_actual_stereo_output_samplerate(context);
     /* buf_size = samplerate/RENDER_RATE*2; */
@@ -364,6 +419,9 @@ mt32_close(void *priv)
     }
     context = NULL;
 
+    /* munt is done with the images once the context is gone. */
+    mt32_unmap_roms();
+
     ui_sb_mt32lcd("");
 
     if (buffer)
@@ -27,6 +27,7 @@
 #include <86box/snd_speaker.h>
 #include <86box/sound.h>
 #include <86box/plat_unused.h>
+#include <86box/snapshot.h>
 
 int speaker_mute       = 0;
 int speaker_gated      = 0;
@@ -108,6 +109,33 @@ speaker_get_buffer(int32_t *buffer, int len, UNUSED(void *priv))
     speaker_pos = 0;
 }
 
+/* The output buffer is not saved, it only holds samples not yet mixed. */
+void
+speaker_save_state(snapshot_t *s)
+{
+    SNAPSHOT_WRITE_VAR(s, speaker_gated);
+    SNAPSHOT_WRITE_VAR(s, speaker_enable);
+    SNAPSHOT_WRITE_VAR(s, was_speaker_enable);
+    SNAPSHOT_WRITE_VAR(s, gated);
+    SNAPSHOT_WRITE_VAR(s, speakval);
+    SNAPSHOT_WRITE_VAR(s, speakon);
+    SNAPSHOT_WRITE_VAR(s, speaker_mode);
+    SNAPSHOT_WRITE_VAR(s, speaker_count);
+}
+
+void
+speaker_load_state(snapshot_t *s)
+{
+    SNAPSHOT_READ_VAR(s, speaker_gated);
+    SNAPSHOT_READ_VAR(s, speaker_enable);
+    SNAPSHOT_READ_VAR(s, was_speaker_enable);
+    SNAPSHOT_READ_VAR(s, gated);
+    SNAPSHOT_READ_VAR(s, speakval);
+    SNAPSHOT_READ_VAR(s, speakon);
+    SNAPSHOT_READ_VAR(s, speaker_mode);
+    SNAPSHOT_READ_VAR(s, speaker_count);
+}
+
 void
 speaker_init(void)
 {
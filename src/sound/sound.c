@@ -36,6 +36,8 @@
 #include <86box/timer.h>
 #include <86box/snd_mpu401.h>
 #include <86box/sound.h>
+#include <86box/capture.h>
+#include <minitrace/minitrace.h>
 
 typedef struct {
     const device_t *device;
@@ -534,6 +536,8 @@ sound_poll(UNUSED(void *priv))
     if (sound_pos_global == SOUNDBUFLEN) {
         int c;
 
+        MTR_BEGIN("sound", "sound_poll");
+
         memset(outbuffer, 0x00, SOUNDBUFLEN * 2 * sizeof(int32_t));
 
         for (c = 0; c < sound_handlers_num; c++)
@@ -552,6 +556,10 @@ sound_poll(UNUSED(void *priv))
             }
         }
 
+        if (capture_active)
+            capture_audio(sound_is_float ? (void *) outbuffer_ex : (void *) outbuffer_ex_int16,
+                          SOUNDBUFLEN, sound_is_float);
+
         if (sound_is_float)
             givealbuffer(outbuffer_ex);
         else
@@ -566,6 +574,8 @@ sound_poll(UNUSED(void *priv))
         }
 
         sound_pos_global = 0;
+
+        MTR_END("sound", "sound_poll");
     }
 }
 
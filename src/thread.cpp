@@ -4,6 +4,7 @@
 
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <minitrace/minitrace.h>
 
 struct event_cpp11_t {
     std::condition_variable cond;
@@ -18,6 +19,9 @@ thread_create_named(void (*thread_rout)(void *param), void *param, const char *n
 {
     auto thread = new std::thread([thread_rout, param, name] {
         plat_set_thread_name(NULL, name);
+#ifdef MTR_ENABLED
+        mtr_register_thread_name(name);
+#endif
         thread_rout(param);
     });
     return thread;
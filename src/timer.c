@@ -3,7 +3,11 @@
 #include <string.h>
 #include <wchar.h>
 #include <86box/86box.h>
+#include <86box/device.h>
 #include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/profiler.h>
+#include <minitrace/minitrace.h>
 
 uint64_t TIMER_USEC;
 uint32_t timer_target;
@@ -17,6 +21,23 @@ int timer_inited = 0;
 
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+#ifdef MTR_ENABLED
+/* Names a timer callback in the trace after the device owning it, with the
+   callback address to tell apart several timers of one device. */
+static const char *
+timer_trace_begin(const pc_timer_t *timer)
+{
+    const device_t *dev  = device_get_by_priv(timer->priv);
+    const char     *name = ((dev != NULL) && (dev->name != NULL)) ? dev->name : "timer";
+    char            callback[32];
+
+    snprintf(callback, sizeof(callback), "%p", (void *) (uintptr_t) timer->callback);
+    MTR_BEGIN_S("timer", name, "callback", callback);
+
+    return name;
+}
+#endif
+
 void
 timer_enable(pc_timer_t *timer)
 {
@@ -134,7 +155,14 @@ timer_process(void)
                have a NULL callback when no operation
                is needed. */
             timer->in_callback = 1;
-            timer->callback(timer->priv);
+#ifdef MTR_ENABLED
+            const char *trace_name = tracing_on ? timer_trace_begin(timer) : NULL;
+#endif
+            PROFILER_CALL(PROFILER_TIMER, timer->priv, timer->callback(timer->priv));
+#ifdef MTR_ENABLED
+            if (trace_name != NULL)
+                MTR_END("timer", trace_name);
+#endif
             timer->in_callback = 0;
         }
     }
@@ -181,6 +209,7 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->priv        = priv;
     timer->flags       = 0;
     timer->prev        = timer->next = NULL;
+    PROFILER_REGISTER(priv);
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -26,6 +26,7 @@
 #endif
 
 #include <86box/86box.h>
+#include "cpu.h"
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/keyboard.h>
@@ -44,6 +45,9 @@
 #include <86box/video.h>
 #include <86box/ui.h>
 #include <86box/gdbstub.h>
+#include <86box/profiler.h>
+#include <86box/snapshot.h>
+#include <86box/capture.h>
 
 #define __USE_GNU 1 /* shouldn't be done, yet it is */
 #include <pthread.h>
@@ -414,7 +418,7 @@ plat_mmap(size_t size, uint8_t executable)
 #else
     void *ret = mmap(0, size, PROT_READ | PROT_WRITE | (executable ? PROT_EXEC : 0), MAP_ANON | MAP_PRIVATE, -1, 0);
 #endif
-    return (ret < 0) ? NULL : ret;
+    return (ret == MAP_FAILED) ? NULL : ret;
 }
 
 void
@@ -973,6 +977,20 @@ monitor_thread(void *param)
                         "carteject <id> - eject cartridge from drive <id>.\n"
                         "moeject <id> - eject image from MO drive <id>.\n\n"
                         "hardreset - hard reset the emulated system.\n"
+                        "savestate <filename> - save the machine state to <filename>.\n"
+                        "loadstate <filename> - restore the machine state from <filename>.\n"
+                        "checkstate <filename> - save to <filename>, restore and check that nothing changed.\n"
+                        "capture <start <base> [fps]|stop> - record video and audio to <base>.y4m and <base>.wav.\n"
+                        "tlb [reset] - print (or reset) the software TLB statistics.\n"
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+                        "dynarec [reset|opt on|off] - print (or reset) the recompiler statistics, or toggle IR optimisation.\n"
+#endif
+#ifdef USE_PROFILER
+                        "profiler <on|off|dump> - control the device profiler, dump prints JSON.\n"
+#endif
+#ifdef MTR_ENABLED
+                        "trace <start [file]|stop> - record a Chrome trace (default file: trace.json).\n"
+#endif
                         "pause - pause the the emulated system.\n"
                         "fullscreen - toggle fullscreen.\n"
                         "version - print version and license information.\n"
@@ -1023,6 +1041,74 @@ monitor_thread(void *param)
                     printf("%s", dopause ? "Paused.\n" : "Unpaused.\n");
                 } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
                     pc_reset_hard();
+                } else if (strncasecmp(xargv[0], "savestate", 9) == 0 && cmdargc >= 2) {
+                    snapshot_save_request(xargv[1]);
+                } else if (strncasecmp(xargv[0], "loadstate", 9) == 0 && cmdargc >= 2) {
+                    snapshot_load_request(xargv[1]);
+                } else if (strncasecmp(xargv[0], "checkstate", 10) == 0 && cmdargc >= 2) {
+                    snapshot_check_request(xargv[1]);
+                } else if (strncasecmp(xargv[0], "capture", 7) == 0 && cmdargc >= 2) {
+                    if ((strncasecmp(xargv[1], "start", 5) == 0) && (cmdargc >= 3)) {
+                        if (!capture_start(xargv[2], (cmdargc >= 4) ? atoi(xargv[3]) : CAPTURE_FPS_DEFAULT))
+                            printf("A capture is already running.\n");
+                    } else if (strncasecmp(xargv[1], "stop", 4) == 0)
+                        capture_stop();
+                } else if (strncasecmp(xargv[0], "tlb", 3) == 0) {
+                    if ((cmdargc >= 2) && (strncasecmp(xargv[1], "reset", 5) == 0))
+                        memset(&mmu_tlb_stats, 0, sizeof(mmu_tlb_stats_t));
+                    else
+                        printf("Software TLB: %i entries\n"
+                               "walks %" PRIu64 ", fills %" PRIu64 "\n"
+                               "flushes: full %" PRIu64 ", CR3 %" PRIu64 ", INVLPG %" PRIu64 "\n"
+                               "global entries kept %" PRIu64 "\n",
+                               cachesize, mmu_tlb_stats.walks, mmu_tlb_stats.fills,
+                               mmu_tlb_stats.flush_full, mmu_tlb_stats.flush_cr3, mmu_tlb_stats.flush_invlpg,
+                               mmu_tlb_stats.kept_global);
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+                } else if (strncasecmp(xargv[0], "dynarec", 7) == 0) {
+                    if ((cmdargc >= 2) && (strncasecmp(xargv[1], "reset", 5) == 0))
+                        memset(&codegen_stats, 0, sizeof(codegen_stats_t));
+                    else if ((cmdargc >= 3) && (strncasecmp(xargv[1], "opt", 3) == 0)) {
+                        /* Only affects blocks compiled from now on. */
+                        cpu_dynarec_opt = (strncasecmp(xargv[2], "on", 2) == 0);
+                        printf("IR optimisation %s.\n", cpu_dynarec_opt ? "enabled" : "disabled");
+                    } else
+                        printf("Recompiler: %" PRIu64 " blocks compiled, %" PRIu64 " of them evicted before\n"
+                               "evictions: %" PRIu64 " for code blocks, %" PRIu64 " for code memory\n"
+                               "IR optimisation %s: %" PRIu64 " uOPs generated, %" PRIu64 " emitted\n"
+                               "folded %" PRIu64 ", loads %" PRIu64 "\n",
+                               codegen_stats.recompiles, codegen_stats.recompiles_evicted,
+                               codegen_stats.evictions, codegen_stats.evictions_mem,
+                               cpu_dynarec_opt ? "on" : "off", codegen_stats.ir_uops, codegen_stats.ir_uops_emitted,
+                               codegen_stats.ir_folded, codegen_stats.ir_loads);
+#endif
+#ifdef USE_PROFILER
+                } else if (strncasecmp(xargv[0], "profiler", 8) == 0 && cmdargc >= 2) {
+                    if (strncasecmp(xargv[1], "on", 2) == 0) {
+                        profiler_set_enabled(1);
+                        printf("Profiler enabled.\n");
+                    } else if (strncasecmp(xargv[1], "off", 3) == 0) {
+                        profiler_set_enabled(0);
+                        printf("Profiler disabled.\n");
+                    } else if (strncasecmp(xargv[1], "dump", 4) == 0) {
+                        char *json = profiler_dump_json();
+
+                        if (json) {
+                            printf("%s\n", json);
+                            free(json);
+                        }
+                    }
+#endif
+#ifdef MTR_ENABLED
+                } else if (strncasecmp(xargv[0], "trace", 5) == 0 && cmdargc >= 2) {
+                    if (strncasecmp(xargv[1], "start", 5) == 0) {
+                        if (pc_trace_start((cmdargc >= 3) ? xargv[2] : "trace.json"))
+                            printf("Tracing started.\n");
+                    } else if (strncasecmp(xargv[1], "stop", 4) == 0) {
+                        pc_trace_stop();
+                        printf("Tracing stopped.\n");
+                    }
+#endif
                 } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
                     uint8_t id;
                     bool    err = false;
@@ -1461,3 +1547,9 @@ ui_hard_reset_completed(void)
 {
     /* No-op. */
 }
+
+void
+ui_trace_state_changed(void)
+{
+    /* No-op. */
+}
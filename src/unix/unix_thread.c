@@ -6,6 +6,7 @@
 #include <86box/86box.h>
 #include <86box/plat.h>
 #include <86box/thread.h>
+#include <minitrace/minitrace.h>
 
 typedef struct event_pthread_t {
     pthread_cond_t  cond;
@@ -15,7 +16,8 @@ typedef struct event_pthread_t {
 
 typedef struct thread_param {
     void (*thread_rout)(void *);
-    void *param;
+    void       *param;
+    const char *name;
 } thread_param;
 
 typedef struct pt_mutex_t {
@@ -27,6 +29,9 @@ thread_run_wrapper(thread_param *arg)
 {
     thread_param localparam = *arg;
     free(arg);
+#ifdef MTR_ENABLED
+    mtr_register_thread_name(localparam.name);
+#endif
     localparam.thread_rout(localparam.param);
     return NULL;
 }
@@ -38,6 +43,7 @@ thread_create_named(void (*thread_rout)(void *param), void *param, const char *n
     thread_param *thrparam = malloc(sizeof(thread_param));
     thrparam->thread_rout  = thread_rout;
     thrparam->param        = param;
+    thrparam->name         = name;
 
     pthread_create(thread, NULL, (void *(*) (void *) ) thread_run_wrapper, thrparam);
     plat_set_thread_name(thread, name);
@@ -21,6 +21,7 @@
  */
 #include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -38,6 +39,7 @@
 #include <86box/rom.h>
 #include <86box/plat.h>
 #include <86box/ui.h>
+#include <86box/snapshot.h>
 #include <86box/video.h>
 #include <86box/vid_8514a.h>
 #include <86box/vid_xga.h>
@@ -1440,6 +1442,48 @@ svga_close(svga_t *svga)
     svga_pri = NULL;
 }
 
+/* Saves the generic SVGA core state. Card-specific registers and any extra
+   timers are left to the card's own state handler. */
+void
+svga_save_state(svga_t *svga, snapshot_t *s)
+{
+    snapshot_write(s, &svga->fast, offsetof(svga_t, map8) - offsetof(svga_t, fast));
+    snapshot_write(s, svga->pallook, offsetof(svga_t, timer) - offsetof(svga_t, pallook));
+    snapshot_write_timer(s, &svga->timer);
+    snapshot_write(s, &svga->hwcursor, offsetof(svga_t, render) - offsetof(svga_t, hwcursor));
+    snapshot_write(s, svga->crtc, offsetof(svga_t, vram) - offsetof(svga_t, crtc));
+    snapshot_write(s, &svga->crtcreg, offsetof(svga_t, remap_func) - offsetof(svga_t, crtcreg));
+    snapshot_write(s, svga->vram, svga->vram_max);
+}
+
+void
+svga_load_state(svga_t *svga, snapshot_t *s)
+{
+    uint32_t vram_max = svga->vram_max;
+
+    snapshot_read(s, &svga->fast, offsetof(svga_t, map8) - offsetof(svga_t, fast));
+    snapshot_read(s, svga->pallook, offsetof(svga_t, timer) - offsetof(svga_t, pallook));
+    snapshot_read_timer(s, &svga->timer);
+    snapshot_read(s, &svga->hwcursor, offsetof(svga_t, render) - offsetof(svga_t, hwcursor));
+    snapshot_read(s, svga->crtc, offsetof(svga_t, vram) - offsetof(svga_t, crtc));
+    snapshot_read(s, &svga->crtcreg, offsetof(svga_t, remap_func) - offsetof(svga_t, crtcreg));
+
+    if (svga->vram_max != vram_max) {
+        snapshot_set_error(s, "Video memory size mismatch (%i KB, expected %i KB)",
+                           svga->vram_max >> 10, vram_max >> 10);
+        svga->vram_max = vram_max;
+        return;
+    }
+    snapshot_read(s, svga->vram, svga->vram_max);
+
+    /* The render and pixel lookup pointers are derived state. */
+    svga->map8 = svga->pallook;
+    svga_recalctimings(svga);
+
+    memset(svga->changedvram, svga->monitor->mon_changeframecount, (svga->vram_max >> 12) + 1);
+    svga->fullchange = svga->monitor->mon_changeframecount;
+}
+
 uint32_t
 svga_decode_addr(svga_t *svga, uint32_t addr, int write)
 {
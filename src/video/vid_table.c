@@ -286,10 +286,7 @@ static void
 video_prepare(void)
 {
     /* Reset (deallocate) the video font arrays. */
-    if (fontdatksc5601) {
-        free(fontdatksc5601);
-        fontdatksc5601 = NULL;
-    }
+    video_ksc5601_close();
 
     /* Reset the blend. */
     herc_blend = 0;
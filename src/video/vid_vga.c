@@ -27,6 +27,7 @@
 #include <86box/rom.h>
 #include <86box/device.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
 #include <86box/vid_vga.h>
@@ -186,6 +187,22 @@ vga_force_redraw(void *priv)
     vga->svga.fullchange = changeframecount;
 }
 
+static void
+vga_save_state(void *priv, snapshot_t *s)
+{
+    vga_t *vga = (vga_t *) priv;
+
+    svga_save_state(&vga->svga, s);
+}
+
+static void
+vga_load_state(void *priv, snapshot_t *s)
+{
+    vga_t *vga = (vga_t *) priv;
+
+    svga_load_state(&vga->svga, s);
+}
+
 const device_t vga_device = {
     .name          = "IBM VGA",
     .internal_name = "vga",
@@ -197,7 +214,9 @@ const device_t vga_device = {
     { .available = vga_available },
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = vga_save_state,
+    .load_state    = vga_load_state
 };
 
 const device_t ps1vga_device = {
@@ -211,7 +230,9 @@ const device_t ps1vga_device = {
     { .available = NULL },
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = vga_save_state,
+    .load_state    = vga_load_state
 };
 
 const device_t ps1vga_mca_device = {
@@ -225,5 +246,7 @@ const device_t ps1vga_mca_device = {
     { .available = NULL },
     .speed_changed = vga_speed_changed,
     .force_redraw  = vga_force_redraw,
-    .config        = NULL
+    .config        = NULL,
+    .save_state    = vga_save_state,
+    .load_state    = vga_load_state
 };
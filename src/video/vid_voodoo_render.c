@@ -39,6 +39,7 @@
 #include <86box/vid_voodoo_regs.h>
 #include <86box/vid_voodoo_render.h>
 #include <86box/vid_voodoo_texture.h>
+#include <minitrace/minitrace.h>
 
 typedef struct voodoo_state_t {
     int      xstart, xend, xdir;
@@ -1550,6 +1551,7 @@ render_thread(void *param, int odd_even)
         thread_reset_event(voodoo->wake_render_thread[odd_even]);
         voodoo->render_voodoo_busy[odd_even] = 1;
 
+        MTR_BEGIN("voodoo", "render");
         while (!PARAM_EMPTY(odd_even)) {
             uint64_t         start_time = plat_timer_read();
             uint64_t         end_time;
@@ -1565,6 +1567,7 @@ render_thread(void *param, int odd_even)
             end_time = plat_timer_read();
             voodoo->render_time[odd_even] += end_time - start_time;
         }
+        MTR_END("voodoo", "render");
 
         voodoo->render_voodoo_busy[odd_even] = 0;
     }
@@ -49,8 +49,6 @@
  *          Copyright 2016-2019 Miran Grca.
  */
 #include <stdatomic.h>
-#define PNG_DEBUG 0
-#include <png.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -73,6 +71,8 @@
 #include <86box/thread.h>
 #include <86box/video.h>
 #include <86box/vid_svga.h>
+#include <86box/png_struct.h>
+#include <86box/capture.h>
 
 #include <minitrace/minitrace.h>
 
@@ -88,6 +88,7 @@ uint8_t      fontdat8x12[256][16];        /* MDSI Genius font */
 uint8_t      fontdat12x18[256][36];       /* IM1024 font */
 dbcs_font_t *fontdatksc5601       = NULL; /* Korean KSC-5601 font */
 dbcs_font_t *fontdatksc5601_user  = NULL; /* Korean KSC-5601 user defined font */
+static int   fontdatksc5601_mapped = 0;
 int          herc_blend           = 0;
 int          frames               = 0;
 int          fullchange           = 0;
@@ -304,85 +305,6 @@ video_wait_for_buffer_monitor(int monitor_index)
     thread_reset_event(blit_data_ptr->buffer_not_in_use);
 }
 
-static png_structp png_ptr[MONITORS_NUM];
-static png_infop   info_ptr[MONITORS_NUM];
-
-static void
-video_take_screenshot_monitor(const char *fn, uint32_t *buf, int start_x, int start_y, int row_len, int monitor_index)
-{
-    png_bytep         *b_rgb         = NULL;
-    FILE              *fp            = NULL;
-    uint32_t           temp          = 0x00000000;
-    const blit_data_t *blit_data_ptr = monitors[monitor_index].mon_blit_data_ptr;
-
-    /* create file */
-    fp = plat_fopen(fn, (const char *) "wb");
-    if (!fp) {
-        video_log("[video_take_screenshot] File %s could not be opened for writing", fn);
-        return;
-    }
-
-    /* initialize stuff */
-    png_ptr[monitor_index] = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-
-    if (!png_ptr[monitor_index]) {
-        video_log("[video_take_screenshot] png_create_write_struct failed");
-        fclose(fp);
-        return;
-    }
-
-    info_ptr[monitor_index] = png_create_info_struct(png_ptr[monitor_index]);
-    if (!info_ptr[monitor_index]) {
-        video_log("[video_take_screenshot] png_create_info_struct failed");
-        fclose(fp);
-        return;
-    }
-
-    png_init_io(png_ptr[monitor_index], fp);
-
-    png_set_IHDR(png_ptr[monitor_index], info_ptr[monitor_index], blit_data_ptr->w, blit_data_ptr->h,
-                 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
-                 PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
-
-    b_rgb = (png_bytep *) malloc(sizeof(png_bytep) * blit_data_ptr->h);
-    if (b_rgb == NULL) {
-        video_log("[video_take_screenshot] Unable to Allocate RGB Bitmap Memory");
-        fclose(fp);
-        return;
-    }
-
-    for (int y = 0; y < blit_data_ptr->h; ++y) {
-        b_rgb[y] = (png_byte *) malloc(png_get_rowbytes(png_ptr[monitor_index], info_ptr[monitor_index]));
-        for (int x = 0; x < blit_data_ptr->w; ++x) {
-            if (buf == NULL)
-                memset(&(b_rgb[y][x * 3]), 0x00, 3);
-            else {
-                temp                  = buf[((start_y + y) * row_len) + start_x + x];
-                b_rgb[y][x * 3]       = (temp >> 16) & 0xff;
-                b_rgb[y][(x * 3) + 1] = (temp >> 8) & 0xff;
-                b_rgb[y][(x * 3) + 2] = temp & 0xff;
-            }
-        }
-    }
-
-    png_write_info(png_ptr[monitor_index], info_ptr[monitor_index]);
-
-    png_write_image(png_ptr[monitor_index], b_rgb);
-
-    png_write_end(png_ptr[monitor_index], NULL);
-
-    /* cleanup heap allocation */
-    for (int i = 0; i < blit_data_ptr->h; i++)
-        if (b_rgb[i])
-            free(b_rgb[i]);
-
-    if (b_rgb)
-        free(b_rgb);
-
-    if (fp)
-        fclose(fp);
-}
-
 void
 video_screenshot_monitor(uint32_t *buf, int start_x, int start_y, int row_len, int monitor_index)
 {
@@ -406,8 +328,9 @@ video_screenshot_monitor(uint32_t *buf, int start_x, int start_y, int row_len, i
 
     video_log("taking screenshot to: %s\n", path);
 
-    video_take_screenshot_monitor((const char *) path, buf, start_x, start_y, row_len, monitor_index);
-    png_destroy_write_struct(&png_ptr[monitor_index], &info_ptr[monitor_index]);
+    /* The encoding and file write happen on the PNG encoder thread. */
+    png_queue_xrgb32(path, buf, start_x, start_y, row_len,
+                     monitors[monitor_index].mon_blit_data_ptr->w, monitors[monitor_index].mon_blit_data_ptr->h);
 
     atomic_fetch_sub(&monitors[monitor_index].mon_screenshots, 1);
 }
@@ -450,6 +373,9 @@ blit_thread(void *param)
         thread_reset_event(data->wake_blit_thread);
         MTR_BEGIN("video", "blit_thread");
 
+        if (capture_active && (data->monitor_index == 0))
+            capture_video(monitors[0].target_buffer, data->x, data->y, data->w, data->h);
+
         if (blit_func)
             blit_func(data->x, data->y, data->w, data->h, data->monitor_index);
 
@@ -463,11 +389,11 @@ blit_thread(void *param)
 void
 video_blit_memtoscreen_monitor(int x, int y, int w, int h, int monitor_index)
 {
-    MTR_BEGIN("video", "video_blit_memtoscreen");
-
     if ((w <= 0) || (h <= 0))
         return;
 
+    MTR_BEGIN("video", "video_blit_memtoscreen");
+
     video_wait_for_blit_monitor(monitor_index);
 
     monitors[monitor_index].mon_blit_data_ptr->busy          = 1;
@@ -982,10 +908,7 @@ video_close(void)
     free(video_8togs);
     free(video_6to8);
 
-    if (fontdatksc5601) {
-        free(fontdatksc5601);
-        fontdatksc5601 = NULL;
-    }
+    video_ksc5601_close();
 
     if (fontdatksc5601_user) {
         free(fontdatksc5601_user);
@@ -1005,6 +928,32 @@ video_force_resize_set_monitor(uint8_t res, int monitor_index)
     monitors[monitor_index].mon_force_resize = res;
 }
 
+void
+video_ksc5601_close(void)
+{
+    if (fontdatksc5601 == NULL)
+        return;
+
+    if (fontdatksc5601_mapped)
+        rom_unmap(fontdatksc5601, 16384 * sizeof(dbcs_font_t));
+    else
+        free(fontdatksc5601);
+
+    fontdatksc5601        = NULL;
+    fontdatksc5601_mapped = 0;
+}
+
+/* Reads n bytes of a font in one go, filling whatever is past the end of the
+   file with 0xff like the byte-wise fgetc() loops used to. */
+static void
+loadfont_read(uint8_t *dest, int n, FILE *f)
+{
+    size_t got = fread(dest, 1, n, f);
+
+    if (got < (size_t) n)
+        memset(dest + got, 0xff, n - got);
+}
+
 void
 loadfont_common(FILE *f, int format)
 {
@@ -1014,15 +963,11 @@ loadfont_common(FILE *f, int format)
     switch (format) {
         case 0: /* MDA */
             for (c = 0; c < 256; c++)
-                for (d = 0; d < 8; d++)
-                    fontdatm[c][d] = fgetc(f) & 0xff;
+                loadfont_read(&fontdatm[c][0], 8, f);
             for (c = 0; c < 256; c++)
-                for (d = 0; d < 8; d++)
-                    fontdatm[c][d + 8] = fgetc(f) & 0xff;
+                loadfont_read(&fontdatm[c][8], 8, f);
             (void) fseek(f, 4096 + 2048, SEEK_SET);
-            for (c = 0; c < 256; c++)
-                for (d = 0; d < 8; d++)
-                    fontdat[c][d] = fgetc(f) & 0xff;
+            loadfont_read(&fontdat[0][0], 256 * 8, f);
             break;
 
         case 1: /* PC200 */
@@ -1039,21 +984,15 @@ loadfont_common(FILE *f, int format)
 
         default:
         case 2: /* CGA */
-            for (c = 0; c < 256; c++)
-                for (d = 0; d < 8; d++)
-                    fontdat[c][d] = fgetc(f) & 0xff;
+            loadfont_read(&fontdat[0][0], 256 * 8, f);
             break;
 
         case 3: /* Wyse 700 */
-            for (c = 0; c < 512; c++)
-                for (d = 0; d < 32; d++)
-                    fontdatw[c][d] = fgetc(f) & 0xff;
+            loadfont_read(&fontdatw[0][0], 512 * 32, f);
             break;
 
         case 4: /* MDSI Genius */
-            for (c = 0; c < 256; c++)
-                for (d = 0; d < 16; d++)
-                    fontdat8x12[c][d] = fgetc(f) & 0xff;
+            loadfont_read(&fontdat8x12[0][0], 256 * 16, f);
             break;
 
         case 5:                               /* Toshiba 3100e */
@@ -1081,16 +1020,16 @@ loadfont_common(FILE *f, int format)
             break;
 
         case 6: /* Korean KSC-5601 */
+            if (fontdatksc5601_mapped)
+                video_ksc5601_close();
+
             if (!fontdatksc5601)
                 fontdatksc5601 = malloc(16384 * sizeof(dbcs_font_t));
 
             if (!fontdatksc5601_user)
                 fontdatksc5601_user = malloc(192 * sizeof(dbcs_font_t));
 
-            for (c = 0; c < 16384; c++) {
-                for (d = 0; d < 32; d++)
-                    fontdatksc5601[c].chr[d] = fgetc(f) & 0xff;
-            }
+            loadfont_read(&fontdatksc5601[0].chr[0], 16384 * sizeof(dbcs_font_t), f);
             break;
 
         case 7: /* Sigma Color 400 */
@@ -1107,9 +1046,7 @@ loadfont_common(FILE *f, int format)
             break;
 
         case 8:                        /* Amstrad PC1512, Toshiba T1000/T1200 */
-            for (c = 0; c < 2048; c++) /* Allow up to 2048 chars */
-                for (d = 0; d < 8; d++)
-                    fontdat[c][d] = fgetc(f) & 0xff;
+            loadfont_read(&fontdat[0][0], 2048 * 8, f); /* Allow up to 2048 chars */
             break;
 
         case 9: /* Image Manager 1024 native font */
@@ -1118,9 +1055,7 @@ loadfont_common(FILE *f, int format)
             break;
 
         case 10:                       /* Pravetz */
-            for (c = 0; c < 1024; c++) /* Allow up to 1024 chars */
-                for (d = 0; d < 8; d++)
-                    fontdat[c][d] = fgetc(f) & 0xff;
+            loadfont_read(&fontdat[0][0], 1024 * 8, f); /* Allow up to 1024 chars */
             break;
 
 
@@ -1145,6 +1080,23 @@ loadfont_ex(char *s, int format, int offset)
 {
     FILE *fp;
 
+    /* The Korean fonts are half a megabyte each and never written to, so
+       with rom_mmap they are mapped from the file, which shares them with
+       every other instance through the host page cache. */
+    if (format == 6) {
+        dbcs_font_t *mapped = (dbcs_font_t *) rom_map(s, 16384 * sizeof(dbcs_font_t), offset);
+
+        if (mapped != NULL) {
+            video_ksc5601_close();
+            fontdatksc5601        = mapped;
+            fontdatksc5601_mapped = 1;
+
+            if (!fontdatksc5601_user)
+                fontdatksc5601_user = malloc(192 * sizeof(dbcs_font_t));
+            return;
+        }
+    }
+
     fp = rom_fopen(s, "rb");
     if (fp == NULL)
         return;
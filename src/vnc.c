@@ -45,6 +45,8 @@ static int              allowedY;
 static int              ptr_x;
 static int              ptr_y;
 static int              ptr_but;
+static int              full_update;
+static uint32_t         row_buf[VNC_MAX_X];
 
 #ifdef ENABLE_VNC_LOG
 int vnc_do_log = ENABLE_VNC_LOG;
@@ -173,24 +175,87 @@ vnc_display(rfbClientPtr cl)
     }
 }
 
+/* Compare one transformed row against the framebuffer, returning the first
+   and last differing pixels, or 0 if the row is unchanged. */
+static int
+vnc_row_diff(const uint32_t *fb, const uint32_t *src, int w, int *l, int *r)
+{
+    int i = 0;
+    int j = w - 1;
+
+    while ((i < w) && (fb[i] == src[i]))
+        i++;
+    if (i == w)
+        return 0;
+
+    while (fb[j] == src[j])
+        j--;
+
+    *l = i;
+    *r = j;
+    return 1;
+}
+
 static void
 vnc_blit(int x, int y, int w, int h, int monitor_index)
 {
+    const uint32_t *src;
+    uint32_t       *fb;
+    int             band_y = -1;
+    int             band_l = 0;
+    int             band_r = 0;
+    int             mark;
+    int             l;
+    int             r;
+
     if (monitor_index || (x < 0) || (y < 0) || (w < VNC_MIN_X) || (h < VNC_MIN_Y) || (w > VNC_MAX_X) || (h > VNC_MAX_Y) || (buffer32 == NULL)) {
         video_blit_complete_monitor(monitor_index);
         return;
     }
 
-    for (int row = 0; row < h; ++row)
-        video_copy(&(((uint8_t *) rfb->frameBuffer)[row * 2048 * sizeof(uint32_t)]), &(buffer32->line[y + row][x]), w * sizeof(uint32_t));
+    /* Only rows that differ from the previous frame are copied, and only the
+       bands of consecutive changed rows are reported to LibVNCServer. */
+    mark = !updatingSize && !full_update;
+    for (int row = 0; row < h; ++row) {
+        fb  = &((uint32_t *) rfb->frameBuffer)[row * VNC_MAX_X];
+        src = &(buffer32->line[y + row][x]);
+        if (video_copy != memcpy) {
+            video_copy(row_buf, src, w * sizeof(uint32_t));
+            src = row_buf;
+        }
+
+        if (vnc_row_diff(fb, src, w, &l, &r)) {
+            memcpy(&fb[l], &src[l], (r - l + 1) * sizeof(uint32_t));
+
+            if (band_y < 0) {
+                band_y = row;
+                band_l = l;
+                band_r = r;
+            } else {
+                band_l = MIN(band_l, l);
+                band_r = MAX(band_r, r);
+            }
+        } else if (band_y >= 0) {
+            if (mark)
+                rfbMarkRectAsModified(rfb, band_l, band_y, band_r + 1, row);
+            band_y = -1;
+        }
+    }
+    if ((band_y >= 0) && mark)
+        rfbMarkRectAsModified(rfb, band_l, band_y, band_r + 1, h);
 
     if (screenshots)
         video_screenshot((uint32_t *) rfb->frameBuffer, 0, 0, VNC_MAX_X);
 
     video_blit_complete_monitor(monitor_index);
 
-    if (!updatingSize)
+    /* Changes made while a resize was pending were not reported. */
+    if (updatingSize)
+        full_update = 1;
+    else if (full_update) {
         rfbMarkRectAsModified(rfb, 0, 0, allowedX, allowedY);
+        full_update = 0;
+    }
 }
 
 /* Initialize VNC for operation. */
@@ -217,12 +282,13 @@ vnc_init(UNUSED(void *arg))
     if (rfb == NULL) {
         wcstombs(title, ui_window_title(NULL), sizeof(title));
         updatingSize = 0;
+        full_update  = 1;
         allowedX     = scrnsz_x;
         allowedY     = scrnsz_y;
 
         rfb              = rfbGetScreen(0, NULL, VNC_MAX_X, VNC_MAX_Y, 8, 3, 4);
         rfb->desktopName = title;
-        rfb->frameBuffer = (char *) malloc(VNC_MAX_X * VNC_MAX_Y * 4);
+        rfb->frameBuffer = (char *) calloc(VNC_MAX_X * VNC_MAX_Y, 4);
 
         rfb->serverFormat  = rpf;
         rfb->alwaysShared  = TRUE;
@@ -287,6 +353,7 @@ vnc_resize(int x, int y)
 
         rfb->width  = x;
         rfb->height = y;
+        full_update = 1;
 
         iterator = rfbGetClientIterator(rfb);
         while ((cl = rfbClientIteratorNext(iterator)) != NULL) {